@@ -4,17 +4,21 @@
 #
 #-------------------------------------------------
 
-QT       += core gui
+QT       += core gui concurrent
 #QT       += openglextensions
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# CONFIG += notrace compiles out the trace zones
+notrace: DEFINES += MESHTOOL_NO_TRACE
+
 TARGET = MeshTool
 TEMPLATE = app
 
 
 SOURCES += main.cpp\
         mainwindow.cpp \
+    commandline.cpp \
     mesh.cpp \
     mainview.cpp \
     persistence.cpp \
@@ -22,18 +26,33 @@ SOURCES += main.cpp\
   renderers/acc1renderer.cpp \
   renderers/acc2renderer.cpp \
   renderers/defaultrenderer.cpp \
+  renderers/diffreduction.cpp \
+  renderers/drawlist.cpp \
+  renderers/patchbounds.cpp \
   renderers/featureadaptiverenderer.cpp \
   renderers/ggrenderer.cpp \
   renderers/linerenderer.cpp \
   renderers/pointrenderer.cpp \
+  renderers/shaderprewarmer.cpp \
   renderers/surfacerenderer.cpp \
   renderers/transitionpatchrenderer.cpp \
+  tools/colormap.cpp \
   tools/convenience.cpp \
+  tools/coordsstencil.cpp \
+  tools/editfootprint.cpp \
+  tools/levelofdetail.cpp \
   tools/editing.cpp \
-  tools/subdivision.cpp
+  tools/foldover.cpp \
+  tools/levelmanager.cpp \
+  tools/memoryusage.cpp \
+  tools/poster.cpp \
+  tools/sparsehierarchy.cpp \
+  tools/subdivision.cpp \
+  tools/trace.cpp
 
 HEADERS  += mainwindow.h \
     coloredit.h \
+    commandline.h \
     coordsedit.h \
     mesh.h \
     persistence.h \
@@ -41,17 +60,36 @@ HEADERS  += mainwindow.h \
     renderers/acc1renderer.h \
     renderers/acc2renderer.h \
     renderers/defaultrenderer.h \
+    renderers/diffreduction.h \
+    renderers/drawlist.h \
+    renderers/patchbounds.h \
     renderers/featureadaptiverenderer.h \
     renderers/ggrenderer.h \
     renderers/linerenderer.h \
     renderers/pointrenderer.h \
+    renderers/shaderprewarmer.h \
     renderers/surfacerenderer.h \
     renderers/transitionpatchrenderer.h \
+    tools/changeset.h \
+    tools/colormap.h \
     tools/convenience.h \
+    tools/coordsstencil.h \
+    tools/densemap.h \
+    tools/editfootprint.h \
+    tools/levelofdetail.h \
     tools/editing.h \
+    tools/foldover.h \
+    tools/levelmanager.h \
+    tools/levelpool.h \
+    tools/memoryusage.h \
+    tools/poster.h \
+    tools/parallel.h \
+    tools/sparsehierarchy.h \
     tools/subdivision.h \
     tools/tools.h \
+    tools/trace.h \
     vertex.h \
+    vertexclassification.h \
     halfedge.h \
     face.h \
     mainview.h
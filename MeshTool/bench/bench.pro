@@ -0,0 +1,51 @@
+#-------------------------------------------------
+#
+# Benchmarks of the subdivision and editing pipeline
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent
+
+TARGET = meshtool-bench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+# CONFIG += notrace compiles out the trace zones
+notrace: DEFINES += MESHTOOL_NO_TRACE
+
+# Build against the sources of the application
+MESHTOOL = $$PWD/..
+INCLUDEPATH += $$MESHTOOL
+DEFINES += MODELS_DIR=\\\"$$MESHTOOL/models\\\"
+
+SOURCES += main.cpp \
+    gridgenerator.cpp \
+    $$MESHTOOL/tests/pipeline.cpp \
+    $$MESHTOOL/mesh.cpp \
+    $$MESHTOOL/persistence.cpp \
+    $$MESHTOOL/qvector5d.cpp \
+  $$MESHTOOL/renderers/acc1renderer.cpp \
+  $$MESHTOOL/renderers/acc2renderer.cpp \
+  $$MESHTOOL/renderers/defaultrenderer.cpp \
+  $$MESHTOOL/renderers/drawlist.cpp \
+  $$MESHTOOL/renderers/patchbounds.cpp \
+  $$MESHTOOL/renderers/featureadaptiverenderer.cpp \
+  $$MESHTOOL/renderers/ggrenderer.cpp \
+  $$MESHTOOL/renderers/surfacerenderer.cpp \
+  $$MESHTOOL/renderers/transitionpatchrenderer.cpp \
+  $$MESHTOOL/tools/convenience.cpp \
+  $$MESHTOOL/tools/coordsstencil.cpp \
+  $$MESHTOOL/tools/editfootprint.cpp \
+  $$MESHTOOL/tools/editing.cpp \
+  $$MESHTOOL/tools/foldover.cpp \
+  $$MESHTOOL/tools/memoryusage.cpp \
+  $$MESHTOOL/tools/sparsehierarchy.cpp \
+  $$MESHTOOL/tools/subdivision.cpp \
+  $$MESHTOOL/tools/trace.cpp
+
+HEADERS  += gridgenerator.h \
+    $$MESHTOOL/tests/pipeline.h
+
+RESOURCES += \
+    $$MESHTOOL/resources.qrc
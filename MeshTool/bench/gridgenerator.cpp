@@ -0,0 +1,66 @@
+#include "gridgenerator.h"
+#include <QBitArray>
+#include <random>
+
+// Uniform number in [0, 1), computed from the raw engine output so grids are
+// identical across standard libraries
+static float uniform(std::mt19937 &engine) {
+  return engine() / 4294967296.0;
+}
+
+void generateGrid(const GridOptions &options, QVector<QVector2D> *coords, QVector<QVector<int>> *faces) {
+  std::mt19937 engine(options.seed);
+  int n = options.size;
+  float cellSize = 2.0f / n;
+
+  coords->clear();
+  faces->clear();
+
+  // Vertices of a regular grid on [-1, 1]^2, interior vertices jittered
+  coords->reserve((n + 1) * (n + 1));
+  for (int j = 0; j <= n; ++j) {
+    for (int i = 0; i <= n; ++i) {
+      QVector2D p(-1 + i * cellSize, -1 + j * cellSize);
+      if (i > 0 && i < n && j > 0 && j < n) {
+        // Draw in a fixed order, argument evaluation order is unspecified
+        float dx = uniform(engine) - 0.5f;
+        float dy = uniform(engine) - 0.5f;
+        p += options.jitter * cellSize * QVector2D(dx, dy);
+      }
+      coords->append(p);
+    }
+  }
+
+  // Faces in CCW order, row by row
+  auto vertex = [n](int i, int j) { return j * (n + 1) + i; };
+  QBitArray used(n * n);
+  for (int j = 0; j < n; ++j) {
+    for (int i = 0; i < n; ++i) {
+      if (used.testBit(j * n + i))
+        continue;
+      used.setBit(j * n + i);
+      float r = uniform(engine);
+      if (r < options.ngonDensity) {
+        if (i + 1 < n && !used.testBit(j * n + i + 1)) {
+          // Merge with the right neighbour, the shared edge disappears
+          used.setBit(j * n + i + 1);
+          faces->append({vertex(i, j), vertex(i + 1, j), vertex(i + 2, j), vertex(i + 2, j + 1), vertex(i + 1, j + 1), vertex(i, j + 1)});
+        } else {
+          // No neighbour left to merge with in the last column, keep the quad
+          faces->append({vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1), vertex(i, j + 1)});
+        }
+      } else if (r < options.ngonDensity + options.irregularDensity) {
+        // Split along one of the diagonals
+        if (uniform(engine) < 0.5f) {
+          faces->append({vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1)});
+          faces->append({vertex(i, j), vertex(i + 1, j + 1), vertex(i, j + 1)});
+        } else {
+          faces->append({vertex(i, j), vertex(i + 1, j), vertex(i, j + 1)});
+          faces->append({vertex(i + 1, j), vertex(i + 1, j + 1), vertex(i, j + 1)});
+        }
+      } else {
+        faces->append({vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1), vertex(i, j + 1)});
+      }
+    }
+  }
+}
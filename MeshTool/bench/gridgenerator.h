@@ -0,0 +1,21 @@
+#ifndef GRIDGENERATOR_H
+#define GRIDGENERATOR_H
+
+#include <QVector>
+#include <QVector2D>
+
+// Parameters of a procedural benchmark grid. Cells are merged pairwise into
+// hexagons with probability ngonDensity and split into two triangles with
+// probability irregularDensity, both introduce irregular vertices.
+class GridOptions {
+  public:
+    int size = 32; // Cells per side
+    float ngonDensity = 0;
+    float irregularDensity = 0;
+    float jitter = 0.2f; // Displacement of interior vertices relative to the cell size
+    quint32 seed = 1;
+};
+
+void generateGrid(const GridOptions &options, QVector<QVector2D> *coords, QVector<QVector<int>> *faces);
+
+#endif // GRIDGENERATOR_H
@@ -0,0 +1,504 @@
+#include "gridgenerator.h"
+#include "persistence.h"
+#include "tests/pipeline.h"
+#include "tools/tools.h"
+#include "tools/levelpool.h"
+#include "tools/coordsstencil.h"
+#include "tools/foldover.h"
+#include "tools/sparsehierarchy.h"
+#include "renderers/defaultrenderer.h"
+#include "renderers/acc1renderer.h"
+#include "renderers/acc2renderer.h"
+#include "renderers/ggrenderer.h"
+#include "renderers/featureadaptiverenderer.h"
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QTextStream>
+#include <QtMath>
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#ifndef MODELS_DIR
+#define MODELS_DIR "models"
+#endif
+
+class BenchOptions {
+  public:
+    int levels = 3;
+    int iterations = 5;
+    int dragSteps = 20;
+    int gridSize = 32;
+    QString modelsDir = MODELS_DIR;
+    QString output;
+    bool gl = true;
+};
+
+class BenchInput {
+  public:
+    QString name;
+    QString fileName; // Empty for generated grids
+    GridOptions grid;
+};
+
+// The tools log every load and subdivision, keep that out of the timings
+static void messageHandler(QtMsgType type, const QMessageLogContext &, const QString &message) {
+  if (type == QtDebugMsg)
+    return;
+  QTextStream(stderr) << message << "\n";
+}
+
+static void printUsage(QTextStream &out) {
+  out << "Usage: meshtool-bench [options]\n";
+  out << "\n";
+  out << "  --levels <n>      Subdivision levels to compute (default 3)\n";
+  out << "  --iterations <n>  Timed runs per benchmark (default 5)\n";
+  out << "  --drag-steps <n>  Edit events per simulated drag (default 20)\n";
+  out << "  --grid-size <n>   Cells per side of the generated grids (default 32)\n";
+  out << "  --models <dir>    Directory searched for .obj files\n";
+  out << "  --output <file>   Write the JSON report to a file instead of stdout\n";
+  out << "  --no-gl           Skip the benchmarks that need an OpenGL 4.1 context\n";
+  out << "\n";
+  out << "Without a display, run with --no-gl or a Qt platform that provides OpenGL.\n";
+}
+
+static QJsonObject summarize(QString benchmark, int level, QVector<double> samples) {
+  QJsonObject result;
+  result["benchmark"] = benchmark;
+  if (level >= 0)
+    result["level"] = level;
+  result["iterations"] = samples.size();
+  if (samples.isEmpty())
+    return result;
+
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  foreach (double sample, samples)
+    sum += sample;
+  int middle = samples.size() / 2;
+  result["minMs"] = samples.first();
+  result["medianMs"] = samples.size() % 2 ? samples[middle] : 0.5 * (samples[middle - 1] + samples[middle]);
+  result["meanMs"] = sum / samples.size();
+  result["maxMs"] = samples.last();
+  return result;
+}
+
+// One untimed warm up run followed by the timed runs
+static QJsonObject measure(QString benchmark, int level, int iterations, std::function<void()> function) {
+  function();
+  QVector<double> samples;
+  QElapsedTimer timer;
+  for (int i = 0; i < iterations; ++i) {
+    timer.start();
+    function();
+    samples.append(timer.nsecsElapsed() / 1e6);
+  }
+  return summarize(benchmark, level, samples);
+}
+
+static QJsonObject meshSizes(const Mesh &mesh) {
+  QJsonObject sizes;
+  sizes["vertices"] = mesh.Vertices.size();
+  sizes["halfEdges"] = mesh.HalfEdges.size();
+  sizes["faces"] = mesh.Faces.size();
+  return sizes;
+}
+
+// Interior vertex closest to the centroid, the vertex that gets dragged
+static int findDragVertex(Mesh &mesh) {
+  QVector2D centroid;
+  foreach (const Vertex &v, mesh.Vertices)
+    centroid += v.coords;
+  centroid /= mesh.Vertices.size();
+
+  int dragVertex = -1;
+  float minDistance = std::numeric_limits<float>::max();
+  for (int i = 0; i < mesh.Vertices.size(); ++i) {
+    if (isBoundaryVertex(&mesh.Vertices[i]))
+      continue;
+    float distance = (mesh.Vertices[i].coords - centroid).lengthSquared();
+    if (distance < minDistance) {
+      minDistance = distance;
+      dragVertex = i;
+    }
+  }
+  return dragVertex;
+}
+
+// Move the vertex like MainView::editCoords does for a mouse move event, through the stencil if given
+static void dragCoords(Pipeline &p, FoldoverCache &foldoverCache, bool wasSelfIntersecting, int vertex, QVector2D deltaLimitCoords, const CoordsStencil *stencil = nullptr) {
+  p.changedLimitCoordsIndices.clear();
+  p.changedFacesIndices.clear();
+  p.changedEdgesIndices.clear();
+
+  QVector2D destinationLimitCoords = p.limitMeshes[0].Vertices[vertex].coords + deltaLimitCoords;
+  Vertex *editedVertex = &p.editedMeshes[0].Vertices[vertex];
+  QVector2D originalCoordsEvent = computeInvertedLimitPointCoords(editedVertex, destinationLimitCoords);
+
+  QVector2D previousCoords = editedVertex->coords;
+  editedVertex->coords = originalCoordsEvent;
+  foldoverCache.invalidate(&p.editedMeshes[0], vertex);
+  if (!wasSelfIntersecting && foldoverCache.isSelfIntersecting(&p.editedMeshes[0], vertex)) {
+    editedVertex->coords = previousCoords;
+    foldoverCache.invalidate(&p.editedMeshes[0], vertex);
+    return;
+  }
+
+  Vertex originalVertex = p.originalMeshes[0].Vertices[vertex];
+  CoordsEdit *ce = &p.coordsEdits[0][vertex];
+  *ce = computeCoordsEdit(originalVertex, originalCoordsEvent - originalVertex.coords);
+  if (stencil)
+    applyCoordsStencil(*stencil, p.originalMeshes, p.editedMeshes, p.limitMeshes, *ce, 1, 0, p.originalMeshes.size(), p.originalMeshes.size() - 1, p.changedFacesIndices, p.changedLimitCoordsIndices);
+  else
+    propagateCoordsEdit(p.originalMeshes, p.editedMeshes, p.limitMeshes, *ce, vertex, 1, 0, p.originalMeshes.size(), p.originalMeshes.size() - 1, p.changedFacesIndices, p.changedLimitCoordsIndices);
+}
+
+// Recolor the edge like MainView::editColor does for a brush stroke
+static void dragColor(Pipeline &p, QSet<int> &selectedEdges, QVector3D color) {
+  p.changedLimitCoordsIndices.clear();
+  p.changedFacesIndices.clear();
+  p.changedEdgesIndices.clear();
+
+  foreach (int edgeIndex, selectedEdges) {
+    ColorEdit *e = &p.colorEdits[0][edgeIndex];
+    e->edgeIndex = edgeIndex;
+    e->color = color;
+    Vertex *v = p.originalMeshes[0].HalfEdges[edgeIndex].twin->target;
+    e->affectedEdgeIndices.clear();
+    foreach (Face *f, getPadded(QSet<Vertex *>({v}), 3))
+      e->affectedEdgeIndices << f->side->index;
+  }
+  propagateColorEdit(p.originalMeshes, p.editedMeshes, p.limitMeshes, p.colorEdits[0], selectedEdges, 0, p.originalMeshes.size() - 1, p.changedFacesIndices, p.changedEdgesIndices);
+}
+
+static QJsonObject benchmarkInput(const BenchInput &input, const BenchOptions &options, QOpenGLFunctions_4_1_Core *functions) {
+  QJsonObject report;
+  QJsonArray results, skipped;
+  report["name"] = input.name;
+  Pipeline p;
+
+  // Load or generate
+  if (!input.fileName.isEmpty()) {
+    report["source"] = input.fileName;
+    results.append(measure("load", -1, options.iterations, [&]() {
+      load(input.fileName, &p.inputMesh, &p.coordsEdits, &p.colorEdits);
+    }));
+  } else {
+    QJsonObject grid;
+    grid["size"] = input.grid.size;
+    grid["ngonDensity"] = input.grid.ngonDensity;
+    grid["irregularDensity"] = input.grid.irregularDensity;
+    grid["seed"] = double(input.grid.seed);
+    report["grid"] = grid;
+    QVector<QVector2D> coords;
+    QVector<QVector<int>> faces;
+    generateGrid(input.grid, &coords, &faces);
+    results.append(measure("buildMesh", -1, options.iterations, [&]() {
+      buildMesh(coords, faces, &p.inputMesh);
+    }));
+  }
+  if (p.inputMesh.Vertices.isEmpty()) {
+    report["error"] = "No mesh in input";
+    return report;
+  }
+
+  // Input statistics
+  QJsonObject inputSizes = meshSizes(p.inputMesh);
+  int nonQuadFaces = 0, irregularVertices = 0;
+  foreach (const Face &f, p.inputMesh.Faces)
+    if (f.val != 4)
+      ++nonQuadFaces;
+  for (int i = 0; i < p.inputMesh.Vertices.size(); ++i)
+    if (p.inputMesh.Vertices[i].val != 4 && !isBoundaryVertex(&p.inputMesh.Vertices[i]))
+      ++irregularVertices;
+  inputSizes["nonQuadFaces"] = nonQuadFaces;
+  inputSizes["irregularVertices"] = irregularVertices;
+  report["input"] = inputSizes;
+
+  // Subdivision pipeline, level by level like MainView::computeLevel
+  QJsonArray levels;
+  for (int level = 0; level <= options.levels; ++level) {
+    Mesh &originalMesh = p.originalMeshes.append();
+    results.append(measure(level == 0 ? "subdivideTernaryStep" : "subdivideCatmullClark", level, options.iterations, [&]() {
+      p.subdivideLevel(level, &originalMesh);
+    }));
+
+    Mesh &editedMesh = p.editedMeshes.append();
+    results.append(measure("computeEditedMesh", level, options.iterations, [&]() {
+      p.editLevel(level, &originalMesh, &editedMesh);
+    }));
+
+    Mesh &limitMesh = p.limitMeshes.append();
+    results.append(measure("computeLimitMesh", level, options.iterations, [&]() {
+      computeLimitMesh(&editedMesh, &limitMesh);
+    }));
+
+    QJsonObject sizes = meshSizes(originalMesh);
+    sizes["level"] = level;
+    levels.append(sizes);
+
+    // Control points as collected by the setMesh of each patch renderer
+    QVector<float> data;
+    results.append(measure("ACC1Renderer::addControlPoints", level, options.iterations, [&]() {
+      data.clear();
+      foreach (Face f, editedMesh.Faces)
+        if (f.val == 4)
+          ACC1Renderer::addControlPoints(f, &data);
+    }));
+    results.append(measure("ACC2Renderer::addControlPoints", level, options.iterations, [&]() {
+      data.clear();
+      foreach (Face f, editedMesh.Faces)
+        if (f.val == 3 || f.val == 4)
+          ACC2Renderer::addControlPoints(f, &data);
+    }));
+    QHash<int, QVector<float>> datas;
+    results.append(measure("GGRenderer::addControlPoints", level, options.iterations, [&]() {
+      datas.clear();
+      foreach (Face f, editedMesh.Faces)
+        ACC2Renderer::addControlPoints(f, &datas[f.val]);
+    }));
+  }
+  report["levels"] = levels;
+
+  // Simulated drag of an input vertex, one sample per edit event
+  int dragVertex = findDragVertex(p.inputMesh);
+  if (dragVertex == -1) {
+    skipped.append("drag: no interior vertex");
+  } else {
+    float radius = 0.01f;
+    foreach (const Face &f, p.inputMesh.Faces)
+      radius = qMax(radius, 0.05f * (f.side->target->coords - f.side->prev->target->coords).length());
+
+    // Whether the mesh folded over is checked once per drag
+    FoldoverCache foldoverCache;
+    bool wasSelfIntersecting = foldoverCache.isSelfIntersecting(&p.editedMeshes[0], dragVertex);
+
+    QVector<double> samples;
+    QElapsedTimer timer;
+    for (int i = 0; i < options.dragSteps; ++i) {
+      float angle = 2 * M_PI * i / options.dragSteps;
+      timer.start();
+      dragCoords(p, foldoverCache, wasSelfIntersecting, dragVertex, radius * QVector2D(-qSin(angle), qCos(angle)));
+      samples.append(timer.nsecsElapsed() / 1e6);
+    }
+    results.append(summarize("updateCoords", -1, samples));
+
+    // The same drag through a stencil, built once for the vertex
+    CoordsStencil stencil;
+    results.append(measure("buildCoordsStencil", -1, options.iterations, [&]() {
+      buildCoordsStencil(p.originalMeshes, p.editedMeshes, p.limitMeshes, p.coordsEdits, dragVertex, 0, &stencil);
+    }));
+    samples.clear();
+    for (int i = 0; i < options.dragSteps; ++i) {
+      float angle = 2 * M_PI * i / options.dragSteps;
+      timer.start();
+      dragCoords(p, foldoverCache, wasSelfIntersecting, dragVertex, radius * QVector2D(-qSin(angle), qCos(angle)), &stencil);
+      samples.append(timer.nsecsElapsed() / 1e6);
+    }
+    results.append(summarize("updateCoordsStencil", -1, samples));
+
+    QSet<int> selectedEdges({p.originalMeshes[0].Vertices[dragVertex].out->index});
+    samples.clear();
+    for (int i = 0; i < options.dragSteps; ++i) {
+      float t = float(i) / options.dragSteps;
+      timer.start();
+      dragColor(p, selectedEdges, QVector3D(t, 1 - t, 0.5f));
+      samples.append(timer.nsecsElapsed() / 1e6);
+    }
+    results.append(summarize("updateColor", -1, samples));
+  }
+
+  // Classification and refinement of the feature adaptive levels, without the upload
+  EditFootprint footprint;
+  results.append(measure("EditFootprint::build", -1, options.iterations, [&]() {
+    footprint.build(p.coordsEdits, p.colorEdits);
+  }));
+  int footprintHits = 0;
+  int footprintEdges = p.editedMeshes[options.levels].HalfEdges.size();
+  results.append(measure("EditFootprint::hasAffectedDescendant", options.levels, options.iterations, [&]() {
+    for (int e = 0; e < footprintEdges; ++e)
+      footprintHits += footprint.hasAffectedDescendant(e, options.levels);
+  }));
+  results.append(measure("EditFootprint::hasAffectedAncestor", options.levels, options.iterations, [&]() {
+    for (int e = 0; e < footprintEdges; ++e)
+      footprintHits += footprint.hasAffectedAncestor(e, options.levels);
+  }));
+  LevelPool<SparseLevel> sparseLevels;
+  results.append(measure("computeSparseHierarchy", -1, options.iterations, [&]() {
+    computeSparseHierarchy(&p.originalMeshes[0], p.coordsEdits, p.colorEdits, &sparseLevels);
+  }));
+
+  // Renderer uploads, these include the GPU buffer transfers
+  if (!functions) {
+    skipped.append("renderers: no OpenGL 4.1 context");
+  } else {
+    Mesh &editedMesh = p.editedMeshes[options.levels];
+    QHash<QString, SurfaceRenderer *> renderers;
+    renderers["DefaultRenderer"] = new DefaultRenderer(functions);
+    renderers["ACC1Renderer"] = new ACC1Renderer(functions);
+    renderers["ACC2Renderer"] = new ACC2Renderer(functions);
+    renderers["GGRenderer"] = new GGRenderer(functions);
+    foreach (QString name, renderers.keys()) {
+      results.append(measure(name + "::setMesh", options.levels, options.iterations, [&]() {
+        renderers[name]->setMesh(editedMesh);
+        functions->glFinish();
+      }));
+    }
+    FeatureAdaptiveRenderer featureAdaptiveRenderer(functions);
+    results.append(measure("FeatureAdaptiveRenderer::setMesh", -1, options.iterations, [&]() {
+      featureAdaptiveRenderer.setMesh(&p.originalMeshes[0], p.coordsEdits, p.colorEdits);
+      functions->glFinish();
+    }));
+    qDeleteAll(renderers);
+  }
+
+  report["results"] = results;
+  if (!skipped.isEmpty())
+    report["skipped"] = skipped;
+  return report;
+}
+
+static QList<BenchInput> collectInputs(const BenchOptions &options) {
+  QList<BenchInput> inputs;
+
+  // Bundled models, including the ones with edits
+  QDir modelsDir(options.modelsDir);
+  QStringList fileNames;
+  QDirIterator it(options.modelsDir, QStringList({"*.obj"}), QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext())
+    fileNames.append(it.next());
+  fileNames.sort();
+  foreach (QString fileName, fileNames) {
+    BenchInput input;
+    input.name = modelsDir.relativeFilePath(fileName);
+    input.fileName = fileName;
+    inputs.append(input);
+  }
+
+  // Generated grids with increasing amounts of irregularity
+  const struct { const char *name; float ngonDensity, irregularDensity; } grids[] = {
+    {"grid-regular", 0, 0},
+    {"grid-ngon", 0.25f, 0},
+    {"grid-irregular", 0, 0.25f},
+    {"grid-mixed", 0.15f, 0.15f}
+  };
+  for (const auto &grid : grids) {
+    BenchInput input;
+    input.name = QString("%1-%2").arg(grid.name).arg(options.gridSize);
+    input.grid.size = options.gridSize;
+    input.grid.ngonDensity = grid.ngonDensity;
+    input.grid.irregularDensity = grid.irregularDensity;
+    inputs.append(input);
+  }
+  return inputs;
+}
+
+static bool parseOptions(QStringList args, BenchOptions *options, QTextStream &err) {
+  for (int i = 1; i < args.size(); ++i) {
+    QString arg = args[i];
+    if (arg == "--no-gl") {
+      options->gl = false;
+      continue;
+    }
+    if (i + 1 >= args.size()) {
+      err << "Missing value for " << arg << "\n";
+      return false;
+    }
+    QString value = args[++i];
+    bool ok = true;
+    if (arg == "--levels")
+      options->levels = value.toInt(&ok);
+    else if (arg == "--iterations")
+      options->iterations = value.toInt(&ok);
+    else if (arg == "--drag-steps")
+      options->dragSteps = value.toInt(&ok);
+    else if (arg == "--grid-size")
+      options->gridSize = value.toInt(&ok);
+    else if (arg == "--models")
+      options->modelsDir = value;
+    else if (arg == "--output")
+      options->output = value;
+    else {
+      err << "Unknown option " << arg << "\n";
+      return false;
+    }
+    if (!ok || options->levels < 0 || options->iterations < 1 || options->dragSteps < 1 || options->gridSize < 2) {
+      err << "Invalid value for " << arg << ": " << value << "\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  // Only connect to a display when the renderers are benchmarked
+  bool gl = true;
+  for (int i = 1; i < argc; ++i)
+    if (QString(argv[i]) == "--no-gl")
+      gl = false;
+  QScopedPointer<QCoreApplication> app(gl ? new QGuiApplication(argc, argv) : new QCoreApplication(argc, argv));
+
+  QTextStream err(stderr);
+  BenchOptions options;
+  if (!parseOptions(app->arguments(), &options, err)) {
+    printUsage(err);
+    return 2;
+  }
+  qInstallMessageHandler(messageHandler);
+
+  // Offscreen context for the renderers, if the platform provides one
+  QSurfaceFormat glFormat;
+  glFormat.setProfile(QSurfaceFormat::CoreProfile);
+  glFormat.setVersion(4, 1);
+  QOffscreenSurface surface;
+  QOpenGLContext context;
+  QOpenGLFunctions_4_1_Core *functions = nullptr;
+  QString glVersion;
+  if (options.gl) {
+    surface.setFormat(glFormat);
+    surface.create();
+    context.setFormat(glFormat);
+    if (context.create() && context.makeCurrent(&surface))
+      functions = context.versionFunctions<QOpenGLFunctions_4_1_Core>();
+    if (functions && functions->initializeOpenGLFunctions())
+      glVersion = (const char *) functions->glGetString(GL_VERSION);
+    else
+      functions = nullptr;
+  }
+
+  QJsonObject report;
+  report["qtVersion"] = qVersion();
+  report["levels"] = options.levels;
+  report["iterations"] = options.iterations;
+  report["dragSteps"] = options.dragSteps;
+  report["glVersion"] = functions ? QJsonValue(glVersion) : QJsonValue();
+
+  QJsonArray inputs;
+  foreach (const BenchInput &input, collectInputs(options)) {
+    err << ":: " << input.name << "\n";
+    err.flush();
+    inputs.append(benchmarkInput(input, options, functions));
+  }
+  report["inputs"] = inputs;
+
+  // Write report
+  QByteArray json = QJsonDocument(report).toJson();
+  if (options.output.isEmpty()) {
+    QTextStream(stdout) << json;
+    return 0;
+  }
+  QFile file(options.output);
+  if (!file.open(QFile::WriteOnly) || file.write(json) != json.size()) {
+    err << "Could not write " << options.output << "\n";
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+#include "commandline.h"
+#include "persistence.h"
+#include "tools/tools.h"
+#include "tools/foldover.h"
+#include "tools/levelpool.h"
+#include "tools/memoryusage.h"
+#include "tools/poster.h"
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <limits>
+
+bool isCommandLineMode(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (QString(argv[i]).startsWith("--"))
+      return true;
+  }
+  return false;
+}
+
+static void printUsage(QTextStream &out) {
+  out << "Usage: MeshTool\n";
+  out << "       MeshTool --validate <file> [levels]\n";
+  out << "       MeshTool --memory <file> [levels]\n";
+  out << "       MeshTool --render <file> <image> [width] [levels]\n";
+  out << "\n";
+  out << "  --validate  Check the patches of the edited meshes up to the given\n";
+  out << "              subdivision level (default 0) for foldovers. Exits with 1\n";
+  out << "              if a foldover is found.\n";
+  out << "  --memory    Compute the levels up to the given subdivision level\n";
+  out << "              (default 0) and report the bytes used per structure and\n";
+  out << "              level, and of the sparse hierarchy for comparison. GL\n";
+  out << "              buffers are not created on the command line.\n";
+  out << "  --render    Render the limit mesh of the given subdivision level\n";
+  out << "              (default 3) into a TIFF or PNG image of the given width\n";
+  out << "              (default 8192) framing the whole mesh. The image is\n";
+  out << "              rendered and written in tiles, so its size is not\n";
+  out << "              limited by the available memory.\n";
+}
+
+// Load a file with its edits, returns false if it does not hold a mesh
+static bool loadFile(QString fileName, Mesh *mesh, QHash<int, QHash<int, CoordsEdit>> *coordsEdits, QHash<int, QHash<int, ColorEdit>> *colorEdits, QTextStream &out) {
+  if (!QFile::exists(fileName)) {
+    out << "File not found: " << fileName << "\n";
+    return false;
+  }
+  load(fileName, mesh, coordsEdits, colorEdits);
+  if (mesh->Vertices.isEmpty()) {
+    out << "No mesh in file: " << fileName << "\n";
+    return false;
+  }
+  return true;
+}
+
+static int validate(QString fileName, int levels, QTextStream &out) {
+  Mesh inputMesh;
+  QHash<int, QHash<int, CoordsEdit>> coordsEdits;
+  QHash<int, QHash<int, ColorEdit>> colorEdits;
+  if (!loadFile(fileName, &inputMesh, &coordsEdits, &colorEdits, out))
+    return 2;
+
+  int foldovers = 0;
+  Mesh originalMesh, editedMesh;
+  for (int level = 0; level <= levels; ++level) {
+    // Compute the edited mesh of the level
+    originalMesh.clear();
+    if (level == 0)
+      subdivideTernaryStep(&inputMesh, &originalMesh);
+    else
+      subdivideCatmullClark(&editedMesh, &originalMesh);
+    computeEditedMesh(&originalMesh, coordsEdits[level], colorEdits[level], &editedMesh);
+
+    // Check all faces
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> faceIndices = findFoldoverFaces(&editedMesh);
+    out << "level " << level << ": " << faceIndices.size() << " of " << editedMesh.Faces.size() << " faces fold over (" << timer.elapsed() << " ms)\n";
+    if (!faceIndices.isEmpty()) {
+      out << "  faces:";
+      foreach (int faceIndex, faceIndices)
+        out << " " << faceIndex;
+      out << "\n";
+    }
+    foldovers += faceIndices.size();
+  }
+
+  return foldovers > 0 ? 1 : 0;
+}
+
+static int reportMemory(QString fileName, int levels, QTextStream &out) {
+  Mesh inputMesh;
+  QHash<int, QHash<int, CoordsEdit>> coordsEdits;
+  QHash<int, QHash<int, ColorEdit>> colorEdits;
+  if (!loadFile(fileName, &inputMesh, &coordsEdits, &colorEdits, out))
+    return 2;
+
+  // Compute the levels like the viewer does
+  LevelPool<Mesh> originalMeshes, editedMeshes, limitMeshes;
+  LevelPool<VertexClassification> vertexClassifications;
+  for (int level = 0; level <= levels; ++level) {
+    Mesh &originalMesh = originalMeshes.append();
+    if (level == 0)
+      subdivideTernaryStep(&inputMesh, &originalMesh);
+    else
+      subdivideCatmullClark(&editedMeshes[level-1], &originalMesh);
+    Mesh &editedMesh = editedMeshes.append();
+    computeEditedMesh(&originalMesh, coordsEdits[level], colorEdits[level], &editedMesh);
+    computeLimitMesh(&editedMesh, &limitMeshes.append());
+    VertexClassification &classification = vertexClassifications.append();
+    if (level == 0)
+      classifyVertices(inputMesh.Vertices.size(), editedMesh, &classification);
+    else
+      classifySubdividedVertices(editedMeshes[level-1], vertexClassifications[level-1], editedMesh, &classification);
+  }
+
+  MemoryReport report;
+  report.add("input mesh", -1, meshBytes(inputMesh));
+  for (int level = 0; level <= levels; ++level) {
+    report.add("original meshes", level, meshBytes(originalMeshes[level]));
+    report.add("edited meshes", level, meshBytes(editedMeshes[level]));
+    report.add("limit meshes", level, meshBytes(limitMeshes[level]));
+    report.add("vertex classifications", level, classificationBytes(vertexClassifications[level]));
+  }
+
+  // The adaptive hierarchy for comparison, it always goes down to the finest edit
+  LevelPool<SparseLevel> sparseLevels;
+  computeSparseHierarchy(&originalMeshes[0], coordsEdits, colorEdits, &sparseLevels);
+  for (int level = 0; level < sparseLevels.size(); ++level)
+    report.add("sparse levels", level, sparseLevelBytes(sparseLevels[level]));
+  foreach (int level, coordsEdits.keys())
+    report.add("coordinate edits", level, coordsEditsBytes(coordsEdits[level]));
+  foreach (int level, colorEdits.keys())
+    report.add("color edits", level, colorEditsBytes(colorEdits[level]));
+  out << report.toText();
+  return 0;
+}
+
+static int render(QString fileName, QString imageFileName, int width, int levels, QTextStream &out) {
+  Mesh inputMesh;
+  QHash<int, QHash<int, CoordsEdit>> coordsEdits;
+  QHash<int, QHash<int, ColorEdit>> colorEdits;
+  if (!loadFile(fileName, &inputMesh, &coordsEdits, &colorEdits, out))
+    return 2;
+
+  // Only the last level is kept
+  Mesh originalMesh, editedMesh, limitMesh;
+  for (int level = 0; level <= levels; ++level) {
+    originalMesh.clear();
+    if (level == 0)
+      subdivideTernaryStep(&inputMesh, &originalMesh);
+    else
+      subdivideCatmullClark(&editedMesh, &originalMesh);
+    computeEditedMesh(&originalMesh, coordsEdits[level], colorEdits[level], &editedMesh);
+  }
+  computeLimitMesh(&editedMesh, &limitMesh);
+
+  // Frame the whole mesh
+  QVector2D low(std::numeric_limits<float>::max(), std::numeric_limits<float>::max()), high = -low;
+  foreach (const Vertex &vertex, limitMesh.Vertices) {
+    low = QVector2D(qMin(low.x(), vertex.coords.x()), qMin(low.y(), vertex.coords.y()));
+    high = QVector2D(qMax(high.x(), vertex.coords.x()), qMax(high.y(), vertex.coords.y()));
+  }
+  QRectF rect(low.toPointF(), high.toPointF());
+  if (rect.width() <= 0 || rect.height() <= 0) {
+    out << "Mesh has no area\n";
+    return 2;
+  }
+  int height = qMax(1, qRound(width * rect.height() / rect.width()));
+
+  QElapsedTimer timer;
+  timer.start();
+  QString errorString;
+  if (!renderPoster(limitMesh, rect, width, height, imageFileName, &errorString)) {
+    out << "Could not render " << imageFileName << ": " << errorString << "\n";
+    return 1;
+  }
+  out << "rendered " << width << "x" << height << " pixels of " << limitMesh.Faces.size() << " faces at level " << levels << " (" << timer.elapsed() << " ms)\n";
+  return 0;
+}
+
+int runCommandLine(QStringList arguments) {
+  QTextStream out(stdout);
+
+  if (arguments.size() >= 3 && arguments[1] == "--validate") {
+    int levels = arguments.size() >= 4 ? arguments[3].toInt() : 0;
+    return validate(arguments[2], levels, out);
+  }
+
+  if (arguments.size() >= 3 && arguments[1] == "--memory") {
+    int levels = arguments.size() >= 4 ? arguments[3].toInt() : 0;
+    return reportMemory(arguments[2], levels, out);
+  }
+
+  if (arguments.size() >= 4 && arguments[1] == "--render") {
+    int width = arguments.size() >= 5 ? arguments[4].toInt() : 8192;
+    int levels = arguments.size() >= 6 ? arguments[5].toInt() : 3;
+    return render(arguments[2], arguments[3], width, levels, out);
+  }
+
+  printUsage(out);
+  return 2;
+}
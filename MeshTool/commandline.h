@@ -0,0 +1,9 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QStringList>
+
+bool isCommandLineMode(int argc, char *argv[]);
+int runCommandLine(QStringList arguments);
+
+#endif // COMMANDLINE_H
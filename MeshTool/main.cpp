@@ -1,8 +1,30 @@
 #include "mainwindow.h"
+#include "commandline.h"
+#include "tools/trace.h"
 #include <QApplication>
 #include <QSurfaceFormat>
 
+// Write the trace started for MESHTOOL_TRACE, if any
+static int finish(QString traceFileName, int result) {
+  if (!traceFileName.isEmpty()) {
+    stopTrace();
+    writeTrace(traceFileName);
+  }
+  return result;
+}
+
 int main(int argc, char *argv[]) {
+  // Record the whole session when MESHTOOL_TRACE names an output file
+  QString traceFileName = QString::fromLocal8Bit(qgetenv("MESHTOOL_TRACE"));
+  if (!traceFileName.isEmpty())
+    startTrace();
+
+  // Command line tools run without a window
+  if (isCommandLineMode(argc, argv)) {
+    QCoreApplication a(argc, argv);
+    return finish(traceFileName, runCommandLine(a.arguments()));
+  }
+
   QApplication a(argc, argv);
 
   QSurfaceFormat glFormat;
@@ -14,5 +36,5 @@ int main(int argc, char *argv[]) {
   MainWindow w;
   w.show();
 
-  return a.exec();
+  return finish(traceFileName, a.exec());
 }
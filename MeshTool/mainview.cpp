@@ -10,31 +10,39 @@
 
 MainView::MainView(QWidget *Parent) : QOpenGLWidget(Parent) {
     qDebug() << "✓✓ MainView constructor";
+    levelManager.setInput(&inputMesh, &coordsEdits, &colorEdits);
+    connect(&levelManager, SIGNAL(levelsReady()), this, SLOT(onLevelsReady()));
+    connect(&levelManager, SIGNAL(levelComputed(int)), this, SLOT(update()));
+
+    // Prefetch once the view has been idle for a moment
+    prefetchTimer.setSingleShot(true);
+    prefetchTimer.setInterval(500);
+    connect(&prefetchTimer, SIGNAL(timeout()), this, SLOT(prefetchNextLevel()));
+
+    // Refine the levels skipped by a drag once it is released or idle
+    refineTimer.setSingleShot(true);
+    connect(&refineTimer, SIGNAL(timeout()), this, SLOT(refineNextLevel()));
+
+    // Choose the automatic level once zooming and panning settle
+    autoLevelTimer.setSingleShot(true);
+    autoLevelTimer.setInterval(200);
+    connect(&autoLevelTimer, SIGNAL(timeout()), this, SLOT(updateAutoLevel()));
+
+    // Poll for the difference reduction until the GPU is done with it
+    diffReadbackTimer.setSingleShot(true);
+    diffReadbackTimer.setInterval(5);
+    connect(&diffReadbackTimer, SIGNAL(timeout()), this, SLOT(readDiffReduction()));
 }
 
 MainView::~MainView() {
     qDebug() << "✗✗ MainView destructor";
 
-    originalMeshes.clear();
-    originalMeshes.squeeze();
-    editedMeshes.clear();
-    editedMeshes.squeeze();
-    limitMeshes.clear();
-    limitMeshes.squeeze();
+    delete shaderPrewarmer;
+    levelManager.release();
     coordsEdits.clear();
     coordsEdits.squeeze();
     colorEdits.clear();
     colorEdits.squeeze();
-    editableVertexIndices.clear();
-    editableVertexIndices.squeeze();
-    gradientVertexIndices.clear();
-    gradientVertexIndices.squeeze();
-    changedLimitCoordsIndices.clear();
-    changedLimitCoordsIndices.squeeze();
-    changedEdgesIndices.clear();
-    changedEdgesIndices.squeeze();
-    changedFacesIndices.clear();
-    changedFacesIndices.squeeze();
 
     debugLogger->stopLogging();
 
@@ -47,17 +55,31 @@ MainView::~MainView() {
     // Delete difference framebuffer
     delete limitFramebuffer;
     delete diffFramebuffer;
+    delete diffReduction;
+    glDeleteTextures(1, &colormapTexture);
 }
 
 // ---
 
 void MainView::setMesh(QString fileName) {
+    TRACE_ZONE("MainView::setMesh");
+    flushJournal();
+    journal.close();
+    prefetchedMesh.clear();
+    refineTimer.stop();
+    refineVertex = -1;
+    int previousSize = inputMesh.HalfEdges.size();
     load(fileName, &inputMesh, &coordsEdits, &colorEdits);
     clearSelection();
+
+    // Level buffers are kept for reloads, but free them when they would be oversized
+    if (inputMesh.HalfEdges.size() < previousSize)
+        levelManager.release();
     recomputeMeshes();
     updateMeshForCurrentRenderer(false);
     if (isDiffComputed())
         updateMeshLimitRenderer();
+    scheduleAutoLevel();
 }
 
 void MainView::clearSelection() {
@@ -66,8 +88,10 @@ void MainView::clearSelection() {
     affectedVertex.clear();
 }
 
+// In automatic mode the spin box is the finest level that may be chosen
 int MainView::getSubdivSteps() {
-    return mainWindow->ui->SubdivSteps->value();
+    int steps = mainWindow->ui->SubdivSteps->value();
+    return autoLevel < 0 ? steps : qBound(getEditSteps(), autoLevel, steps);
 }
 
 int MainView::getEditSteps() {
@@ -82,8 +106,23 @@ bool MainView::isDiffComputed() {
     return mainWindow->ui->DisplayDifference->checkState();
 }
 
+// The feature adaptive renderer draws from the sparse hierarchy instead of a uniform level
+bool MainView::usesSparseLevels() {
+    return mainWindow->ui->Renderer->currentText() == "Feature Adaptive";
+}
+
+// Levels needed for display, the difference and edit propagation. With sparse levels
+// nothing above the edit level has to be uniformly subdivided.
+int MainView::getRequiredLevels() {
+    int levels = usesSparseLevels() ? getEditSteps() : getSubdivSteps();
+    if (isDiffComputed())
+        levels = qMax(levels, getLimitSubdivSteps());
+    return levels + 1;
+}
+
+// Editing waits until the edit level is computed
 bool MainView::isEditingEnabled() {
-    return mainWindow->ui->EnableEditing->checkState();
+    return mainWindow->ui->EnableEditing->checkState() && levelManager.isResident(getEditSteps());
 }
 
 float MainView::getBrushRadius() {
@@ -99,155 +138,325 @@ bool MainView::isModelLoaded() {
     return inputMesh.Vertices.size() > 0;
 }
 
+QString MainView::changeSetLabel(const ChangeSet& changes, QString unit) {
+    if (changes.isEmpty())
+        return "";
+    return QString::number(changes.size()) + " " + unit + " (" + QString::number(changes.rawSize()) + " raw)\n";
+}
+
 int MainView::getMaxComputedSubdivLevel() {
     return originalMeshes.size() - 1;
 }
 
+void MainView::setMemoryBudget(int megabytes) {
+    levelManager.setBudget(qint64(megabytes) << 20);
+    update();
+}
+
+// Memory per structure and level, recycled levels beyond the computed ones included
+const MemoryReport &MainView::getMemoryReport() {
+    if (!memoryReportDirty && memoryReportVersion == levelManager.getVersion())
+        return memoryReport;
+    memoryReportDirty = false;
+    memoryReportVersion = levelManager.getVersion();
+    memoryReport = MemoryReport();
+    memoryReport.add("input mesh", -1, meshBytes(inputMesh));
+    for (int i = 0; i < originalMeshes.allocatedSize(); ++i)
+        memoryReport.add("original meshes", i, meshBytes(originalMeshes.allocated(i)));
+    for (int i = 0; i < editedMeshes.allocatedSize(); ++i)
+        memoryReport.add("edited meshes", i, meshBytes(editedMeshes.allocated(i)));
+    for (int i = 0; i < limitMeshes.allocatedSize(); ++i)
+        memoryReport.add("limit meshes", i, meshBytes(limitMeshes.allocated(i)));
+    for (int i = 0; i < vertexClassifications.allocatedSize(); ++i)
+        memoryReport.add("vertex classifications", i, classificationBytes(vertexClassifications.allocated(i)));
+    for (int i = 0; i < sparseLevels.allocatedSize(); ++i)
+        memoryReport.add("sparse levels", i, sparseLevelBytes(sparseLevels.allocated(i)));
+    foreach (int level, coordsEdits.keys())
+        memoryReport.add("coordinate edits", level, coordsEditsBytes(coordsEdits[level]));
+    foreach (int level, colorEdits.keys())
+        memoryReport.add("color edits", level, colorEditsBytes(colorEdits[level]));
+    foreach (QString name, renderers.keys()) {
+        QHash<QString, qint64> memoryInfo = renderers[name]->getMemoryInfo();
+        foreach (QString key, memoryInfo.keys())
+            memoryReport.add(name + " renderer " + key, -1, memoryInfo[key]);
+    }
+    return memoryReport;
+}
+
 //update = 0, set mesh
 //update = 1, update coords
 //update = 2, update color
 void MainView::updateMeshForCurrentRenderer(int update) {
+    TRACE_ZONE("MainView::updateMeshForCurrentRenderer");
     if (!isModelLoaded())
         return;
+    // Coordinate updates keep the buffer sizes
+    if (update != 1)
+        memoryReportDirty = true;
 
     // Set mesh for current renderer
     QString renderer = QString(mainWindow->ui->Renderer->currentText());
+    if (renderer == "Feature Adaptive") {
+        QElapsedTimer timer;
+        timer.start();
+        computeSparseHierarchy(&originalMeshes[0], coordsEdits, colorEdits, &sparseLevels);
+        ((FeatureAdaptiveRenderer *) renderers[renderer])->setHierarchy(sparseLevels);
+        memoryReportDirty = true;
+        //        qDebug() << "Feature Adaptive Time elapsed:" << timer.elapsed() << "milliseconds";
+        return;
+    }
+    sparseLevels.release();
+
+    // Keep showing the previous level until the displayed one is computed
+    if (!levelManager.isAvailable(getDisplayLevel() + 1))
+        return;
+    levelManager.touch(getDisplayLevel());
+    if (update == 0)
+        shownLevel = getDisplayLevel();
+
     if (renderer == "Default"){
         QElapsedTimer timer;
         timer.start();
-        if (update == 0)
-            renderers[renderer]->setMesh(limitMeshes[getSubdivSteps()]);
+        if (update == 0 && !usePrefetchedMesh(renderer))
+            renderers[renderer]->setMesh(limitMeshes[getDisplayLevel()]);
         else if(update == 1) //only update coords for changde points
-            renderers[renderer]->updateMeshCoords(limitMeshes[getSubdivSteps()], changedLimitCoordsIndices);
+            renderers[renderer]->updateMeshCoords(limitMeshes[getDisplayLevel()], changedLimitCoordsIndices);
         else //only update colors for changed points
-            renderers[renderer]->updateMeshColors(limitMeshes[getSubdivSteps()], changedEdgesIndices);
+            renderers[renderer]->updateMeshColors(limitMeshes[getDisplayLevel()], changedEdgesIndices);
         //        qDebug() << "Deafault Time elapsed:" << timer.elapsed() << "milliseconds";
     }
     else if (renderer == "ACC1" || renderer == "ACC2" || renderer == "GG") {
         QElapsedTimer timer;
         timer.start();
-        if (update == 0)
-            renderers[renderer]->setMesh(editedMeshes[getSubdivSteps()]);
+        if (update == 0 && !usePrefetchedMesh(renderer))
+            renderers[renderer]->setMesh(editedMeshes[getDisplayLevel()]);
         else if(update == 1) //only update coords for changde points
-            renderers[renderer]->updateMeshCoords(editedMeshes[getSubdivSteps()], changedFacesIndices);
+            renderers[renderer]->updateMeshCoords(editedMeshes[getDisplayLevel()], changedFacesIndices);
         else //only update colors for changed points
-            renderers[renderer]->updateMeshColors(editedMeshes[getSubdivSteps()], changedFacesIndices);
+            renderers[renderer]->updateMeshColors(editedMeshes[getDisplayLevel()], changedFacesIndices);
         //        qDebug() << "ACC Time elapsed:" << timer.elapsed() << "milliseconds";
     }
-    else if (renderer == "Feature Adaptive") {
-        QElapsedTimer timer;
-        timer.start();
-        ((FeatureAdaptiveRenderer *) renderers[renderer])->setMesh(originalMeshes[0], coordsEdits, colorEdits);
-        //        qDebug() << "Feature Adaptive Time elapsed:" << timer.elapsed() << "milliseconds";
-    }
+    prefetchTimer.start();
+}
+
+// Hand the buffers of the prefetcher to the renderer, if they were prepared for the displayed level
+bool MainView::usePrefetchedMesh(QString renderer) {
+    QSharedPointer<PrefetchedMesh> prefetched = prefetchedMesh;
+    if (!prefetched || !prefetched->ready.loadAcquire() || !prefetched->buffers)
+        return false;
+    if (prefetched->level != getDisplayLevel() || prefetched->renderer != renderer)
+        return false;
+    renderers[renderer]->setPreparedMesh(prefetched->buffers.data());
+    prefetchedMesh.clear();
+    return true;
+}
+
+// Compute the level above the displayed one and the buffers of the current renderer for it,
+// so stepping up a level only has to upload them
+void MainView::prefetchNextLevel() {
+    // The level would derive from meshes a drag has not refined yet
+    if (!isModelLoaded() || isRefining() || usesSparseLevels())
+        return;
+    int level = getSubdivSteps() + 1;
+    if (level > mainWindow->ui->SubdivSteps->maximum() || levelManager.isResident(level))
+        return;
+
+    QString renderer = QString(mainWindow->ui->Renderer->currentText());
+    SurfaceRenderer *surfaceRenderer = renderers[renderer];
+    bool useLimitMesh = renderer == "Default";
+    QSharedPointer<PrefetchedMesh> prefetched(new PrefetchedMesh());
+    prefetched->level = level;
+    prefetched->renderer = renderer;
+    bool started = levelManager.prefetch(level + 1, [prefetched, surfaceRenderer, useLimitMesh](Mesh &editedMesh, Mesh &limitMesh) {
+        prefetched->buffers.reset(surfaceRenderer->prepareMesh(useLimitMesh ? limitMesh : editedMesh));
+        prefetched->ready.storeRelease(1);
+    });
+    if (started)
+        prefetchedMesh = prefetched;
+    update();
 }
 
 void MainView::updateMeshLimitRenderer() {
+    TRACE_ZONE("MainView::updateMeshLimitRenderer");
+    if (!levelManager.isAvailable(getLimitSubdivSteps() + 1))
+        return;
+    levelManager.touch(getLimitSubdivSteps());
     renderers["Limit"]->setMesh(limitMeshes[getLimitSubdivSteps()]);
+    limitFramebufferDirty = true;
+    memoryReportDirty = true;
 }
 
 void MainView::recomputeMeshes() {
-    // Clean
-    originalMeshes.clear();
-    editedMeshes.clear();
-    limitMeshes.clear();
-    editableVertexIndices.clear();
-    gradientVertexIndices.clear();
+    TRACE_ZONE("MainView::recomputeMeshes");
+    // Clean (levels keep their buffers for reuse)
+    levelManager.reset();
+    coordsStencil.clear();
     changedLimitCoordsIndices.clear();
     changedEdgesIndices.clear();
     changedFacesIndices.clear();
 
-    // Initialize with ternary subdivision
-    originalMeshes.append(Mesh());
-    subdivideTernaryStep(&inputMesh, &originalMeshes[0]);
-    editedMeshes.append(computeEditedMesh(originalMeshes[0], coordsEdits[0], colorEdits[0]));
-    limitMeshes.append(computeLimitMesh(editedMeshes[0]));
-    editableVertexIndices.append(getEditableVertexIndices(inputMesh.Vertices.size(), editedMeshes[0]));
-    gradientVertexIndices.append(getGradientVertexIndices(inputMesh.Vertices.size(), editedMeshes[0]));
-
-    // Add Catmull-Clark subdivision steps
-    int requiredSubdivSteps = isDiffComputed() ? qMax(getSubdivSteps(), getLimitSubdivSteps()) : getSubdivSteps();
-    for (int i = 1; i <= requiredSubdivSteps; ++i) {
-        originalMeshes.append(Mesh());
-        subdivideCatmullClark(&editedMeshes[i-1], &originalMeshes[i]);
-        editedMeshes.append(computeEditedMesh(originalMeshes[i], coordsEdits[i], colorEdits[i]));
-        limitMeshes.append(computeLimitMesh(editedMeshes[i]));
-        editableVertexIndices.append(getEditableVertexIndices(inputMesh.Vertices.size(), editedMeshes[i]));
-        gradientVertexIndices.append(getGradientVertexIndices(inputMesh.Vertices.size(), editedMeshes[i]));
+    // Ternary subdivision followed by Catmull-Clark subdivision steps
+    levelManager.require(getRequiredLevels());
+}
+
+// Shown level, lower than the Catmull-Clark steps while a drag has not been refined up to them
+int MainView::getDisplayLevel() {
+    return isRefining() ? qMin(getSubdivSteps(), refineLevel - 1) : getSubdivSteps();
+}
+
+bool MainView::isRefining() {
+    return refineVertex != -1;
+}
+
+// Bring the next level that a drag skipped up to date, one level per event loop iteration
+void MainView::refineNextLevel() {
+    TRACE_ZONE("MainView::refineNextLevel");
+    if (!isRefining())
+        return;
+    changedLimitCoordsIndices.clear();
+    changedFacesIndices.clear();
+    changedEdgesIndices.clear();
+    CoordsEdit &coordsEdit = coordsEdits[refineEditLevel][refineVertex];
+    if (coordsStencil.isValid(refineVertex, refineEditLevel, originalMeshes.size())) {
+        applyCoordsStencil(coordsStencil, originalMeshes, editedMeshes, limitMeshes, coordsEdit, 1, refineLevel, refineLevel + 1, -1, changedFacesIndices, changedLimitCoordsIndices);
+    } else {
+        refineCoordsEdit(originalMeshes, editedMeshes, limitMeshes, coordsEdit, refineVertex, 1, refineEditLevel, refineLevel, -1, changedFacesIndices, changedLimitCoordsIndices);
     }
+    if (++refineLevel >= originalMeshes.size())
+        refineVertex = -1;
+    else
+        refineTimer.start(0);
+
+    // Show the displayed level again as soon as it is refined
+    if (getDisplayLevel() != shownLevel)
+        updateMeshForCurrentRenderer(0);
+    if (!isRefining() && isDiffComputed())
+        updateMeshLimitRenderer();
+    updateRefinementLabel();
+    update();
 }
 
-//only do needed subdivision instead of recomputing everything, save memory
-void MainView::subdivide() {
-    int requiredSubdivSteps = isDiffComputed() ? qMax(getSubdivSteps(), getLimitSubdivSteps()) : getSubdivSteps();
-    for (int i = getMaxComputedSubdivLevel() + 1; i <= requiredSubdivSteps; ++i) {
-        originalMeshes.append(Mesh());
-        subdivideCatmullClark(&editedMeshes[i-1], &originalMeshes[i]);
-        editedMeshes.append(computeEditedMesh(originalMeshes[i], coordsEdits[i], colorEdits[i]));
-        limitMeshes.append(computeLimitMesh(editedMeshes[i]));
-        editableVertexIndices.append(getEditableVertexIndices(inputMesh.Vertices.size(), editedMeshes[i]));
-        gradientVertexIndices.append(getGradientVertexIndices(inputMesh.Vertices.size(), editedMeshes[i]));
+// Refine all levels skipped by a drag right away, before anything reads them
+void MainView::finishRefinement() {
+    if (!isRefining())
+        return;
+    TRACE_ZONE("MainView::finishRefinement");
+    while (isRefining())
+        refineNextLevel();
+    refineTimer.stop();
+}
+
+void MainView::setAutoLevel(bool enabled) {
+    autoLevel = enabled ? mainWindow->ui->SubdivSteps->value() : -1;
+    if (enabled)
+        scheduleAutoLevel();
+    else if (subdivide())
+        updateMeshForCurrentRenderer(false);
+    update();
+}
+
+void MainView::scheduleAutoLevel() {
+    if (autoLevel >= 0)
+        autoLevelTimer.start();
+}
+
+// Steps one level towards the one the visible region needs, so a zoom over
+// several levels passes the ones in between instead of waiting for the last.
+// Measuring stops at levels that are not resident or exceed the scan budget.
+void MainView::updateAutoLevel() {
+    if (autoLevel < 0 || !isModelLoaded() || usesSparseLevels())
+        return;
+    if (isRefining() || (levelManager.isPending() && !levelManager.isPrefetching())) {
+        autoLevelTimer.start();
+        return;
     }
+    TRACE_ZONE("MainView::updateAutoLevel");
+    autoLevel = getSubdivSteps();
+    QRectF viewRect = getViewRect();
+    float pixelsPerUnit = getScaleVector().x() * width() / 2;
+    int scanBudget = autoLevelScanVertices;
+    int target = selectDetailLevel(autoLevel, getEditSteps(), mainWindow->ui->SubdivSteps->value(), autoLevelPixels, [&](int level) {
+        if (!levelManager.isResident(level) || limitMeshes[level].Vertices.size() > scanBudget)
+            return -1.0f;
+        scanBudget -= limitMeshes[level].Vertices.size();
+        return computeLevelError(editedMeshes[level], limitMeshes[level], viewRect) * pixelsPerUnit;
+    });
+    if (target == autoLevel)
+        return;
+
+    autoLevel += target > autoLevel ? 1 : -1;
+    if (subdivide())
+        updateMeshForCurrentRenderer(false);
+    update();
+    autoLevelTimer.start();
+}
+
+void MainView::readDiffReduction() {
+    if (!diffReduction->isPending())
+        return;
+    float maxDiff, meanDiff;
+    makeCurrent();
+    bool finished = diffReduction->poll(&maxDiff, &meanDiff);
+    doneCurrent();
+    if (finished && isDiffComputed())
+        mainWindow->setMaxVisibleDiffLabel(maxDiff / sqrt(3), meanDiff / sqrt(3));
+    if (diffReduction->isPending())
+        diffReadbackTimer.start();
+}
+
+void MainView::updateRefinementLabel() {
+    if (isRefining())
+        mainWindow->ui->RefinementLabel->setText("Refining level " + QString::number(refineLevel) + " of " + QString::number(originalMeshes.size() - 1));
+    else
+        mainWindow->ui->RefinementLabel->setText("Refined");
+}
+
+// Only compute the missing levels, in the background. Returns whether they are available
+// right away, otherwise onLevelsReady() updates the renderers once they are in.
+bool MainView::subdivide() {
+    TRACE_ZONE("MainView::subdivide");
+    finishRefinement();
+    coordsStencil.clear();
+    return levelManager.request(getRequiredLevels());
+}
+
+void MainView::onLevelsReady() {
+    updateMeshForCurrentRenderer(0);
+    if (isDiffComputed())
+        updateMeshLimitRenderer();
+    update();
 }
 
 //update coords when a point is moved instead of recomputing everything
 void MainView::updateCoords(int editFlag) {
+    TRACE_ZONE("MainView::updateCoords");
     int curEditStep = getEditSteps();
-    int curStep = getSubdivSteps();
-    int maxComputedSubdivLevel = getMaxComputedSubdivLevel();
-
-    //update coords of editedmesh & limitmesh at current edit step
-    (curStep == curEditStep) ?
-                updateEditedCoords(originalMeshes[curEditStep], editedMeshes[curEditStep], coordsEdits[curEditStep][selectedVertex], selectedVertex, editFlag, changedFacesIndices, 0, true) :
-                updateEditedCoords(originalMeshes[curEditStep], editedMeshes[curEditStep], coordsEdits[curEditStep][selectedVertex], selectedVertex, editFlag, changedFacesIndices, 0, false);
-    (curStep == curEditStep) ?
-                updateLimitCoords(editedMeshes[curEditStep], limitMeshes[curEditStep], selectedVertex, changedLimitCoordsIndices, 0, true) :
-                updateLimitCoords(editedMeshes[curEditStep], limitMeshes[curEditStep], selectedVertex, changedLimitCoordsIndices, 0, false);
-
-    //update coords of originalmes & editedmesh & limitmesh from the next step of current edit step to max computed subdivision level
-    int level = 1;
-    for (int i = curEditStep + 1; i <= maxComputedSubdivLevel; i++) {
-        updateOriginalCoords(&originalMeshes[i], &editedMeshes[i-1], selectedVertex, level);
-        (curStep == i) ?
-                    updateEditedCoords(originalMeshes[i], editedMeshes[i], coordsEdits[curEditStep][selectedVertex], selectedVertex, editFlag, changedFacesIndices, level, true) :
-                    updateEditedCoords(originalMeshes[i], editedMeshes[i], coordsEdits[curEditStep][selectedVertex], selectedVertex, editFlag, changedFacesIndices, level, false);
-        (curStep == i) ?
-                    updateLimitCoords(editedMeshes[i], limitMeshes[i], selectedVertex, changedLimitCoordsIndices, level++, true) :
-                    updateLimitCoords(editedMeshes[i], limitMeshes[i], selectedVertex, changedLimitCoordsIndices, level++, false);
+
+    // While dragging, levels beyond the ones that fit in the frame budget are refined afterwards
+    int endLevel = originalMeshes.size();
+    if (editFlag == 1 && mainWindow->ui->ProgressiveDrag->isChecked())
+        endLevel = qMin(endLevel, curEditStep + 1 + dragLevels);
+    if (endLevel < originalMeshes.size()) {
+        refineVertex = selectedVertex;
+        refineEditLevel = curEditStep;
+        refineLevel = endLevel;
+    } else {
+        refineVertex = -1;
+    }
+    CoordsEdit &coordsEdit = coordsEdits[curEditStep][selectedVertex];
+    if (coordsStencil.isValid(selectedVertex, curEditStep, originalMeshes.size())) {
+        applyCoordsStencil(coordsStencil, originalMeshes, editedMeshes, limitMeshes, coordsEdit, editFlag, curEditStep, endLevel, getDisplayLevel(), changedFacesIndices, changedLimitCoordsIndices);
+    } else {
+        propagateCoordsEdit(originalMeshes, editedMeshes, limitMeshes, coordsEdit, selectedVertex, editFlag, curEditStep, endLevel, getDisplayLevel(), changedFacesIndices, changedLimitCoordsIndices);
     }
+    updateRefinementLabel();
 }
 
 //update color when a color is modified instead of recomputing everything
 void MainView::updateColor() {
+    TRACE_ZONE("MainView::updateColor");
     int curEditStep = getEditSteps();
-    int curStep = getSubdivSteps();
-    int maxComputedSubdivLevel = getMaxComputedSubdivLevel();
-
-    //update color of editedmesh & limitmesh at current edit step
-    QHash<int, QSet<Face *>> affectedEditedfaces = getColorAffectedFaces(selectedEdges, editedMeshes[curEditStep], 0);
-    (curStep == curEditStep) ?
-                updateEditedColor(originalMeshes[curEditStep], editedMeshes[curEditStep], colorEdits[curEditStep], selectedEdges, 0, affectedEditedfaces, true, changedFacesIndices) :
-                updateEditedColor(originalMeshes[curEditStep], editedMeshes[curEditStep], colorEdits[curEditStep], selectedEdges, 0, affectedEditedfaces, false, changedFacesIndices);
-    QHash<int, QSet<Face *>> affectedfaces = getColorAffectedFaces(selectedEdges, limitMeshes[curEditStep], 0);
-    (curStep == curEditStep) ?
-                updateLimitMeshColor(editedMeshes[curEditStep], limitMeshes[curEditStep], colorEdits[curEditStep], selectedEdges, changedEdgesIndices, 0, affectedfaces, true) :
-                updateLimitMeshColor(editedMeshes[curEditStep], limitMeshes[curEditStep], colorEdits[curEditStep], selectedEdges, changedEdgesIndices, 0, affectedfaces, false);
-
-    //update color of originalmes & editedmesh & limitmesh from the next step of current edit step to max computed subdivision level
-    int level = 1;
-    for (int i = curEditStep + 1; i <= maxComputedSubdivLevel; i++) {
-        QHash<int, QSet<Face *>> affectedLimitedFaces = getColorAffectedFaces(selectedEdges, limitMeshes[i], level);
-        QHash<int, QSet<Face *>> editedFaces = getColorAffectedFaces(selectedEdges, editedMeshes[i-1], level-1);
-        QHash<int, QSet<Face *>> editedFaces2 = getColorAffectedFaces(selectedEdges, editedMeshes[i], level);
-
-        updateOriginalColor(&originalMeshes[i], &editedMeshes[i-1], selectedEdges, level, editedFaces);
-        (curStep == i) ?
-                    updateEditedColor(originalMeshes[i], editedMeshes[i], colorEdits[curEditStep], selectedEdges, level, editedFaces2, true, changedFacesIndices) :
-                    updateEditedColor(originalMeshes[i], editedMeshes[i], colorEdits[curEditStep], selectedEdges, level, editedFaces2, false, changedFacesIndices);
-        (curStep == i) ?
-                    updateLimitMeshColor(editedMeshes[i], limitMeshes[i], colorEdits[curEditStep], selectedEdges, changedEdgesIndices, level ++, affectedLimitedFaces, true) :
-                    updateLimitMeshColor(editedMeshes[i], limitMeshes[i], colorEdits[curEditStep], selectedEdges, changedEdgesIndices, level ++, affectedLimitedFaces, false);
-    }
+    propagateColorEdit(originalMeshes, editedMeshes, limitMeshes, colorEdits[curEditStep], selectedEdges, curEditStep, getDisplayLevel(), changedFacesIndices, changedEdgesIndices);
 }
 
 void MainView::initializeGL() {
@@ -284,13 +493,32 @@ void MainView::initializeGL() {
     updateShowWireframe();
     updateColorBands();
     updateTessLevel();
+    updateSegmentPixels();
+    updateViewportSize();
     updateDiffScaling();
 
+    // Initialize colormap, bound once
+    glGenTextures(1, &colormapTexture);
+    uploadColormap();
+    foreach (SurfaceRenderer *renderer, renderers)
+        renderer->setColormapUnit(1);
+
     // Initialize framebuffers
     QOpenGLFramebufferObjectFormat format;
     format.setInternalTextureFormat(GL_RGBA32F);
     limitFramebuffer = new QOpenGLFramebufferObject(this->width(), this->height(), format);
     diffFramebuffer = new QOpenGLFramebufferObject(this->width(), this->height(), format);
+    diffReduction = new DiffReduction(functions);
+    diffReduction->resize(this->width(), this->height());
+
+    // Compile the GG programs of the common valencies in the background
+    if (qEnvironmentVariableIntValue("MESHTOOL_PREWARM_SHADERS") > 0) {
+        QList<ShaderPrewarmer::MakeFunction> makeFunctions;
+        for (int val = 3; val <= 12; ++val)
+            makeFunctions << [val]() { return GGRenderer::makeShaderProgram(val); };
+        shaderPrewarmer = new ShaderPrewarmer(context(), makeFunctions);
+        shaderPrewarmer->start(QThread::LowPriority);
+    }
 }
 
 void MainView::resizeGL(int width, int height) {
@@ -305,12 +533,16 @@ void MainView::resizeGL(int width, int height) {
     format.setInternalTextureFormat(GL_RGBA32F);
     limitFramebuffer = new QOpenGLFramebufferObject(width, height, format);
     diffFramebuffer = new QOpenGLFramebufferObject(width, height, format);
+    diffReduction->resize(width, height);
+    limitFramebufferDirty = true;
 
     updateScaling();
+    updateViewportSize();
     update();
 }
 
 void MainView::paintGL() {
+    TRACE_ZONE("MainView::paintGL");
     if (!isModelLoaded()){
         return;
     }
@@ -318,16 +550,20 @@ void MainView::paintGL() {
     QString currentRenderer(mainWindow->ui->Renderer->currentText());
 
     if (isDiffComputed()) {
-        // Render limit surface to framebuffer
-        limitFramebuffer->bind();
-
-        //On a Mac with a retina display, the frame buffer is larger than the window by 2x in each dimension.
-        //I must adjust the size of the viewport to the size of the bound frame buffer before I’m about to draw something into a frame buffer.
-        glViewport(0, 0, this->width(), this->height()); //you don't need this if you don't use MAC.
-        glClearColor(0, 0, 0, 1);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        renderers["Limit"]->render();
-        limitFramebuffer->release();
+        // Render limit surface to framebuffer, only when it changed
+        if (limitFramebufferDirty) {
+            TRACE_ZONE("MainView::paintGL limit");
+            limitFramebuffer->bind();
+
+            //On a Mac with a retina display, the frame buffer is larger than the window by 2x in each dimension.
+            //I must adjust the size of the viewport to the size of the bound frame buffer before I’m about to draw something into a frame buffer.
+            glViewport(0, 0, this->width(), this->height()); //you don't need this if you don't use MAC.
+            glClearColor(0, 0, 0, 1);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderers["Limit"]->render();
+            limitFramebuffer->release();
+            limitFramebufferDirty = false;
+        }
 
         // Set limit framebuffer as current texture
         glActiveTexture(GL_TEXTURE0);
@@ -337,16 +573,9 @@ void MainView::paintGL() {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-        // Save texture as an image
-        QImage image0 = limitFramebuffer->toImage();
-        QDateTime d = QDateTime::currentDateTime();
-        QString date = d.toString("dd.MM.yyyy.hh:mm:ss.zzz") + ".png";
-        QString fileName =  "./../../../../MeshTool/examples/texture/" + date;
-        //                image0.save(fileName, "PNG", 100);
-
-
         // Render difference to framebuffer
         diffFramebuffer->bind();
+        glViewport(0, 0, this->width(), this->height());
 
         glClearColor(0, 0, 0, 1);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -354,24 +583,9 @@ void MainView::paintGL() {
         renderers[currentRenderer]->render();
         diffFramebuffer->release();
 
-        // Update maximum difference value in interface
-        QImage image = diffFramebuffer->toImage();
-        d = QDateTime::currentDateTime();
-        date = d.toString("dd.MM.yyyy.hh:mm:ss.zzzDDD") + ".png";
-        fileName =  "./../../../../MeshTool/examples/texture/" + date;
-        //                image.save(fileName, "PNG", 100);
-
-        double maxDiff = 0;
-        for (int i = 0; i < image.height(); ++i) {
-            for (int j = 0; j < image.width(); ++j) {
-                QColor color = image.pixelColor(j, i);
-                maxDiff = qMax(maxDiff, color.red() / 255.0 + color.green() / (255.0 * 255.0) + color.blue() / (255.0 * 255.0 * 255.0));
-            }
-        }
-        maxDiff /= sqrt(3);
-        mainWindow->setMaxVisibleDiffLabel(maxDiff);
-        qDebug() << "maxDiff=" << QString::number(maxDiff);
-
+        // Reduce the difference on the GPU, the interface is updated once it is read back
+        diffReduction->reduce(diffFramebuffer->texture());
+        diffReadbackTimer.start();
     }
     glViewport(0, 0, this->width()*2, this->height()*2); //you don't need this if you don't use MAC.
 
@@ -390,7 +604,31 @@ void MainView::paintGL() {
     foreach (QString unit, units) {
         label += QString::number(countInfo[unit]) + " " + unit + "\n";
     }
+
+    if (autoLevel >= 0 && !usesSparseLevels())
+        label += "Automatic level " + QString::number(getSubdivSteps()) + "\n";
+
+    // Add sizes of the change sets of the last edit (unique and raw)
+    label += changeSetLabel(changedLimitCoordsIndices, "changed limit vertices");
+    label += changeSetLabel(changedFacesIndices, "changed faces");
+    label += changeSetLabel(changedEdgesIndices, "changed halfedges");
+
+    // Add memory totals, the tooltip breaks them down per level and buffer
+    const MemoryReport &report = getMemoryReport();
+    foreach (QString category, QStringList({"original meshes", "edited meshes", "limit meshes", "vertex classifications", "sparse levels", "coordinate edits", "color edits"})) {
+        if (report.total(category) > 0)
+            label += formatBytes(report.total(category)) + " " + category + "\n";
+    }
+    qint64 rendererBytes = 0;
+    foreach (qint64 bytes, renderers[currentRenderer]->getMemoryInfo())
+        rendererBytes += bytes;
+    label += formatBytes(rendererBytes) + " " + currentRenderer + " renderer\n";
+    label += formatBytes(report.total()) + " total\n";
+    label += formatBytes(levelManager.getResidentBytes()) + " of " + formatBytes(levelManager.getBudget()) + " level budget\n";
+    if (levelManager.isPending())
+        label += (levelManager.isPrefetching() ? "prefetching level " : "computing level ") + QString::number(levelManager.getPendingLevel()) + "\n";
     mainWindow->setInfoLabel(label);
+    mainWindow->ui->InfoLabel->setToolTip(report.toText());
 
     // Render using current renderer
     renderers[currentRenderer]->setComputeDiff((int) isDiffComputed());
@@ -449,7 +687,7 @@ void MainView::renderPoints() {
     pointRenderer->setRadius(.01 / getScaleVector().length());
 
     // Draw editable vertices
-    pointRenderer->setVertexIndices(editableVertexIndices[getEditSteps()]);
+    pointRenderer->setVertexIndices(vertexClassifications[getEditSteps()].editableIndices);
     pointRenderer->setColor(QVector3D(0, 0, 1)); //blue points
     pointRenderer->setFilled(true);
     pointRenderer->render();
@@ -458,7 +696,7 @@ void MainView::renderPoints() {
     pointRenderer->render();
 
     // Draw gradient vertices
-    pointRenderer->setVertexIndices(gradientVertexIndices[getEditSteps()]);
+    pointRenderer->setVertexIndices(vertexClassifications[getEditSteps()].gradientIndices);
     pointRenderer->setColor(QVector3D(0, 1, 0)); //green points
     pointRenderer->setFilled(true);
     pointRenderer->render();
@@ -482,7 +720,7 @@ void MainView::renderPoints() {
     QVector<int> sectorIndicesUnselected, sectorIndicesSelected;
     QSet<HalfEdge *> ff;
     int idx = 0;
-    foreach (int vertexIndex, editableVertexIndices[getEditSteps()]) {
+    foreach (int vertexIndex, vertexClassifications[getEditSteps()].editableIndices) {
         Vertex v = limitMeshes[getEditSteps()].Vertices[vertexIndex];
         foreach (HalfEdge *e, getVertexEdges(v.out)) {
             if (!e->polygon)
@@ -536,6 +774,28 @@ QVector2D MainView::getWorldCoords(QPoint point) {
     return world_coords;
 }
 
+// Renders the limit mesh of the displayed level, which is what the default renderer shows
+bool MainView::savePoster(QString fileName, int width, QString *errorString) {
+    TRACE_ZONE("MainView::savePoster");
+    finishRefinement();
+    int level = getDisplayLevel();
+    if (!isModelLoaded() || !levelManager.isResident(level)) {
+        *errorString = "The displayed level is not computed yet";
+        return false;
+    }
+    levelManager.touch(level);
+    QRectF viewRect = getViewRect();
+    int height = qMax(1, qRound(width * viewRect.height() / viewRect.width()));
+    return renderPoster(limitMeshes[level], viewRect, width, height, fileName, errorString);
+}
+
+// Mesh coordinates of the window corners
+QRectF MainView::getViewRect() {
+    QVector2D bottomLeft = getWorldCoords(QPoint(0, height()));
+    QVector2D topRight = getWorldCoords(QPoint(width(), 0));
+    return QRectF(bottomLeft.toPointF(), topRight.toPointF());
+}
+
 void MainView::setSelected(QPoint point) {
 
     if (!(isModelLoaded() && isEditingEnabled()))
@@ -544,8 +804,8 @@ void MainView::setSelected(QPoint point) {
     QVector2D worldCoordsEvent = getWorldCoords(point);
 
     QVector<int> allEditable;
-    allEditable.append(editableVertexIndices[getEditSteps()]);
-    allEditable.append(gradientVertexIndices[getEditSteps()]);
+    allEditable.append(vertexClassifications[getEditSteps()].editableIndices);
+    allEditable.append(vertexClassifications[getEditSteps()].gradientIndices);
 
     // Set selected vertex
     int nearestVertexIndex = -1;
@@ -564,7 +824,7 @@ void MainView::setSelected(QPoint point) {
     // Set selected edges and vertex
     selectedEdges.clear();
     affectedVertex.clear();
-    foreach (int vertexIndex, editableVertexIndices[getEditSteps()]) {
+    foreach (int vertexIndex, vertexClassifications[getEditSteps()].editableIndices) {
         Vertex v = limitMeshes[getEditSteps()].Vertices[vertexIndex];
         foreach (HalfEdge *e, getVertexEdges(v.out)) {
             if (!e->polygon)
@@ -581,58 +841,21 @@ void MainView::setSelected(QPoint point) {
 
 void MainView::mousePressEvent(QMouseEvent *event) {
     lastEventPos = event->pos();
+    foldoverVertex = -1;
     setFocus();
     if (event->buttons() & Qt::RightButton && selectedEdges.size() > 0 && isEditingEnabled())
         editColor();
     update();
 }
 
-CoordsEdit MainView::computeCoordsEdit(Vertex v, QVector2D deltaCoords) {
-    HalfEdge *e1 = v.out;
-    for (int i = 0; i < v.val; ++i) {
-        HalfEdge *e2 = e1->prev->twin;
-        QVector2D vec1 = e1->target->coords - v.coords;
-        QVector2D vec2 = e2->target->coords - v.coords;
-        // Compute angle between e1 and e2
-        float alpha = atan2(vec2.y(), vec2.x()) - atan2(vec1.y(), vec1.x());
-        if (alpha < 0)
-            alpha += 2 * M_PI;
-        // Compute angle between e1 and displacement
-        float phi = atan2(deltaCoords.y(), deltaCoords.x()) - atan2(vec1.y(), vec1.x());
-        if (phi < 0)
-            phi += 2 * M_PI;
-        // Continue if wrong sector
-        if (phi > alpha) {
-            e1 = e1->prev->twin;
-            continue;
-        }
-        // Check if boundary or interior point
-        CoordsEdit ce;
-        if (e1->polygon) {
-            // Let WolframAlpha solve 'solve x = a x_1 + b x_2, y = a y_1 + b y_2 for a and b'
-            float a = -(deltaCoords.x() * vec2.y() - vec2.x() * deltaCoords.y()) / (vec2.x() * vec1.y() - vec1.x() * vec2.y());
-            float b = -(vec1.x() * deltaCoords.y() - deltaCoords.x() * vec1.y()) / (vec2.x() * vec1.y() - vec1.x() * vec2.y());
-            ce.edgeIndex = e1->index;
-            ce.val1 = a;
-            ce.val2 = b;
-            ce.boundary = false;
-        } else {
-            ce.edgeIndex = e1->twin->index;
-            ce.val1 = phi / alpha;
-            ce.val2 = deltaCoords.lengthSquared() / sqrt(vec1.lengthSquared() * vec2.lengthSquared());
-            ce.boundary = true;
-        }
-        // Update affected edge indices
-        QSet<Face *> twoRingFaces = getPadded(QSet<Vertex *>({&v}), 2);
-        foreach (Face *f, twoRingFaces)
-            ce.affectedEdgeIndices << f->side->index;
-        //        for (int i = 0; i < changedFacesIndices.size(); i ++)
-        //            ce.affectedEdgeIndices << originalMeshes[getEditSteps()].Faces[i].side->index;
-
-        // Return
-        return ce;
-    }
-    return CoordsEdit();
+void MainView::mouseReleaseEvent(QMouseEvent *event) {
+    Q_UNUSED(event)
+    flushJournal();
+    foldoverVertex = -1;
+
+    // Refine what the drag skipped without waiting for the idle timeout
+    if (isRefining())
+        refineTimer.start(0);
 }
 
 void MainView::mouseMoveEvent(QMouseEvent *event) {
@@ -690,14 +913,39 @@ void MainView::keyPressEvent(QKeyEvent* event) {
 }
 
 void MainView::editCoords(QPoint eventPos) {
+    TRACE_ZONE("MainView::editCoords");
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    levelManager.invalidate();
+    prefetchedMesh.clear();
+
+    // Skipped levels of an earlier drag only have to be refined once for their final state
+    bool deleting = QApplication::keyboardModifiers() & Qt::ShiftModifier;
+    if (deleting || refineVertex != selectedVertex || refineEditLevel != getEditSteps())
+        finishRefinement();
+
+    // Later events of a drag only scale the weights of the stencil, which is built
+    // while the levels still match the current displacement of the vertex
+    if (!coordsStencil.isValid(selectedVertex, getEditSteps(), originalMeshes.size())) {
+        finishRefinement();
+        buildCoordsStencil(originalMeshes, editedMeshes, limitMeshes, coordsEdits, selectedVertex, getEditSteps(), &coordsStencil);
+    }
+
     changedLimitCoordsIndices.clear();
     changedFacesIndices.clear();
-    if (QApplication::keyboardModifiers() & Qt::ShiftModifier) { // Delete
+    changedEdgesIndices.clear();
+    if (deleting) { // Delete
         // Prevent multiple delete
         if (coordsEdits[getEditSteps()][selectedVertex].edgeIndex > 0) {
             // Update coords only
             updateCoords(0);
             coordsEdits[getEditSteps()].remove(selectedVertex);
+            memoryReportDirty = true;
+            foldoverVertex = -1;
+            if (journal.isOpen()) {
+                flushJournal();
+                journal.appendCoordsEditRemoval(getEditSteps(), selectedVertex);
+            }
         }
         else {
             return;
@@ -713,35 +961,78 @@ void MainView::editCoords(QPoint eventPos) {
         Vertex *editedVertex = &editedMeshes[getEditSteps()].Vertices[selectedVertex];
         QVector2D originalCoordsEvent = computeInvertedLimitPointCoords(editedVertex, destinationLimitCoords);
 
-        // Check if edit is allowed
+        // Check if edit is allowed (reject edits that introduce a foldover)
+        Mesh *editedMesh = &editedMeshes[getEditSteps()];
+        if (foldoverVertex != selectedVertex) {
+            foldoverCache.clear();
+            wasSelfIntersecting = foldoverCache.isSelfIntersecting(editedMesh, selectedVertex);
+            foldoverVertex = selectedVertex;
+        }
+        QVector2D previousCoords = editedVertex->coords;
         editedVertex->coords = originalCoordsEvent; // Note: meshes need to be updated after this
-//        if (!isSelfIntersecting(&editedMeshes[getEditSteps()], selectedVertex)) {
+        foldoverCache.invalidate(editedMesh, selectedVertex);
+        if (wasSelfIntersecting || !foldoverCache.isSelfIntersecting(editedMesh, selectedVertex)) {
             // Compute coordinate edit
             Vertex originalVertex = originalMeshes[getEditSteps()].Vertices[selectedVertex];
             QVector2D originalCoordsDelta = originalCoordsEvent - originalVertex.coords;
+            if (!coordsEdits[getEditSteps()].contains(selectedVertex))
+                memoryReportDirty = true;
             CoordsEdit *ce = &coordsEdits[getEditSteps()][selectedVertex];
             *ce = computeCoordsEdit(originalVertex, originalCoordsDelta);
             updateCoords(1);
-//        }
+            // Only the final state of a drag is journaled, a drag of another vertex ends it too
+            if (journal.isOpen()) {
+                if (journalVertex != selectedVertex || journalLevel != getEditSteps())
+                    flushJournal();
+                journalVertex = selectedVertex;
+                journalLevel = getEditSteps();
+            }
+        } else {
+            editedVertex->coords = previousCoords;
+            foldoverCache.invalidate(editedMesh, selectedVertex);
+            return;
+        }
         // Update coords only
         //        updateCoords(1);
         //        recomputeMeshes();
     }
 
-    QElapsedTimer t;
-    t.start();
-    updateMeshForCurrentRenderer(1);
-    //    qDebug() << "update mesh:" << t.elapsed() << "ms";
-    if (isDiffComputed())
+    // A changed display level needs a full upload
+    updateMeshForCurrentRenderer(getDisplayLevel() == shownLevel ? 1 : 0);
+    if (isDiffComputed() && !(isRefining() && getLimitSubdivSteps() >= refineLevel))
         updateMeshLimitRenderer();
+
+    // Adapt the levels updated per event to the frame budget. A level costs about four times the
+    // one below it, so only add one when there is room for that.
+    float frameTime = frameTimer.nsecsElapsed() / 1e6;
+    int frameBudget = mainWindow->ui->FrameBudget->value();
+    dragLevels = qMin(dragLevels, originalMeshes.size() - 1 - getEditSteps());
+    if (frameTime > frameBudget && dragLevels > 0)
+        --dragLevels;
+    else if (4 * frameTime < frameBudget && isRefining())
+        ++dragLevels;
+    if (isRefining())
+        refineTimer.start(100);
+}
+
+void MainView::flushJournal() {
+    if (journalVertex != -1 && journal.isOpen() && coordsEdits.value(journalLevel).contains(journalVertex))
+        journal.appendCoordsEdit(journalLevel, journalVertex, coordsEdits[journalLevel][journalVertex]);
+    journalVertex = -1;
+    journalLevel = -1;
 }
 
 void MainView::editColor() {
+    TRACE_ZONE("MainView::editColor");
+    changedLimitCoordsIndices.clear();
     changedFacesIndices.clear();
     changedEdgesIndices.clear();
     // Return conditions
     if (!(isModelLoaded() && isEditingEnabled() && selectedEdges.size() > 0))
         return;
+    finishRefinement();
+    levelManager.invalidate();
+    prefetchedMesh.clear();
 
     // Set color for selected edges
     foreach (int edgeIndex, selectedEdges) {
@@ -764,6 +1055,10 @@ void MainView::editColor() {
         foreach (Face *f, threeRingFaces)
             e->affectedEdgeIndices << f->side->index;
 
+        if (journal.isOpen()) {
+            flushJournal();
+            journal.appendColorEdit(getEditSteps(), *e);
+        }
     }
 
     // Update color only
@@ -781,23 +1076,31 @@ void MainView::setMainWindow(MainWindow *mainWindow) {
 void MainView::updateShowWireframe() {
     foreach (SurfaceRenderer *renderer, renderers)
         renderer->setShowWireframe(mainWindow->ui->ShowWireframe->checkState());
+    limitFramebufferDirty = true;
 }
 
 void MainView::updateScaling() {
     foreach (SurfaceRenderer *renderer, renderers)
         renderer->setScaling(getScaleVector());
     pointRenderer->setScaling(getScaleVector());
+    limitFramebufferDirty = true;
+    updateViewRect();
+    scheduleAutoLevel();
 }
 
 void MainView::updateDisplacement() {
     foreach (SurfaceRenderer *renderer, renderers)
         renderer->setDisplacement(displacement);
     pointRenderer->setDisplacement(displacement);
+    limitFramebufferDirty = true;
+    updateViewRect();
+    scheduleAutoLevel();
 }
 
 void MainView::updateColorBands() {
     foreach (SurfaceRenderer *renderer, renderers)
         renderer->setColorBands(mainWindow->ui->ColorBands->value());
+    limitFramebufferDirty = true;
 }
 
 void MainView::updateTessLevel() {
@@ -805,11 +1108,49 @@ void MainView::updateTessLevel() {
         renderer->setTessLevel(mainWindow->ui->TessellationLevel->value());
 }
 
+void MainView::updateSegmentPixels() {
+    foreach (SurfaceRenderer *renderer, renderers)
+        renderer->setSegmentPixels(mainWindow->ui->SegmentPixels->value());
+}
+
+// For culling patches off screen
+void MainView::updateViewRect() {
+    QRectF viewRect = getViewRect();
+    foreach (SurfaceRenderer *renderer, renderers)
+        renderer->setViewRect(viewRect);
+}
+
+// In device pixels, which is what the segment length is measured in
+void MainView::updateViewportSize() {
+    QVector2D viewportSize = QVector2D(width(), height()) * devicePixelRatioF();
+    foreach (SurfaceRenderer *renderer, renderers)
+        renderer->setViewportSize(viewportSize);
+}
+
 void MainView::updateDiffScaling() {
     foreach (SurfaceRenderer *renderer, renderers)
         renderer->setDiffScaling(mainWindow->ui->DiffScale->value());
 }
 
+void MainView::updateColormap() {
+    if (!colormapTexture)
+        return;
+    makeCurrent();
+    uploadColormap();
+    doneCurrent();
+}
+
+void MainView::uploadColormap() {
+    QVector<QVector3D> colors = sampleColormap(mainWindow->ui->Colormap->currentText());
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, colormapTexture);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, colors.size(), 0, GL_RGB, GL_FLOAT, colors.constData());
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+}
+
 // ---
 
 void MainView::onMessageLogged( QOpenGLDebugMessage Message ) {
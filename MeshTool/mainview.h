@@ -12,11 +12,24 @@
 #include <QMouseEvent>
 #include <QtMath>
 #include <QOpenGLFramebufferObject>
+#include <QSharedPointer>
+#include <QTimer>
 
 #include <limits>
 #include "mainwindow.h"
 #include "mesh.h"
+#include "persistence.h"
 #include "tools/tools.h"
+#include "tools/levelpool.h"
+#include "tools/levelmanager.h"
+#include "tools/sparsehierarchy.h"
+#include "tools/foldover.h"
+#include "tools/coordsstencil.h"
+#include "tools/changeset.h"
+#include "tools/memoryusage.h"
+#include "tools/levelofdetail.h"
+#include "tools/colormap.h"
+#include "tools/poster.h"
 #include "coordsedit.h"
 #include "coloredit.h"
 #include "renderers/defaultrenderer.h"
@@ -26,6 +39,17 @@
 #include "renderers/featureadaptiverenderer.h"
 #include "renderers/pointrenderer.h"
 #include "renderers/linerenderer.h"
+#include "renderers/shaderprewarmer.h"
+#include "renderers/diffreduction.h"
+
+// Renderer buffers for the level above the displayed one, filled on a worker thread
+class PrefetchedMesh {
+public:
+  int level;
+  QString renderer;
+  QScopedPointer<RendererBuffers> buffers;
+  QAtomicInt ready;
+};
 
 class MainView : public QOpenGLWidget, protected QOpenGLFunctions_4_1_Core {
 
@@ -39,22 +63,27 @@ public:
 
   // Meshes
   Mesh inputMesh;
-  QVector<Mesh> originalMeshes, editedMeshes, limitMeshes;
-  QVector<QVector<int>> editableVertexIndices;
-  QVector<QVector<int>> gradientVertexIndices;
-  QVector<int> changedLimitCoordsIndices;
-  QVector<int> changedEdgesIndices;
-  QVector<int> changedFacesIndices;
+  LevelManager levelManager;
+  LevelPool<Mesh> &originalMeshes = levelManager.originalMeshes;
+  LevelPool<Mesh> &editedMeshes = levelManager.editedMeshes;
+  LevelPool<Mesh> &limitMeshes = levelManager.limitMeshes;
+  LevelPool<VertexClassification> &vertexClassifications = levelManager.vertexClassifications;
+  // Levels above level 0 refined around edits and irregularities only, for patch based display
+  LevelPool<SparseLevel> sparseLevels;
+  ChangeSet changedLimitCoordsIndices;
+  ChangeSet changedEdgesIndices;
+  ChangeSet changedFacesIndices;
 
   void setMesh(QString fileName);
 
   void recomputeMeshes();
-  void subdivide();
+  bool subdivide();
   void updateCoords(int editFlag);
   void updateColor();
   bool isModelLoaded();
   int getMaxComputedSubdivLevel();
-  CoordsEdit computeCoordsEdit(Vertex v, QVector2D deltaCoords);
+  const MemoryReport &getMemoryReport();
+  void setMemoryBudget(int megabytes);
 
 
   // Editing
@@ -63,6 +92,8 @@ public:
   void editCoords(QPoint eventPos);
   void editColor();
   void clearSelection();
+  EditJournal journal;
+  void flushJournal();
 
   // Updating renderers
   void updateMeshForCurrentRenderer(int update);
@@ -72,10 +103,21 @@ public:
   void updateDisplacement();
   void updateColorBands();
   void updateTessLevel();
+  void updateSegmentPixels();
+  void updateViewportSize();
+  void updateViewRect();
   void updateDiffScaling();
+  void updateColormap();
 
   void updateScale(float s);
 
+  // Offline render of the current view, width pixels wide, see tools/poster.h
+  bool savePoster(QString fileName, int width, QString *errorString);
+
+  // Automatic level of detail
+  void setAutoLevel(bool enabled);
+  void scheduleAutoLevel();
+
 protected:
   // OpenGL
   void initializeGL();
@@ -84,6 +126,7 @@ protected:
 
   // Events
   void mousePressEvent(QMouseEvent *event);
+  void mouseReleaseEvent(QMouseEvent *event);
   void mouseMoveEvent(QMouseEvent *event);
   void wheelEvent(QWheelEvent *event);
   void keyPressEvent(QKeyEvent *event);
@@ -96,20 +139,66 @@ private:
   // Logger
   QOpenGLDebugLogger* debugLogger;
 
+  // Progressive refinement of coordinate drags. Levels from refineLevel on miss the final
+  // state of the edit of refineVertex, made at refineEditLevel.
+  QTimer refineTimer;
+  int refineVertex = -1;
+  int refineEditLevel = -1;
+  int refineLevel = 0;
+  int dragLevels = 8; // Levels above the edit level updated per drag event
+  int shownLevel = -1; // Level in the current renderer
+  int getDisplayLevel();
+  CoordsStencil coordsStencil; // Of the vertex dragged last
+  // Foldover checks of a drag, whether the mesh folded over is only checked at its first event
+  FoldoverCache foldoverCache;
+  int foldoverVertex = -1; // -1 outside a drag
+  bool wasSelfIntersecting = false;
+  bool isRefining();
+  void finishRefinement();
+  void updateRefinementLabel();
+
+  // Prefetching
+  QTimer prefetchTimer;
+  QSharedPointer<PrefetchedMesh> prefetchedMesh;
+  bool usePrefetchedMesh(QString renderer);
+
+  // Automatic level of detail: the level whose control points lie within
+  // autoLevelPixels of the limit surface on screen, up to the Catmull-Clark
+  // steps. At most autoLevelScanVertices are measured per evaluation.
+  QTimer autoLevelTimer;
+  int autoLevel = -1; // -1 if off
+  float autoLevelPixels = 1;
+  int autoLevelScanVertices = 1 << 18;
+
   // Rendering
   QHash<QString, SurfaceRenderer*> renderers;
   PointRenderer *pointRenderer;
   LineRenderer *lineRenderer;
+  ShaderPrewarmer *shaderPrewarmer = nullptr;
   void renderPoints();
 
-  // Framebuffer
+  // Framebuffer. The limit surface is only rendered again when its mesh, the
+  // view or the viewport changed.
   QOpenGLFramebufferObject *limitFramebuffer, *diffFramebuffer;
+  bool limitFramebufferDirty = true;
+  GLuint colormapTexture = 0; // On texture unit 1, unit 0 holds the limit surface
+  void uploadColormap();
+  DiffReduction *diffReduction = nullptr;
+  QTimer diffReadbackTimer;
+
+  // Memory report for the info label, rebuilt when the edits or GL buffers changed
+  // or the level manager reports a different version of the level buffers
+  MemoryReport memoryReport;
+  bool memoryReportDirty = true;
+  int memoryReportVersion = -1;
 
   // Editing
   int selectedVertex = -1;
   QSet<int> selectedEdges;
   QSet<int> affectedVertex;
   QPoint lastEventPos;
+  int journalVertex = -1; // Coordinate edit of the current drag, journaled once it ends
+  int journalLevel = -1;
   void setSelected(QPoint point);
   QVector2D computeColorEditPointCoords(HalfEdge *e);
 
@@ -118,19 +207,28 @@ private:
   QVector2D displacement{0, 0};
   QVector2D getScaleVector();
   QVector2D getWorldCoords(QPoint point);
+  QRectF getViewRect();
 
   // Get ui information
   int getSubdivSteps();
   int getEditSteps();
   int getLimitSubdivSteps();
   bool isDiffComputed();
+  bool usesSparseLevels();
+  int getRequiredLevels();
   bool isEditingEnabled();
   float getBrushRadius();
   QVector3D getBrushColor();
+  QString changeSetLabel(const ChangeSet& changes, QString unit);
 
 
 private slots:
   void onMessageLogged(QOpenGLDebugMessage Message);
+  void onLevelsReady();
+  void prefetchNextLevel();
+  void refineNextLevel();
+  void updateAutoLevel();
+  void readDiffReduction();
 
 };
 
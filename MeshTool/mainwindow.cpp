@@ -1,7 +1,12 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "persistence.h"
+#include "tools/trace.h"
+#include "tools/colormap.h"
 #include <QDateTime>
+#include <QApplication>
+#include <QInputDialog>
+#include <QMessageBox>
 
 MainWindow::MainWindow(QWidget *parent) :  QMainWindow(parent), ui(new Ui::MainWindow) {
   qDebug() << "✓✓ MainWindow constructor";
@@ -11,12 +16,13 @@ MainWindow::MainWindow(QWidget *parent) :  QMainWindow(parent), ui(new Ui::MainW
   ui->Renderer->addItem("ACC2");
   ui->Renderer->addItem("GG");
   ui->Renderer->addItem("Feature Adaptive");
-  ui->ColormapPicture->setPixmap(QPixmap("./../MeshTool/images/plasma.png"));
+  ui->Colormap->addItems(colormapNames());
   setButtonColor(ui->EditColorButton, QColor(Qt::white));
   setColormapMaxLabel(ui->DiffScale->value());
   setMaxVisibleDiffLabel(0);
   setInfoLabel("");
   ui->MainDisplay->setMainWindow(this);
+  ui->MainDisplay->setMemoryBudget(ui->MemoryBudget->value());
   transparent = false;
 
 }
@@ -45,7 +51,20 @@ void MainWindow::on_Save_clicked() {
   QString fileName = QFileDialog::getSaveFileName(this, "Save File", MODEL_PATH, tr("Obj Files (*.obj)"));
   if (fileName.isNull())
     return;
-  save(fileName, ui->MainDisplay->inputMesh, ui->MainDisplay->coordsEdits, ui->MainDisplay->colorEdits);
+
+  // Release the journal on the old file before it is replaced
+  ui->MainDisplay->flushJournal();
+  ui->MainDisplay->journal.close();
+  if (save(fileName, ui->MainDisplay->inputMesh, ui->MainDisplay->coordsEdits, ui->MainDisplay->colorEdits) && ui->JournalEdits->isChecked())
+    ui->MainDisplay->journal.open(fileName);
+}
+
+void MainWindow::on_JournalEdits_toggled(bool checked) {
+  // Journaling starts with the next save, so the file always holds every edit
+  if (!checked) {
+    ui->MainDisplay->flushJournal();
+    ui->MainDisplay->journal.close();
+  }
 }
 
 void MainWindow::on_loadTriangleButton_clicked() {
@@ -79,15 +98,12 @@ void MainWindow::on_SubdivSteps_valueChanged(int value) {
     return;
   }
 
-  // Check if meshes have to be updated
-  if (value > ui->MainDisplay->getMaxComputedSubdivLevel()) {
-      //ui->MainDisplay->recomputeMeshes();
-      //only do needed subdivision instead of recomputing everything, save memory
-      ui->MainDisplay->subdivide();
-  }
+  // Missing levels are computed in the background, the renderer is updated once they are in
+  if (ui->MainDisplay->subdivide())
+    ui->MainDisplay->updateMeshForCurrentRenderer(false);
+  ui->MainDisplay->scheduleAutoLevel();
 
   // Update
-  ui->MainDisplay->updateMeshForCurrentRenderer(false);
   ui->MainDisplay->update();
 }
 
@@ -101,7 +117,12 @@ void MainWindow::on_EditSteps_valueChanged(int value) {
     return;
   }
 
+  // Sparse levels need the new edit level, which may not have been computed yet
+  if (ui->MainDisplay->isModelLoaded() && ui->MainDisplay->subdivide())
+    ui->MainDisplay->updateMeshForCurrentRenderer(false);
+
   // Update
+  ui->MainDisplay->scheduleAutoLevel();
   ui->MainDisplay->update();
 }
 
@@ -119,8 +140,15 @@ void MainWindow::on_ShowWireframe_toggled(bool checked) {
   ui->MainDisplay->update();
 }
 
+void MainWindow::on_AutoLevel_toggled(bool checked) {
+  ui->MainDisplay->setAutoLevel(checked);
+}
+
 void MainWindow::on_Renderer_currentIndexChanged(int index) {
-  ui->MainDisplay->updateMeshForCurrentRenderer(false);
+  // Uniform levels above the edit level are only needed by renderers without sparse levels
+  if (ui->MainDisplay->subdivide())
+    ui->MainDisplay->updateMeshForCurrentRenderer(false);
+  ui->MainDisplay->scheduleAutoLevel();
   ui->MainDisplay->update();
 }
 
@@ -129,6 +157,11 @@ void MainWindow::on_TessellationLevel_valueChanged(int value) {
   ui->MainDisplay->update();
 }
 
+void MainWindow::on_SegmentPixels_valueChanged(double value) {
+  ui->MainDisplay->updateSegmentPixels();
+  ui->MainDisplay->update();
+}
+
 void MainWindow::setButtonColor(QPushButton *button, QColor color) {
   QPalette pal = button->palette();
   pal.setColor(QPalette::Button, color);
@@ -155,36 +188,46 @@ void MainWindow::on_DisplayDifference_toggled(bool checked) {
     }
   if (!checked)
     setMaxVisibleDiffLabel(0);
-  else if (ui->DiffSubdivSteps->value() > ui->MainDisplay->getMaxComputedSubdivLevel())
-      ui->MainDisplay->subdivide();
-//    ui->MainDisplay->recomputeMeshes();
-
-  ui->MainDisplay->updateMeshLimitRenderer();
+  if (ui->MainDisplay->subdivide())
+    ui->MainDisplay->updateMeshLimitRenderer();
   ui->MainDisplay->update();
 }
 
 void MainWindow::on_DiffSubdivSteps_valueChanged(int value) {
   if (!ui->DisplayDifference->checkState())
     return;
-  if (value > ui->MainDisplay->getMaxComputedSubdivLevel())
-      ui->MainDisplay->subdivide();
-//    ui->MainDisplay->recomputeMeshes();
-  ui->MainDisplay->updateMeshLimitRenderer();
+  if (ui->MainDisplay->subdivide())
+    ui->MainDisplay->updateMeshLimitRenderer();
   ui->MainDisplay->update();
 }
 
+void MainWindow::on_MemoryBudget_valueChanged(int value) {
+  ui->MainDisplay->setMemoryBudget(value);
+}
+
 void MainWindow::on_DiffScale_valueChanged(int value) {
   ui->MainDisplay->updateDiffScaling();
   setColormapMaxLabel(value);
   ui->MainDisplay->update();
 }
 
+void MainWindow::on_Colormap_currentIndexChanged(int index) {
+  QVector<QVector3D> colors = sampleColormap(ui->Colormap->currentText());
+  QImage picture(colors.size(), 1, QImage::Format_RGB32);
+  for (int i = 0; i < colors.size(); ++i)
+    picture.setPixelColor(i, 0, QColor::fromRgbF(colors[i].x(), colors[i].y(), colors[i].z()));
+  ui->ColormapPicture->setPixmap(QPixmap::fromImage(picture));
+  ui->MainDisplay->updateColormap();
+  ui->MainDisplay->update();
+}
+
 void MainWindow::setColormapMaxLabel(int diffScale) {
   ui->ColormapMaxLabel->setText("<html><head/><body>Colormap ( 0 &le; difference &le; " + QString::number(diffScale == 0 ? 0 : 1.0 / diffScale, 'e', 2) + " )</body></html>");
 }
 
-void MainWindow::setMaxVisibleDiffLabel(float maxVisibleDiff) {
+void MainWindow::setMaxVisibleDiffLabel(float maxVisibleDiff, float meanVisibleDiff) {
   ui->MaxDiff->setText(QString::number(maxVisibleDiff, 'e', 2));
+  ui->MaxDiff->setToolTip("Mean " + QString::number(meanVisibleDiff, 'e', 2));
 }
 
 void MainWindow::setInfoLabel(QString text) {
@@ -230,6 +273,37 @@ void MainWindow::on_background_clicked() {
 
 }
 
+void MainWindow::on_recordTrace_toggled(bool checked) {
+  if (checked) {
+    startTrace();
+    return;
+  }
+  stopTrace();
+  QString fileName = QFileDialog::getSaveFileName(this, "Save Trace", "", tr("Trace Files (*.json)"));
+  if (fileName.isNull())
+    return;
+  writeTrace(fileName);
+}
+
+// Render the view at print resolution, in tiles instead of through the window
+void MainWindow::on_renderPoster_clicked() {
+  if (!ui->MainDisplay->isModelLoaded())
+    return;
+  bool ok;
+  int width = QInputDialog::getInt(this, "Render Poster", "Width in pixels", 8192, 16, 1 << 16, 1024, &ok);
+  if (!ok)
+    return;
+  QString fileName = QFileDialog::getSaveFileName(this, "Save Poster", "", tr("Images (*.tif *.tiff *.png)"));
+  if (fileName.isNull())
+    return;
+  QString errorString;
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  bool saved = ui->MainDisplay->savePoster(fileName, width, &errorString);
+  QApplication::restoreOverrideCursor();
+  if (!saved)
+    QMessageBox::warning(this, "Render Poster", errorString);
+}
+
 void MainWindow::on_scaleSpinBox_valueChanged(double value) {
         ui->MainDisplay->updateScale(value);
     }
@@ -28,12 +28,13 @@ public:
   ~MainWindow();
 
   void importOBJ(QString filename);
-  void setMaxVisibleDiffLabel(float maxVisibleDiff);
+  void setMaxVisibleDiffLabel(float maxVisibleDiff, float meanVisibleDiff = 0);
   void setInfoLabel(QString text);
 
 private slots: // TODO: reorganize
   void on_Load_clicked();
   void on_Save_clicked();
+  void on_JournalEdits_toggled(bool checked);
   void on_loadTriangleButton_clicked();
   void on_loadQuadButton_clicked();
   void on_loadPentagonButton_clicked();
@@ -43,15 +44,21 @@ private slots: // TODO: reorganize
   void on_BrushRadiusSpinBox_valueChanged(double value);
   void on_EnableEditing_toggled(bool checked);
   void on_ShowWireframe_toggled(bool checked);
+  void on_AutoLevel_toggled(bool checked);
   void on_Renderer_currentIndexChanged(int index);
   void on_TessellationLevel_valueChanged(int value);
+  void on_SegmentPixels_valueChanged(double value);
   void on_EditColorButton_clicked();
   void on_ColorBands_valueChanged(int value);
   void on_DisplayDifference_toggled(bool checked);
   void on_DiffSubdivSteps_valueChanged(int value);
   void on_DiffScale_valueChanged(int value);
+  void on_Colormap_currentIndexChanged(int index);
+  void on_MemoryBudget_valueChanged(int value);
   void on_screenShot_clicked();
   void on_background_clicked();
+  void on_recordTrace_toggled(bool checked);
+  void on_renderPoster_clicked();
   void on_scaleSpinBox_valueChanged(double value);
 
 private:
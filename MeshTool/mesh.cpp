@@ -1,30 +1,81 @@
 #include "mesh.h"
 #include "math.h"
+#include "tools/trace.h"
+
+// Count buffer growth of one element vector
+template <typename T>
+static void traceGrowth(const QVector<T> &vector, int previousCapacity) {
+  if (vector.capacity() > previousCapacity) {
+    TRACE_COUNT(TraceAllocations, 1);
+    TRACE_COUNT(TraceAllocatedBytes, qint64(vector.capacity() - previousCapacity) * sizeof(T));
+  }
+}
 
 Mesh Mesh::copy() {
   Mesh mesh;
-  mesh.Vertices.resize(this->Vertices.size());
-  mesh.Faces.resize(this->Faces.size());
-  mesh.HalfEdges.resize(this->HalfEdges.size());
+  copyTo(&mesh);
+  return mesh;
+}
+
+void Mesh::copyTo(Mesh *mesh) {
+  mesh->resize(this->Vertices.size(), this->HalfEdges.size(), this->Faces.size());
 
   for (int i = 0; i < this->Vertices.size(); ++i) {
-    mesh.Vertices[i] = this->Vertices[i];
-    mesh.Vertices[i].out = &mesh.HalfEdges[this->Vertices[i].out->index];
+    mesh->Vertices[i] = this->Vertices[i];
+    mesh->Vertices[i].out = &mesh->HalfEdges[this->Vertices[i].out->index];
   }
 
   for (int i = 0; i < this->Faces.size(); ++i) {
-    mesh.Faces[i] = this->Faces[i];
-    mesh.Faces[i].side = &mesh.HalfEdges[this->Faces[i].side->index];
+    mesh->Faces[i] = this->Faces[i];
+    mesh->Faces[i].side = &mesh->HalfEdges[this->Faces[i].side->index];
   }
 
   for (int i = 0; i < this->HalfEdges.size(); ++i) {
-    mesh.HalfEdges[i] = this->HalfEdges[i];
-    mesh.HalfEdges[i].target = &mesh.Vertices[this->HalfEdges[i].target->index];
-    mesh.HalfEdges[i].next = &mesh.HalfEdges[this->HalfEdges[i].next->index];
-    mesh.HalfEdges[i].prev = &mesh.HalfEdges[this->HalfEdges[i].prev->index];
-    mesh.HalfEdges[i].twin = &mesh.HalfEdges[this->HalfEdges[i].twin->index];
-    mesh.HalfEdges[i].polygon = this->HalfEdges[i].polygon ? &mesh.Faces[this->HalfEdges[i].polygon->index] : nullptr;
+    mesh->HalfEdges[i] = this->HalfEdges[i];
+    mesh->HalfEdges[i].target = &mesh->Vertices[this->HalfEdges[i].target->index];
+    mesh->HalfEdges[i].next = &mesh->HalfEdges[this->HalfEdges[i].next->index];
+    mesh->HalfEdges[i].prev = &mesh->HalfEdges[this->HalfEdges[i].prev->index];
+    mesh->HalfEdges[i].twin = &mesh->HalfEdges[this->HalfEdges[i].twin->index];
+    mesh->HalfEdges[i].polygon = this->HalfEdges[i].polygon ? &mesh->Faces[this->HalfEdges[i].polygon->index] : nullptr;
   }
+}
 
-  return mesh;
+void Mesh::clear() {
+  Vertices.resize(0);
+  Faces.resize(0);
+  HalfEdges.resize(0);
+}
+
+void Mesh::release() {
+  Vertices = QVector<Vertex>();
+  Faces = QVector<Face>();
+  HalfEdges = QVector<HalfEdge>();
+}
+
+// Swapping the vectors moves their buffers, so the pointers between elements need no fixing
+void Mesh::swap(Mesh &other) {
+  Vertices.swap(other.Vertices);
+  Faces.swap(other.Faces);
+  HalfEdges.swap(other.HalfEdges);
+}
+
+void Mesh::reserve(int vertices, int halfEdges, int faces) {
+  int capacities[3] = {Vertices.capacity(), HalfEdges.capacity(), Faces.capacity()};
+  Vertices.reserve(vertices);
+  HalfEdges.reserve(halfEdges);
+  Faces.reserve(faces);
+  traceGrowth(Vertices, capacities[0]);
+  traceGrowth(HalfEdges, capacities[1]);
+  traceGrowth(Faces, capacities[2]);
+}
+
+// Resize all element vectors, existing elements are kept
+void Mesh::resize(int vertices, int halfEdges, int faces) {
+  int capacities[3] = {Vertices.capacity(), HalfEdges.capacity(), Faces.capacity()};
+  Vertices.resize(vertices);
+  HalfEdges.resize(halfEdges);
+  Faces.resize(faces);
+  traceGrowth(Vertices, capacities[0]);
+  traceGrowth(HalfEdges, capacities[1]);
+  traceGrowth(Faces, capacities[2]);
 }
@@ -15,6 +15,16 @@ public:
   QVector<HalfEdge> HalfEdges;
 
   Mesh copy();
+  void copyTo(Mesh *mesh);
+
+  // Remove all elements but keep the allocated capacity
+  void clear();
+  // Remove all elements and free their memory
+  void release();
+  // Exchange the elements with another mesh, element addresses stay valid
+  void swap(Mesh &other);
+  void reserve(int vertices, int halfEdges, int faces);
+  void resize(int vertices, int halfEdges, int faces);
 
 };
 
@@ -2,6 +2,111 @@
 #include "vertex.h"
 #include "tools/tools.h"
 #include <QFile>
+#include <QSaveFile>
+
+// Write a single coordinate or color edit line
+static void writeCoordsEdit(QTextStream &out, int level, int vertexIndex, const CoordsEdit &coordsEdit) {
+  out << "ve " << level << " " << vertexIndex << " " << coordsEdit.edgeIndex << " " << coordsEdit.val1 << " " << coordsEdit.val2 << " " << coordsEdit.boundary << "\n";
+}
+
+static void writeColorEdit(QTextStream &out, int level, const ColorEdit &colorEdit) {
+  out << "ce " << level << " " << colorEdit.edgeIndex << " " << colorEdit.color.x() << " " << colorEdit.color.y() << " " << colorEdit.color.z() << "\n";
+}
+
+// Key of the halfedge running from vertex index "from" to vertex index "to"
+static inline quint64 halfEdgeKey(int from, int to) {
+  return (quint64(quint32(from)) << 32) | quint32(to);
+}
+
+void buildMesh(const QVector<QVector2D> &coords, const QVector<QVector<int>> &faces, Mesh *mesh) {
+  mesh->Vertices.clear();
+  mesh->Faces.clear();
+  mesh->HalfEdges.clear();
+
+  // Reserve enough memory, pointers into the vectors must stay valid
+  int sumFaceVal = 0;
+  foreach (const QVector<int> &vertexIndices, faces)
+    sumFaceVal += vertexIndices.size();
+  mesh->Vertices.reserve(coords.size());
+  mesh->Faces.reserve(faces.size());
+  mesh->HalfEdges.reserve(2 * sumFaceVal); // Worst case scenario
+
+  // Add vertices (out and val assigned later)
+  for (int i = 0; i < coords.size(); ++i) {
+    mesh->Vertices.append(Vertex());
+    Vertex *v = &mesh->Vertices.last();
+    v->coords = coords[i];
+    v->index = i;
+  }
+
+  foreach (const QVector<int> &vertexIndices, faces) {
+    // Keep index of first added halfedge
+    int firstEdgeIdx = mesh->HalfEdges.size();
+
+    // Initialize halfedges of face
+    mesh->HalfEdges.resize(mesh->HalfEdges.size() + vertexIndices.size());
+
+    // Add and initialize face
+    mesh->Faces.append(Face());
+    Face *f = &mesh->Faces.last();
+    f->side = &mesh->HalfEdges[firstEdgeIdx];
+    f->val = vertexIndices.size();
+    f->index = mesh->Faces.size() - 1;
+
+    // Initialize halfedges
+    for (int i = 0; i < vertexIndices.size(); ++i) {
+      // Update vertex values
+      if (!mesh->Vertices[vertexIndices[i]].out)
+        mesh->Vertices[vertexIndices[i]].out = &mesh->HalfEdges[firstEdgeIdx + (i + 1) % vertexIndices.size()];
+      ++mesh->Vertices[vertexIndices[i]].val;
+
+      // Assign halfedges (twins added later)
+      mesh->HalfEdges[firstEdgeIdx + i].target = &mesh->Vertices[vertexIndices[i]];
+      mesh->HalfEdges[firstEdgeIdx + i].next = &mesh->HalfEdges[firstEdgeIdx + (i + 1) % vertexIndices.size()];
+      mesh->HalfEdges[firstEdgeIdx + i].prev = &mesh->HalfEdges[firstEdgeIdx + (i - 1 + vertexIndices.size()) % vertexIndices.size()];
+      mesh->HalfEdges[firstEdgeIdx + i].polygon = f;
+      mesh->HalfEdges[firstEdgeIdx + i].index = firstEdgeIdx + i;
+    }
+  }
+
+  // Assign interior twins by looking up the reversed halfedge
+  QHash<quint64, int> halfEdgeIndices;
+  halfEdgeIndices.reserve(sumFaceVal);
+  for (int i = 0; i < sumFaceVal; ++i) {
+    HalfEdge *e = &mesh->HalfEdges[i];
+    halfEdgeIndices.insert(halfEdgeKey(e->prev->target->index, e->target->index), i);
+  }
+  for (int i = 0; i < sumFaceVal; ++i) {
+    HalfEdge *e1 = &mesh->HalfEdges[i];
+    int j = halfEdgeIndices.value(halfEdgeKey(e1->target->index, e1->prev->target->index), -1);
+    if (j != -1)
+      e1->twin = &mesh->HalfEdges[j];
+  }
+
+  // Add and assign boundary halfedges (prev and next assigned later)
+  for (int i = 0; i < sumFaceVal; ++i) {
+    HalfEdge *e1 = &(mesh->HalfEdges[i]);
+    if (!e1->twin) {
+      mesh->HalfEdges.append(HalfEdge());
+      HalfEdge *e2 = &mesh->HalfEdges.last();
+      e1->twin = e2;
+      e2->twin = e1;
+      e2->target = e1->prev->target;
+      ++e2->target->val;
+      e2->index = mesh->HalfEdges.size() - 1;
+    }
+  }
+
+  // Assign prev and next of boundary halfedges
+  for (int i = sumFaceVal; i < mesh->HalfEdges.size(); ++i) {
+    HalfEdge *e1 = &mesh->HalfEdges[i];
+    if (!e1->next) {
+      HalfEdge *e2 = getCCWBoundaryEdge(e1->target->out);
+      e1->next = e2;
+      e2->prev = e1;
+    }
+  }
+}
 
 void load(QString fileName, Mesh *mesh, QHash<int, QHash<int, CoordsEdit>> *coordsEdits, QHash<int, QHash<int, ColorEdit>> *colorEdits) {
   qDebug() << ":: Loading" << fileName;
@@ -28,70 +133,26 @@ void load(QString fileName, Mesh *mesh, QHash<int, QHash<int, CoordsEdit>> *coor
   // Create filestream
   QTextStream in(&file);
 
-  // First pass to reserve enough memory
-  int nVertices = 0;
-  int nFaces = 0;
-  int sumFaceVal = 0;
-  while(!in.atEnd()) {
-    QStringList values = in.readLine().split(' ');
-    if (values[0] == "v")
-      ++nVertices;
-    else if (values[0] == "f") {
-      ++nFaces;
-      sumFaceVal += values.size() - 1;
-    }
-  }
-  mesh->Vertices.reserve(nVertices);
-  mesh->Faces.reserve(nFaces);
-  mesh->HalfEdges.reserve(2 * sumFaceVal); // Worst case scenario
-
-  // Second pass to construct mesh
-  in.seek(0);
+  // Read coordinates, faces and edits
+  QVector<QVector2D> coords;
+  QVector<QVector<int>> faces;
   while(!in.atEnd()) {
     QString line = in.readLine();
     QStringList values = line.split(" ");
 
     if (values[0] == "v") {
-      // Add vertex (out and val assigned later)
-      mesh->Vertices.append(Vertex());
-      Vertex *v = &mesh->Vertices.last();
-      v->coords = QVector2D(values[1].toFloat(), values[2].toFloat());
-      v->index = mesh->Vertices.size() - 1;
+      coords.append(QVector2D(values[1].toFloat(), values[2].toFloat()));
     } else if (values[0] == "f") {
       // Get vertex indices
       QVector<int> vertexIndices;
       for (int i = 1; i < values.size(); ++i)
         vertexIndices.append(values[i].toInt() - 1);
-
-      // Keep index of first added halfedge
-      int firstEdgeIdx = mesh->HalfEdges.size();
-
-      // Initialize halfedges of face
-      mesh->HalfEdges.resize(mesh->HalfEdges.size() + vertexIndices.size());
-
-      // Add and initialize face
-      mesh->Faces.append(Face());
-      Face *f = &mesh->Faces.last();
-      f->side = &mesh->HalfEdges[firstEdgeIdx];
-      f->val = vertexIndices.size();
-      f->index = mesh->Faces.size() - 1;
-
-      // Initialize halfedges
-      for (int i = 0; i < vertexIndices.size(); ++i) {
-        // Update vertex values
-        if (!mesh->Vertices[vertexIndices[i]].out)
-          mesh->Vertices[vertexIndices[i]].out = &mesh->HalfEdges[firstEdgeIdx + (i + 1) % vertexIndices.size()];
-        ++mesh->Vertices[vertexIndices[i]].val;
-
-        // Assign halfedges (twins added later)
-        mesh->HalfEdges[firstEdgeIdx + i].target = &mesh->Vertices[vertexIndices[i]];
-        mesh->HalfEdges[firstEdgeIdx + i].next = &mesh->HalfEdges[firstEdgeIdx + (i + 1) % vertexIndices.size()];
-        mesh->HalfEdges[firstEdgeIdx + i].prev = &mesh->HalfEdges[firstEdgeIdx + (i - 1 + vertexIndices.size()) % vertexIndices.size()];
-        mesh->HalfEdges[firstEdgeIdx + i].polygon = f;
-        mesh->HalfEdges[firstEdgeIdx + i].index = firstEdgeIdx + i;
-      }
+      faces.append(vertexIndices);
     } else if (values[0] == "ve") {
       (*coordsEdits)[values[1].toInt()][values[2].toInt()] = CoordsEdit(values[3].toInt(), values[4].toFloat(), values[5].toFloat(), values[6].toInt());
+    } else if (values[0] == "vd") {
+      // Journaled removal of an earlier coordinate edit
+      (*coordsEdits)[values[1].toInt()].remove(values[2].toInt());
     } else if (values[0] == "ce") {
       (*colorEdits)[values[1].toInt()][values[2].toInt()] = ColorEdit(values[2].toInt(), QVector3D(values[3].toFloat(), values[4].toFloat(), values[5].toFloat()));
     }
@@ -100,41 +161,7 @@ void load(QString fileName, Mesh *mesh, QHash<int, QHash<int, CoordsEdit>> *coor
   // Close
   file.close();
 
-  // Assign interior twins
-  for (int i = 0; i < mesh->HalfEdges.size(); ++i) {
-    HalfEdge *e1 = &mesh->HalfEdges[i];
-    for (int j = i + 1; j < mesh->HalfEdges.size(); ++j) {
-      HalfEdge *e2 = &mesh->HalfEdges[j];
-      if (e1->target == e2->prev->target && e1->prev->target == e2->target) {
-        e1->twin = e2;
-        e2->twin = e1;
-      }
-    }
-  }
-
-  // Add and assign boundary halfedges (prev and next assigned later)
-  for (int i = 0; i < sumFaceVal; ++i) {
-    HalfEdge *e1 = &(mesh->HalfEdges[i]);
-    if (!e1->twin) {
-      mesh->HalfEdges.append(HalfEdge());
-      HalfEdge *e2 = &mesh->HalfEdges.last();
-      e1->twin = e2;
-      e2->twin = e1;
-      e2->target = e1->prev->target;
-      ++e2->target->val;
-      e2->index = mesh->HalfEdges.size() - 1;
-    }
-  }
-
-  // Assign prev and next of boundary halfedges
-  for (int i = sumFaceVal; i < mesh->HalfEdges.size(); ++i) {
-    HalfEdge *e1 = &mesh->HalfEdges[i];
-    if (!e1->next) {
-      HalfEdge *e2 = getCCWBoundaryEdge(e1->target->out);
-      e1->next = e2;
-      e2->prev = e1;
-    }
-  }
+  buildMesh(coords, faces, mesh);
 
   // Obtain max edit level
   int maxEditLevel = 0;
@@ -181,14 +208,14 @@ void load(QString fileName, Mesh *mesh, QHash<int, QHash<int, CoordsEdit>> *coor
 
 }
 
-void save(QString fileName, Mesh mesh, QHash<int, QHash<int, CoordsEdit>> coordsEdits, QHash<int, QHash<int, ColorEdit>> colorEdits) {
+bool save(QString fileName, const Mesh &mesh, const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits) {
   qDebug() << ":: Saving" << fileName;
 
-  // Open file
-  QFile file(fileName);
+  // Open file (written to a temporary file which replaces fileName on commit)
+  QSaveFile file(fileName);
   if(!file.open(QFile::WriteOnly | QFile::Text)) {
       qDebug() << " * Could not open file " << fileName << " for writing";
-      return;
+      return false;
   }
 
   // Create filestream
@@ -210,28 +237,64 @@ void save(QString fileName, Mesh mesh, QHash<int, QHash<int, CoordsEdit>> coords
   }
 
   // Write coordinate edits
-  for (int i = 0; i < coordsEdits.size(); ++i) {
-    int editLevel = coordsEdits.keys()[i];
-    QHash<int, CoordsEdit> hash = coordsEdits[editLevel];
-    for (int j = 0; j < hash.size(); ++j) {
-      int vertexIdx = hash.keys()[j];
-      CoordsEdit coordsEdit = hash[vertexIdx];
-      out << "ve " << editLevel << " " << vertexIdx << " " << coordsEdit.edgeIndex << " " << coordsEdit.val1 << " " << coordsEdit.val2 << " " << coordsEdit.boundary << "\n";
-    }
-  }
+  for (auto level = coordsEdits.constBegin(); level != coordsEdits.constEnd(); ++level)
+    for (auto edit = level.value().constBegin(); edit != level.value().constEnd(); ++edit)
+      writeCoordsEdit(out, level.key(), edit.key(), edit.value());
 
   // Write color edits
-  for (int i = 0; i < colorEdits.size(); ++i) {
-    int editLevel = colorEdits.keys()[i];
-    QHash<int, ColorEdit> hash = colorEdits[editLevel];
-    for (int j = 0; j < hash.size(); ++j) {
-      int vertexIdx = hash.keys()[j];
-      ColorEdit colorEdit = hash[vertexIdx];
-      out << "ce " << editLevel << " " << colorEdit.edgeIndex << " " << colorEdit.color.x() << " " << colorEdit.color.y() << " " << colorEdit.color.z() << "\n";
-    }
+  for (auto level = colorEdits.constBegin(); level != colorEdits.constEnd(); ++level)
+    for (auto edit = level.value().constBegin(); edit != level.value().constEnd(); ++edit)
+      writeColorEdit(out, level.key(), edit.value());
+
+  // Commit
+  out.flush();
+  if (out.status() != QTextStream::Ok || !file.commit()) {
+      qDebug() << " * Could not write file " << fileName;
+      return false;
   }
+  return true;
+}
 
-  // Close
-  file.flush();
+// ---
+
+EditJournal::~EditJournal() {
+  close();
+}
+
+bool EditJournal::open(QString fileName) {
+  close();
+  file.setFileName(fileName);
+  if (!file.open(QFile::WriteOnly | QFile::Append | QFile::Text)) {
+      qDebug() << " * Could not open file " << fileName << " for journaling";
+      return false;
+  }
+  out.setDevice(&file);
+  return true;
+}
+
+void EditJournal::close() {
+  if (!file.isOpen())
+    return;
+  out.flush();
+  out.setDevice(nullptr);
   file.close();
 }
+
+bool EditJournal::isOpen() {
+  return file.isOpen();
+}
+
+void EditJournal::appendCoordsEdit(int level, int vertexIndex, const CoordsEdit &coordsEdit) {
+  writeCoordsEdit(out, level, vertexIndex, coordsEdit);
+  out.flush();
+}
+
+void EditJournal::appendCoordsEditRemoval(int level, int vertexIndex) {
+  out << "vd " << level << " " << vertexIndex << "\n";
+  out.flush();
+}
+
+void EditJournal::appendColorEdit(int level, const ColorEdit &colorEdit) {
+  writeColorEdit(out, level, colorEdit);
+  out.flush();
+}
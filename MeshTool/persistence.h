@@ -3,12 +3,37 @@
 
 #include "mesh.h"
 #include <QVector>
+#include <QVector2D>
 #include <QString>
 #include <QHash>
+#include <QFile>
+#include <QTextStream>
 #include "coordsedit.h"
 #include "coloredit.h"
 
+// Build the halfedge structure of a polygon mesh, faces list 0-based vertex indices in CCW order
+void buildMesh(const QVector<QVector2D> &coords, const QVector<QVector<int>> &faces, Mesh *mesh);
 void load(QString fileName, Mesh *mesh, QHash<int, QHash<int, CoordsEdit>> *coordsEdits, QHash<int, QHash<int, ColorEdit>> *colorEdits);
-void save(QString fileName, Mesh mesh, QHash<int, QHash<int, CoordsEdit>> coordsEdits, QHash<int, QHash<int, ColorEdit>> colorEdits);
+bool save(QString fileName, const Mesh &mesh, const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits);
+
+// Append-only log of the edits made after a file was saved. Lines use the
+// same format as save() (plus "vd" for removed coordinate edits), so load()
+// replays them on top of the saved edits.
+class EditJournal {
+  public:
+    ~EditJournal();
+
+    bool open(QString fileName);
+    void close();
+    bool isOpen();
+
+    void appendCoordsEdit(int level, int vertexIndex, const CoordsEdit &coordsEdit);
+    void appendCoordsEditRemoval(int level, int vertexIndex);
+    void appendColorEdit(int level, const ColorEdit &colorEdit);
+
+  private:
+    QFile file;
+    QTextStream out;
+};
 
 #endif // PERSISTENCE_H
@@ -1,5 +1,6 @@
 #include "acc1renderer.h"
 #include "tools/tools.h"
+#include "tools/memoryusage.h"
 #include <QVector3D>
 #include <QElapsedTimer>
 
@@ -36,65 +37,96 @@ ACC1Renderer::~ACC1Renderer() {
 void ACC1Renderer::setData(QVector<float> data) {
     functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
     functions->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * data.size(), data.data(), GL_DYNAMIC_DRAW);
+    TRACE_COUNT(TraceUploadedBytes, sizeof(float) * data.size());
+    bufferBytes["VBO"] = sizeof(float) * data.size();
     controlPointsSize = data.size() / 5;
+
+    // Update bounds and draws
+    bounds.build(data.constData(), controlPointsSize / 16, 16);
+    drawList.clear();
+    drawList.add(shaderPrograms["ACC1"], VAO, 16, 0, controlPointsSize, 1, &bounds);
 };
 
 void ACC1Renderer::setMesh(Mesh& mesh) {
-    data.clear();
-    facesIndices.clear();
+    TRACE_ZONE("ACC1Renderer::setMesh");
+    QScopedPointer<RendererBuffers> buffers(prepareMesh(mesh));
+    setPreparedMesh(buffers.data());
+}
+
+RendererBuffers *ACC1Renderer::prepareMesh(Mesh& mesh) const {
+    TRACE_ZONE("ACC1Renderer::prepareMesh");
+    TRACE_COUNT(TraceFacesVisited, mesh.Faces.size());
+    ACC1Buffers *buffers = new ACC1Buffers();
+    buffers->facesIndices.fill(-1, mesh.Faces.size());
     int index = 0;
 
     // Collect data
-    //  QVector<float> data;
     foreach (Face f, mesh.Faces) {
         if (f.val == 4) {
-            addControlPoints(f, &data);
-            facesIndices[f.index] = index ++;
+            addControlPoints(f, &buffers->data);
+            buffers->facesIndices[f.index] = index ++;
         }
     }
+    return buffers;
+}
+
+// Take over the buffers of prepareMesh(), which are left empty
+void ACC1Renderer::setPreparedMesh(RendererBuffers *buffers) {
+    ACC1Buffers *acc1Buffers = (ACC1Buffers *) buffers;
+    data.swap(acc1Buffers->data);
+    facesIndices.swap(acc1Buffers->facesIndices);
+
     // Set data
     setData(data);
 }
 
-void ACC1Renderer::updateMeshCoords(Mesh& mesh, QVector<int>& influencedFacesIndices) {
-    foreach (int i, influencedFacesIndices) {
-        if (mesh.Faces[i].val == 4)
+void ACC1Renderer::updateMeshCoords(Mesh& mesh, const ChangeSet& influencedFacesIndices) {
+    TRACE_ZONE("ACC1Renderer::updateMeshCoords");
+    TRACE_COUNT(TraceFacesVisited, influencedFacesIndices.size());
+    QVector<QPair<int, int>> ranges;
+    foreach (int i, influencedFacesIndices.indices()) {
+        if (mesh.Faces[i].val == 4) {
             updateControlPoints(mesh.Faces[i], data, facesIndices[i], 1);
+            bounds.update(facesIndices[i], data.constData() + 80 * facesIndices[i], 16);
+            ranges << qMakePair(80 * facesIndices[i], 80);
+        }
     }
 
-    // Set data
-    setData(data);
+    // Upload the changed patches only
+    functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    uploadRanges(GL_ARRAY_BUFFER, data, ranges);
+    drawList.invalidateCulling();
 }
 
-void ACC1Renderer::updateMeshColors(Mesh& mesh, QVector<int>& influencedFacesIndices) {
-    foreach (int i, influencedFacesIndices) {
-        if (mesh.Faces[i].val == 4)
+void ACC1Renderer::updateMeshColors(Mesh& mesh, const ChangeSet& influencedFacesIndices) {
+    TRACE_ZONE("ACC1Renderer::updateMeshColors");
+    TRACE_COUNT(TraceFacesVisited, influencedFacesIndices.size());
+    QVector<QPair<int, int>> ranges;
+    foreach (int i, influencedFacesIndices.indices()) {
+        if (mesh.Faces[i].val == 4) {
             updateControlPoints(mesh.Faces[i], data, facesIndices[i], 2);
+            ranges << qMakePair(80 * facesIndices[i], 80);
+        }
     }
 
-    // Set data
-    setData(data);
+    // Upload the changed patches only, colors leave the bounds as they are
+    functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    uploadRanges(GL_ARRAY_BUFFER, data, ranges);
 }
 
 void ACC1Renderer::render() {
-    // Bind
-    functions->glBindVertexArray(VAO);
-    shaderPrograms["ACC1"]->bind();
-
-    // Draw
-    functions->glPatchParameteri(GL_PATCH_VERTICES, 16);
+    TRACE_ZONE("ACC1Renderer::render");
     functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
-    functions->glDrawArrays(GL_PATCHES, 0, controlPointsSize);
-
-    // Release
-    shaderPrograms["ACC1"]->release();
-    functions->glBindVertexArray(0);
+    drawList.cull(viewRect);
+    drawList.render(functions);
 }
 
 QHash<QString, int> ACC1Renderer::getCountInfo() {
     QHash<QString, int> countInfo;
     countInfo["faces"] = controlPointsSize / 16;
     countInfo["control points"] = controlPointsSize;
+    countInfo["draw calls"] = drawList.drawCalls();
+    countInfo["culled patches"] = drawList.culledPatches();
     return countInfo;
 }
 
@@ -168,9 +200,10 @@ QVector5D ACC1Renderer::computeCornerPoint(HalfEdge *inputEdge) {
     // Assign coords
     QVector2D coords;
     if (!isBoundaryVertex(v)) {
-        // Non-boundary case (ACC1 paper figure 4c)
+        // Non-boundary case (ACC1 paper figure 4c). Summed from v->out, so the patches
+        // around v get bit-identical corners and equal spacing does not crack their edges.
         coords = n * n * v->coords;
-        foreach (HalfEdge *e, getVertexEdges(inputEdge))
+        foreach (HalfEdge *e, getVertexEdges(v->out))
             coords += 4 * e->target->coords + e->next->target->coords;
         coords /= n * n + 5 * n;
     } else if (n == 2) {
@@ -186,7 +219,7 @@ QVector5D ACC1Renderer::computeCornerPoint(HalfEdge *inputEdge) {
     if (isSmoothVertex(v)) {
         // Similar to non-boundary case
         color = n * n * inputEdge->color;
-        foreach (HalfEdge *e, getVertexEdges(inputEdge))
+        foreach (HalfEdge *e, getVertexEdges(v->out))
             color += 4 * e->next->color + e->next->next->color;
         color /= n * n + 5 * n;
     } else if (getColorVertexVal(inputEdge) == 2) {
@@ -266,3 +299,11 @@ void ACC1Renderer::updateControlPoints(Face &f, QVector<float> &data, int faceIn
         }
     }
 }
+
+QHash<QString, qint64> ACC1Renderer::getMemoryInfo() {
+    QHash<QString, qint64> memoryInfo = SurfaceRenderer::getMemoryInfo();
+    memoryInfo["data"] = vectorBytes(data);
+    memoryInfo["facesIndices"] = vectorBytes(facesIndices);
+    memoryInfo["bounds"] = vectorBytes(bounds.data());
+    return memoryInfo;
+}
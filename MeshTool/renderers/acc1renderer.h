@@ -2,10 +2,20 @@
 #define ACC1RENDERER_H
 
 #include "surfacerenderer.h"
+#include "drawlist.h"
 #include "mesh.h"
 #include "qvector5d.h"
 #include <QVector>
 
+// Control points and patch index per face of a mesh
+class ACC1Buffers : public RendererBuffers {
+
+public:
+  QVector<float> data;
+  QVector<int> facesIndices;
+
+};
+
 class ACC1Renderer : public SurfaceRenderer {
 
 public:
@@ -13,10 +23,13 @@ public:
   ~ACC1Renderer();
   void setData(QVector<float> data);
   void setMesh(Mesh& mesh);
-  void updateMeshCoords(Mesh& mesh, QVector<int>& influencedFacesIndices);
-  void updateMeshColors(Mesh& mesh, QVector<int>& influencedFacesIndices);
+  RendererBuffers *prepareMesh(Mesh& mesh) const;
+  void setPreparedMesh(RendererBuffers *buffers);
+  void updateMeshCoords(Mesh& mesh, const ChangeSet& influencedFacesIndices);
+  void updateMeshColors(Mesh& mesh, const ChangeSet& influencedFacesIndices);
   void render();
   QHash<QString, int> getCountInfo();
+  QHash<QString, qint64> getMemoryInfo();
 
   static QVector5D computeInteriorPoint(HalfEdge *inputEdge);
   static QVector5D computeEdgePoint(HalfEdge *inputEdge, bool forward);
@@ -27,8 +40,10 @@ public:
 private:
   GLuint VAO, VBO;
   int controlPointsSize;
+  PatchBounds bounds;
+  DrawList drawList;
 
-  QHash<int, int> facesIndices;
+  QVector<int> facesIndices; // Patch index per face index, -1 for non-quads
   QVector<float> data;
 };
 
@@ -1,5 +1,6 @@
 #include "acc2renderer.h"
 #include "tools/tools.h"
+#include "tools/memoryusage.h"
 #include <QVector3D>
 #include <QtMath>
 
@@ -47,89 +48,118 @@ void ACC2Renderer::setData(QVector<float> dataTriangles, QVector<float> dataQuad
     controlPointsQuadsSize = dataQuads.size() / 5;
     functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
     functions->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * data.size(), data.data(), GL_DYNAMIC_DRAW);
+    TRACE_COUNT(TraceUploadedBytes, sizeof(float) * data.size());
+    bufferBytes["VBO"] = sizeof(float) * data.size();
+
+    // Update bounds and draws
+    boundsTriangles.build(dataTriangles.constData(), controlPointsTrianglesSize / 15, 15);
+    boundsQuads.build(dataQuads.constData(), controlPointsQuadsSize / 20, 20);
+    drawList.clear();
+    drawList.add(shaderPrograms["triangles"], VAO, 15, 0, controlPointsTrianglesSize, 1, &boundsTriangles);
+    drawList.add(shaderPrograms["quads"], VAO, 20, controlPointsTrianglesSize, controlPointsQuadsSize, 1, &boundsQuads);
 };
 
 void ACC2Renderer::setMesh(Mesh& mesh) {
-    dataTriangles.clear();
-    dataQuads.clear();
-    dataTrianglesIndices.clear();
-    dataQuadsIndices.clear();
+    TRACE_ZONE("ACC2Renderer::setMesh");
+    QScopedPointer<RendererBuffers> buffers(prepareMesh(mesh));
+    setPreparedMesh(buffers.data());
+}
+
+RendererBuffers *ACC2Renderer::prepareMesh(Mesh& mesh) const {
+    TRACE_ZONE("ACC2Renderer::prepareMesh");
+    TRACE_COUNT(TraceFacesVisited, mesh.Faces.size());
+    ACC2Buffers *buffers = new ACC2Buffers();
+    buffers->dataTrianglesIndices.fill(-1, mesh.Faces.size());
+    buffers->dataQuadsIndices.fill(-1, mesh.Faces.size());
     int triangleIndex = 0, quadIndex = 0;
 
     // Collect data
-    //  QVector<float> dataTriangles, dataQuads;
     foreach (Face f, mesh.Faces) {
         if (f.val == 3) {
-            ACC2Renderer::addControlPoints(f, &dataTriangles);
-            dataTrianglesIndices[f.index] = triangleIndex;
+            ACC2Renderer::addControlPoints(f, &buffers->dataTriangles);
+            buffers->dataTrianglesIndices[f.index] = triangleIndex;
             triangleIndex += 75;
         }
         else if (f.val == 4) {
-            ACC2Renderer::addControlPoints(f, &dataQuads);
-            dataQuadsIndices[f.index] = quadIndex;
+            ACC2Renderer::addControlPoints(f, &buffers->dataQuads);
+            buffers->dataQuadsIndices[f.index] = quadIndex;
             quadIndex += 100;
         }
 
     }
+    return buffers;
+}
+
+// Take over the buffers of prepareMesh(), which are left empty
+void ACC2Renderer::setPreparedMesh(RendererBuffers *buffers) {
+    ACC2Buffers *acc2Buffers = (ACC2Buffers *) buffers;
+    dataTrianglesIndices.swap(acc2Buffers->dataTrianglesIndices);
+    dataQuadsIndices.swap(acc2Buffers->dataQuadsIndices);
+    dataTriangles.swap(acc2Buffers->dataTriangles);
+    dataQuads.swap(acc2Buffers->dataQuads);
 
     // Set data
     setData(dataTriangles, dataQuads);
 }
 
-void ACC2Renderer::updateMeshCoords(Mesh& mesh, QVector<int>& influencedFacesIndices) {
-
-    foreach (int i, influencedFacesIndices) {
-        if (mesh.Faces[i].val == 3)
+void ACC2Renderer::updateMeshCoords(Mesh& mesh, const ChangeSet& influencedFacesIndices) {
+    TRACE_ZONE("ACC2Renderer::updateMeshCoords");
+    TRACE_COUNT(TraceFacesVisited, influencedFacesIndices.size());
+    QVector<QPair<int, int>> rangesTriangles, rangesQuads;
+    foreach (int i, influencedFacesIndices.indices()) {
+        if (mesh.Faces[i].val == 3) {
             updateControlPoints(mesh.Faces[i], dataTriangles, dataTrianglesIndices[i], 1);
-        if (mesh.Faces[i].val == 4)
+            boundsTriangles.update(dataTrianglesIndices[i] / 75, dataTriangles.constData() + dataTrianglesIndices[i], 15);
+            rangesTriangles << qMakePair(dataTrianglesIndices[i], 75);
+        }
+        if (mesh.Faces[i].val == 4) {
             updateControlPoints(mesh.Faces[i], dataQuads, dataQuadsIndices[i], 1);
+            boundsQuads.update(dataQuadsIndices[i] / 100, dataQuads.constData() + dataQuadsIndices[i], 20);
+            rangesQuads << qMakePair(dataQuadsIndices[i], 100);
+        }
     }
 
-    // Set data
-    setData(dataTriangles, dataQuads);
+    // Upload the changed patches only, the quads follow the triangles in the buffer
+    functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    uploadRanges(GL_ARRAY_BUFFER, dataTriangles, rangesTriangles);
+    uploadRanges(GL_ARRAY_BUFFER, dataQuads, rangesQuads, dataTriangles.size());
+    drawList.invalidateCulling();
 }
 
-void ACC2Renderer::updateMeshColors(Mesh& mesh, QVector<int>& influencedFacesIndices) {
-
-    foreach (int i, influencedFacesIndices) {
-        if (mesh.Faces[i].val == 3)
+void ACC2Renderer::updateMeshColors(Mesh& mesh, const ChangeSet& influencedFacesIndices) {
+    TRACE_ZONE("ACC2Renderer::updateMeshColors");
+    TRACE_COUNT(TraceFacesVisited, influencedFacesIndices.size());
+    QVector<QPair<int, int>> rangesTriangles, rangesQuads;
+    foreach (int i, influencedFacesIndices.indices()) {
+        if (mesh.Faces[i].val == 3) {
             updateControlPoints(mesh.Faces[i], dataTriangles, dataTrianglesIndices[i], 2);
-        if (mesh.Faces[i].val == 4)
+            rangesTriangles << qMakePair(dataTrianglesIndices[i], 75);
+        }
+        if (mesh.Faces[i].val == 4) {
             updateControlPoints(mesh.Faces[i], dataQuads, dataQuadsIndices[i], 2);
+            rangesQuads << qMakePair(dataQuadsIndices[i], 100);
+        }
     }
 
-    // Set data
-    setData(dataTriangles, dataQuads);
+    // Upload the changed patches only, colors leave the bounds as they are
+    functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    uploadRanges(GL_ARRAY_BUFFER, dataTriangles, rangesTriangles);
+    uploadRanges(GL_ARRAY_BUFFER, dataQuads, rangesQuads, dataTriangles.size());
 }
 
 void ACC2Renderer::render() {
-    // Bind
-    functions->glBindVertexArray(VAO);
-    shaderPrograms["triangles"]->bind();
-
-    // Draw triangles
-    functions->glPatchParameteri(GL_PATCH_VERTICES, 15);
+    TRACE_ZONE("ACC2Renderer::render");
     functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
-    functions->glDrawArrays(GL_PATCHES, 0, controlPointsTrianglesSize);
-
-    // Switch shader program
-    shaderPrograms["triangles"]->release();
-    shaderPrograms["quads"]->bind();
-
-    // Draw quads
-    functions->glPatchParameteri(GL_PATCH_VERTICES, 20);
-    functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
-    functions->glDrawArrays(GL_PATCHES, controlPointsTrianglesSize, controlPointsQuadsSize);
-
-    // Release
-    shaderPrograms["triangles"]->release();
-    functions->glBindVertexArray(0);
+    drawList.cull(viewRect);
+    drawList.render(functions);
 }
 
 QHash<QString, int> ACC2Renderer::getCountInfo() {
     QHash<QString, int> countInfo;
     countInfo["faces"] = controlPointsQuadsSize / 20 + controlPointsTrianglesSize / 15;
     countInfo["control points"] = controlPointsQuadsSize + controlPointsTrianglesSize;
+    countInfo["draw calls"] = drawList.drawCalls();
+    countInfo["culled patches"] = drawList.culledPatches();
     return countInfo;
 }
 
@@ -545,3 +575,12 @@ float ACC2Renderer::lambda(int n) {
     // (ACC2 paper section 3.3)
     return (5 + cos(2 * M_PI / n) + cos(M_PI / n) * sqrt(18 + 2 * cos(2 * M_PI / n))) / 16;
 }
+
+QHash<QString, qint64> ACC2Renderer::getMemoryInfo() {
+    QHash<QString, qint64> memoryInfo = SurfaceRenderer::getMemoryInfo();
+    memoryInfo["dataTriangles"] = vectorBytes(dataTriangles);
+    memoryInfo["dataQuads"] = vectorBytes(dataQuads);
+    memoryInfo["dataIndices"] = vectorBytes(dataTrianglesIndices) + vectorBytes(dataQuadsIndices);
+    memoryInfo["bounds"] = vectorBytes(boundsTriangles.data()) + vectorBytes(boundsQuads.data());
+    return memoryInfo;
+}
@@ -2,11 +2,23 @@
 #define ACC2RENDERER_H
 
 #include "surfacerenderer.h"
+#include "drawlist.h"
 #include "mesh.h"
 #include "qvector5d.h"
 #include <QVector>
 #include <QVector2D>
 
+// Control points of the triangles and quads of a mesh, with their offsets per face
+class ACC2Buffers : public RendererBuffers {
+
+public:
+  QVector<int> dataTrianglesIndices;
+  QVector<int> dataQuadsIndices;
+  QVector<float> dataTriangles;
+  QVector<float> dataQuads;
+
+};
+
 class ACC2Renderer : public SurfaceRenderer {
 
 public:
@@ -14,10 +26,13 @@ public:
   ~ACC2Renderer();
   void setData(QVector<float> dataTriangles, QVector<float> dataQuads);
   void setMesh(Mesh& mesh);
-  void updateMeshCoords(Mesh& mesh, QVector<int>& influencedFacesIndices);
-  void updateMeshColors(Mesh& mesh, QVector<int>& influencedFacesIndices);
+  RendererBuffers *prepareMesh(Mesh& mesh) const;
+  void setPreparedMesh(RendererBuffers *buffers);
+  void updateMeshCoords(Mesh& mesh, const ChangeSet& influencedFacesIndices);
+  void updateMeshColors(Mesh& mesh, const ChangeSet& influencedFacesIndices);
   void render();
   QHash<QString, int> getCountInfo();
+  QHash<QString, qint64> getMemoryInfo();
 
   static QVector5D computeCornerPoint(HalfEdge *inputEdge);
   static QVector5D computeEdgePoint(HalfEdge *inputEdge, QVector5D p, bool forward);
@@ -28,12 +43,14 @@ public:
 private:
   GLuint VAO, VBO;
   int controlPointsQuadsSize, controlPointsTrianglesSize;
+  PatchBounds boundsTriangles, boundsQuads;
+  DrawList drawList;
 
   static float sigma(int n);
   static float lambda(int n);
 
-  QHash<int, int> dataTrianglesIndices;
-  QHash<int, int> dataQuadsIndices;
+  QVector<int> dataTrianglesIndices; // Data offsets per face index, -1 if not present
+  QVector<int> dataQuadsIndices;
   QVector<float> dataTriangles;
   QVector<float> dataQuads;
 
@@ -1,8 +1,10 @@
 #include "defaultrenderer.h"
 #include "tools/tools.h"
 #include "qvector5d.h"
+#include "tools/memoryusage.h"
 #include <QVector3D>
 #include <QElapsedTimer>
+#include <algorithm>
 
 DefaultRenderer::DefaultRenderer(QOpenGLFunctions_4_1_Core *functions) : SurfaceRenderer(functions) {
     // Create shader program
@@ -45,89 +47,165 @@ DefaultRenderer::~DefaultRenderer() {
 void DefaultRenderer::setData(QVector<float> data) {
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * data.size(), data.data(), GL_DYNAMIC_DRAW);
+    TRACE_COUNT(TraceUploadedBytes, sizeof(float) * data.size());
+    bufferBytes["VBO"] = sizeof(float) * data.size();
 };
 
 void DefaultRenderer::setIndices(QVector<int> indices) {
     indicesSize = indices.size();
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
+    TRACE_COUNT(TraceUploadedBytes, sizeof(int) * indices.size());
+    bufferBytes["IBO"] = sizeof(int) * indices.size();
 }
 
 void DefaultRenderer::setMesh(Mesh& mesh) {
+    TRACE_ZONE("DefaultRenderer::setMesh");
+    QScopedPointer<RendererBuffers> buffers(prepareMesh(mesh));
+    setPreparedMesh(buffers.data());
+}
+
+RendererBuffers *DefaultRenderer::prepareMesh(Mesh& mesh) const {
+    TRACE_ZONE("DefaultRenderer::prepareMesh");
+    TRACE_COUNT(TraceFacesVisited, mesh.Faces.size());
     // Initialize
-    data.clear();
-    indices.clear();
-    vertexIndices.clear();
-    edgesIndices.clear();
+    DefaultBuffers *buffers = new DefaultBuffers();
+    buffers->edgesIndices.fill(-1, mesh.HalfEdges.size());
+    buffers->vertexSlotOffsets.fill(0, mesh.Vertices.size() + 1);
     int curIndex = 0;
     int index = 0;
 
     // Collect data
     foreach (Face f, mesh.Faces) {
+        buffers->faceOffsets << curIndex;
         foreach (HalfEdge *e, getFaceEdges(f.side)) {
-            data << QVector5D(e->prev->target->coords, e->color);
-            indices << curIndex++;
-            //            vertexIndices << e->prev->target->index;
-            vertexIndices[e->prev->target->index].append(index);
-            edgesIndices[e->index] = index;
+            buffers->data << QVector5D(e->prev->target->coords, e->color);
+            buffers->indices << curIndex++;
+            buffers->vertexSlotOffsets[e->prev->target->index + 1]++;
+            buffers->edgesIndices[e->index] = index;
             index += 5;
         }
-        indices << (unsigned int) -1;
+        buffers->indices << (unsigned int) -1;
+    }
+
+    buffers->faceOffsets << curIndex;
+
+    // Turn counts into offsets and fill the vertex slots
+    for (int i = 0; i < mesh.Vertices.size(); ++i)
+        buffers->vertexSlotOffsets[i + 1] += buffers->vertexSlotOffsets[i];
+    buffers->vertexSlots.resize(curIndex);
+    QVector<int> fill = buffers->vertexSlotOffsets;
+    for (int i = 0; i < mesh.HalfEdges.size(); ++i) {
+        if (buffers->edgesIndices[i] >= 0)
+            buffers->vertexSlots[fill[mesh.HalfEdges[i].prev->target->index]++] = buffers->edgesIndices[i];
     }
+    buffers->faces = mesh.Faces.size();
+    return buffers;
+}
+
+// Take over the buffers of prepareMesh(), which are left empty
+void DefaultRenderer::setPreparedMesh(RendererBuffers *buffers) {
+    DefaultBuffers *defaultBuffers = (DefaultBuffers *) buffers;
+    vertexSlotOffsets.swap(defaultBuffers->vertexSlotOffsets);
+    vertexSlots.swap(defaultBuffers->vertexSlots);
+    edgesIndices.swap(defaultBuffers->edgesIndices);
+    data.swap(defaultBuffers->data);
+    indices.swap(defaultBuffers->indices);
+    faceOffsets.swap(defaultBuffers->faceOffsets);
 
     // Set data
     setData(data);
     setIndices(indices);
     controlPointsSize = data.size() / 5;
-    faces = mesh.Faces.size();
+    faces = defaultBuffers->faces;
+    updateBounds();
 }
 
-void DefaultRenderer::updateMeshCoords(Mesh& mesh, QVector<int>& changedLimitCoordsIndices) {
-
-    foreach (int i, changedLimitCoordsIndices) {
-        foreach (int v, vertexIndices[i]) {
+void DefaultRenderer::updateMeshCoords(Mesh& mesh, const ChangeSet& changedLimitCoordsIndices) {
+    TRACE_ZONE("DefaultRenderer::updateMeshCoords");
+    QVector<QPair<int, int>> ranges;
+    QVector<int> changedFaces;
+    foreach (int i, changedLimitCoordsIndices.indices()) {
+        for (int k = vertexSlotOffsets[i]; k < vertexSlotOffsets[i + 1]; ++k) {
+            int v = vertexSlots[k];
             data[v] = mesh.Vertices[i].coords.x();
             data[v + 1] = mesh.Vertices[i].coords.y();
+            ranges << qMakePair(v, 2);
+            changedFaces << std::upper_bound(faceOffsets.constBegin(), faceOffsets.constEnd(), v / 5) - faceOffsets.constBegin() - 1;
         }
     }
 
-    // Set data
-    setData(data);
-    setIndices(indices);
-    controlPointsSize = data.size() / 5;
-    faces = mesh.Faces.size();
+    // Upload the changed corners only and update the bounds of their faces
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    uploadRanges(GL_ARRAY_BUFFER, data, ranges);
+    std::sort(changedFaces.begin(), changedFaces.end());
+    changedFaces.erase(std::unique(changedFaces.begin(), changedFaces.end()), changedFaces.end());
+    foreach (int f, changedFaces)
+        faceBounds.update(f, data.constData() + 5 * faceOffsets[f], faceOffsets[f + 1] - faceOffsets[f]);
+    cullingValid = false;
 }
 
-void DefaultRenderer::updateMeshColors(Mesh& mesh, QVector<int>& changedEdgesIndices) {
-
-    foreach (int i, changedEdgesIndices) {
+void DefaultRenderer::updateMeshColors(Mesh& mesh, const ChangeSet& changedEdgesIndices) {
+    TRACE_ZONE("DefaultRenderer::updateMeshColors");
+    QVector<QPair<int, int>> ranges;
+    foreach (int i, changedEdgesIndices.indices()) {
         HalfEdge *e = &mesh.HalfEdges[i];
-        int index = i;
-        int eIndex = edgesIndices[index];
+        int eIndex = edgesIndices[i];
+        if (eIndex < 0)
+            continue;
         data[eIndex + 2] = e->color.x();
         data[eIndex + 3] = e->color.y();
         data[eIndex + 4] = e->color.z();
+        ranges << qMakePair(eIndex + 2, 3);
     }
-    // Set data
-    setData(data);
-    setIndices(indices);
-    controlPointsSize = data.size() / 5;
-    faces = mesh.Faces.size();
+
+    // Upload the changed corners only
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    uploadRanges(GL_ARRAY_BUFFER, data, ranges);
+}
+
+void DefaultRenderer::updateBounds() {
+    faceBounds.clear();
+    for (int i = 0; i + 1 < faceOffsets.size(); ++i)
+        faceBounds.add(data.constData() + 5 * faceOffsets[i], faceOffsets[i + 1] - faceOffsets[i]);
+    cullingValid = false;
+}
+
+// Face i starts at index faceOffsets[i] + i, after the restart index of every
+// face before it. A run of faces keeps its inner restart indices.
+void DefaultRenderer::cull() {
+    if (cullingValid && viewRect == culledRect)
+        return;
+    TRACE_ZONE("DefaultRenderer::cull");
+    QVector<int> runFirsts, runCounts;
+    culledFaces = faceBounds.cull(viewRect, &runFirsts, &runCounts);
+    visibleCounts.clear();
+    visibleOffsets.clear();
+    for (int i = 0; i < runFirsts.size(); ++i) {
+        int first = runFirsts[i], last = runFirsts[i] + runCounts[i];
+        int start = faceOffsets[first] + first;
+        visibleCounts.append(faceOffsets[last] + last - 1 - start);
+        visibleOffsets.append((const void *) (sizeof(int) * start));
+    }
+    culledRect = viewRect;
+    cullingValid = true;
 }
 
 void DefaultRenderer::render() {
+    TRACE_ZONE("DefaultRenderer::render");
+    cull();
+
     // Bind
     glBindVertexArray(VAO);
     shaderPrograms["default"]->bind();
 
     // Draw
-    if (showWireframe) {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glDrawElements(GL_LINE_LOOP, indicesSize, GL_UNSIGNED_INT, 0);
-    } else {
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-        glDrawElements(GL_TRIANGLE_FAN, indicesSize, GL_UNSIGNED_INT, 0);
-    }
+    glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
+    GLenum mode = showWireframe ? GL_LINE_LOOP : GL_TRIANGLE_FAN;
+    if (culledFaces == 0)
+        glDrawElements(mode, indicesSize, GL_UNSIGNED_INT, 0);
+    else if (!visibleCounts.isEmpty())
+        functions->glMultiDrawElements(mode, visibleCounts.constData(), GL_UNSIGNED_INT, visibleOffsets.constData(), visibleCounts.size());
 
     // Release
     shaderPrograms["default"]->release();
@@ -138,5 +216,16 @@ QHash<QString, int> DefaultRenderer::getCountInfo() {
     QHash<QString, int> countInfo;
     countInfo["faces"] = faces;
     countInfo["control points"] = controlPointsSize;
+    countInfo["culled patches"] = culledFaces;
     return countInfo;
 }
+
+QHash<QString, qint64> DefaultRenderer::getMemoryInfo() {
+    QHash<QString, qint64> memoryInfo = SurfaceRenderer::getMemoryInfo();
+    memoryInfo["data"] = vectorBytes(data);
+    memoryInfo["indices"] = vectorBytes(indices);
+    memoryInfo["edgesIndices"] = vectorBytes(edgesIndices);
+    memoryInfo["vertexSlots"] = vectorBytes(vertexSlotOffsets) + vectorBytes(vertexSlots);
+    memoryInfo["bounds"] = vectorBytes(faceOffsets) + vectorBytes(faceBounds.data());
+    return memoryInfo;
+}
@@ -2,33 +2,63 @@
 #define DEFAULTRENDERER_H
 
 #include "surfacerenderer.h"
+#include "patchbounds.h"
 #include "mesh.h"
 #include <QVector>
 
+// Corner data of the faces of a mesh, with the offsets per halfedge and vertex
+class DefaultBuffers : public RendererBuffers {
+
+public:
+    QVector<int> vertexSlotOffsets, vertexSlots;
+    QVector<int> edgesIndices;
+    QVector<float> data;
+    QVector<int> indices;
+    QVector<int> faceOffsets; // Corner offset per face, and the total at the end
+    int faces = 0;
+
+};
+
 class DefaultRenderer : public SurfaceRenderer {
 
 public:
     DefaultRenderer(QOpenGLFunctions_4_1_Core *functions);
     ~DefaultRenderer();
     void setMesh(Mesh& mesh);
-    void updateMeshCoords(Mesh& mesh, QVector<int>& changedLimitCoordsIndices);
-    void updateMeshColors(Mesh& mesh, QVector<int>& changedEdgesIndices);
+    RendererBuffers *prepareMesh(Mesh& mesh) const;
+    void setPreparedMesh(RendererBuffers *buffers);
+    void updateMeshCoords(Mesh& mesh, const ChangeSet& changedLimitCoordsIndices);
+    void updateMeshColors(Mesh& mesh, const ChangeSet& changedEdgesIndices);
     void render();
     QHash<QString, int> getCountInfo();
+    QHash<QString, qint64> getMemoryInfo();
 
 private:
     void setData(QVector<float> data);
     void setIndices(QVector<int> indices);
+    void updateBounds();
+    void cull();
 
     GLuint VAO, VBO, IBO;
     int indicesSize;
     int controlPointsSize;
     int faces;
 
-    QHash<int, QVector<int>> vertexIndices;
-    QHash<int, int> edgesIndices;
+    // Data offsets per vertex, the offsets of vertex i are
+    // vertexSlots[vertexSlotOffsets[i] .. vertexSlotOffsets[i + 1]]
+    QVector<int> vertexSlotOffsets, vertexSlots;
+    QVector<int> edgesIndices; // Data offset per halfedge index, -1 if not drawn
     QVector<float> data;
     QVector<int> indices;
+
+    // Faces are drawn as runs of consecutive faces that intersect the view
+    QVector<int> faceOffsets;
+    PatchBounds faceBounds;
+    QVector<GLsizei> visibleCounts;
+    QVector<const void *> visibleOffsets;
+    QRectF culledRect;
+    bool cullingValid = false;
+    int culledFaces = 0;
 };
 
 #endif // DEFAULTRENDERER_H
@@ -0,0 +1,136 @@
+#include "diffreduction.h"
+#include "tools/trace.h"
+
+DiffReduction::DiffReduction(QOpenGLFunctions_4_1_Core *functions) {
+  // Set OpenGL functions
+  this->functions = functions;
+
+  // Create shader program
+  shaderProgram = new QOpenGLShaderProgram();
+  shaderProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/reduce/vertshader.glsl");
+  shaderProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/reduce/fragshader.glsl");
+  shaderProgram->link();
+  shaderProgram->bind();
+  shaderProgram->setUniformValue("source", 0);
+  shaderProgram->release();
+
+  // Core profiles need a VAO even without attributes
+  functions->glGenVertexArrays(1, &VAO);
+
+  // Create pixel buffers for one texel each
+  functions->glGenBuffers(Readbacks, PBOs);
+  for (int i = 0; i < Readbacks; ++i) {
+    functions->glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[i]);
+    functions->glBufferData(GL_PIXEL_PACK_BUFFER, 4 * sizeof(float), nullptr, GL_STREAM_READ);
+    fences[i] = nullptr;
+  }
+  functions->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+DiffReduction::~DiffReduction() {
+  clear();
+  for (int i = 0; i < Readbacks; ++i) {
+    if (fences[i])
+      functions->glDeleteSync(fences[i]);
+  }
+  functions->glDeleteBuffers(Readbacks, PBOs);
+  functions->glDeleteVertexArrays(1, &VAO);
+  delete shaderProgram;
+}
+
+void DiffReduction::clear() {
+  functions->glDeleteFramebuffers(framebuffers.size(), framebuffers.constData());
+  functions->glDeleteTextures(textures.size(), textures.constData());
+  framebuffers.clear();
+  textures.clear();
+  sizes.clear();
+}
+
+// Allocates the chain of halved targets for a source of the given size
+void DiffReduction::resize(int width, int height) {
+  clear();
+  GLint boundFramebuffer;
+  functions->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &boundFramebuffer);
+  while (width > 1 || height > 1) {
+    width = (width + 1) / 2;
+    height = (height + 1) / 2;
+    GLuint texture, framebuffer;
+    functions->glGenTextures(1, &texture);
+    functions->glBindTexture(GL_TEXTURE_2D, texture);
+    functions->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, nullptr);
+    functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    functions->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    functions->glGenFramebuffers(1, &framebuffer);
+    functions->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    functions->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    textures.append(texture);
+    framebuffers.append(framebuffer);
+    sizes.append(QSize(width, height));
+  }
+  functions->glBindTexture(GL_TEXTURE_2D, 0);
+  functions->glBindFramebuffer(GL_FRAMEBUFFER, boundFramebuffer);
+}
+
+// Restores the bound framebuffer and texture, the caller resets the viewport
+void DiffReduction::reduce(GLuint texture) {
+  TRACE_ZONE("DiffReduction::reduce");
+  // Skip the frame rather than wait when every readback is still in flight
+  if (textures.isEmpty() || pending == Readbacks)
+    return;
+  GLint boundFramebuffer, boundTexture;
+  functions->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &boundFramebuffer);
+  functions->glActiveTexture(GL_TEXTURE0);
+  functions->glGetIntegerv(GL_TEXTURE_BINDING_2D, &boundTexture);
+
+  shaderProgram->bind();
+  functions->glBindVertexArray(VAO);
+  GLuint source = texture;
+  for (int i = 0; i < textures.size(); ++i) {
+    functions->glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+    functions->glViewport(0, 0, sizes[i].width(), sizes[i].height());
+    functions->glBindTexture(GL_TEXTURE_2D, source);
+    functions->glDrawArrays(GL_TRIANGLES, 0, 3);
+    source = textures[i];
+  }
+  functions->glBindVertexArray(0);
+  shaderProgram->release();
+
+  // Copy the last texel into the next pixel buffer
+  int readback = (first + pending) % Readbacks;
+  functions->glReadBuffer(GL_COLOR_ATTACHMENT0);
+  functions->glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[readback]);
+  functions->glReadPixels(0, 0, 1, 1, GL_RGBA, GL_FLOAT, nullptr);
+  functions->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  fences[readback] = functions->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  functions->glFlush();
+  ++pending;
+
+  functions->glBindTexture(GL_TEXTURE_2D, boundTexture);
+  functions->glBindFramebuffer(GL_FRAMEBUFFER, boundFramebuffer);
+}
+
+// Returns whether a reduction finished since the last call, with the most recent result
+bool DiffReduction::poll(float *maxDiff, float *meanDiff) {
+  bool finished = false;
+  while (pending > 0) {
+    GLenum status = functions->glClientWaitSync(fences[first], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      break;
+    functions->glDeleteSync(fences[first]);
+    fences[first] = nullptr;
+
+    functions->glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[first]);
+    const float *result = (const float *) functions->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4 * sizeof(float), GL_MAP_READ_BIT);
+    if (result) {
+      *maxDiff = result[0];
+      *meanDiff = result[2] > 0 ? result[1] / result[2] : 0;
+      functions->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      finished = true;
+    }
+    functions->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    first = (first + 1) % Readbacks;
+    --pending;
+  }
+  return finished;
+}
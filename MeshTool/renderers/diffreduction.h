@@ -0,0 +1,44 @@
+#ifndef DIFFREDUCTION_H
+#define DIFFREDUCTION_H
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QVector>
+#include <QSize>
+
+// Reduces a difference texture to its maximum and mean on the GPU, halving
+// it per pass down to a single texel. The result is copied into a pixel
+// buffer guarded by a fence and picked up by poll() a few frames later, so
+// the frame never waits for the GPU.
+class DiffReduction {
+
+public:
+  DiffReduction(QOpenGLFunctions_4_1_Core *functions);
+  ~DiffReduction();
+  void resize(int width, int height);
+  void reduce(GLuint texture);
+  bool poll(float *maxDiff, float *meanDiff);
+
+  bool isPending() const {
+    return pending > 0;
+  }
+
+private:
+  static const int Readbacks = 3;
+
+  QOpenGLFunctions_4_1_Core *functions;
+  QOpenGLShaderProgram *shaderProgram;
+  GLuint VAO;
+  QVector<GLuint> textures, framebuffers;
+  QVector<QSize> sizes;
+
+  // Ring of readbacks in flight, oldest at first
+  GLuint PBOs[Readbacks];
+  GLsync fences[Readbacks];
+  int first = 0, pending = 0;
+
+  void clear();
+
+};
+
+#endif // DIFFREDUCTION_H
@@ -0,0 +1,108 @@
+#include "drawlist.h"
+#include "tools/trace.h"
+#include <algorithm>
+
+void DrawList::clear() {
+  commands.clear();
+  invalidateCulling();
+}
+
+void DrawList::add(QOpenGLShaderProgram *shaderProgram, GLuint VAO, int patchVertices, int first, int count, int instances, const PatchBounds *bounds) {
+  if (count == 0 || instances == 0)
+    return;
+  DrawCommand command;
+  command.shaderProgram = shaderProgram;
+  command.VAO = VAO;
+  command.patchVertices = patchVertices;
+  command.first = first;
+  command.count = count;
+  command.instances = instances;
+  command.bounds = bounds;
+  command.firsts.append(first);
+  command.counts.append(count);
+  commands.append(command);
+  invalidateCulling();
+}
+
+void DrawList::sort() {
+  std::stable_sort(commands.begin(), commands.end(), [](const DrawCommand &a, const DrawCommand &b) {
+    if (a.VAO != b.VAO)
+      return a.VAO < b.VAO;
+    if (a.shaderProgram != b.shaderProgram)
+      return a.shaderProgram->programId() < b.shaderProgram->programId();
+    return a.patchVertices < b.patchVertices;
+  });
+}
+
+// Only redone when the view or the bounds changed since the last call
+void DrawList::cull(const QRectF &viewRect) {
+  if (cullingValid && viewRect == culledRect)
+    return;
+  TRACE_ZONE("DrawList::cull");
+  culled = 0;
+  QVector<int> runFirsts, runCounts;
+  for (int i = 0; i < commands.size(); ++i) {
+    DrawCommand &command = commands[i];
+    if (!command.bounds)
+      continue;
+    runFirsts.clear();
+    runCounts.clear();
+    culled += command.bounds->cull(viewRect, &runFirsts, &runCounts);
+    command.firsts.clear();
+    command.counts.clear();
+    for (int j = 0; j < runFirsts.size(); ++j) {
+      command.firsts.append(command.first + command.patchVertices * runFirsts[j]);
+      command.counts.append(command.patchVertices * runCounts[j]);
+    }
+  }
+  culledRect = viewRect;
+  cullingValid = true;
+}
+
+void DrawList::invalidateCulling() {
+  cullingValid = false;
+}
+
+int DrawList::drawCalls() const {
+  int calls = 0;
+  foreach (const DrawCommand &command, commands) {
+    if (!command.firsts.isEmpty())
+      calls += command.instances == 1 ? 1 : command.firsts.size();
+  }
+  return calls;
+}
+
+void DrawList::render(QOpenGLFunctions_4_1_Core *functions) const {
+  QOpenGLShaderProgram *shaderProgram = nullptr;
+  GLuint VAO = 0;
+  int patchVertices = 0;
+  int calls = 0;
+  foreach (const DrawCommand &command, commands) {
+    if (command.firsts.isEmpty())
+      continue;
+    if (command.VAO != VAO) {
+      VAO = command.VAO;
+      functions->glBindVertexArray(VAO);
+    }
+    if (command.shaderProgram != shaderProgram) {
+      shaderProgram = command.shaderProgram;
+      shaderProgram->bind();
+    }
+    if (command.patchVertices != patchVertices) {
+      patchVertices = command.patchVertices;
+      functions->glPatchParameteri(GL_PATCH_VERTICES, patchVertices);
+    }
+    if (command.instances == 1) {
+      functions->glMultiDrawArrays(GL_PATCHES, command.firsts.constData(), command.counts.constData(), command.firsts.size());
+      ++calls;
+    } else {
+      for (int i = 0; i < command.firsts.size(); ++i)
+        functions->glDrawArraysInstanced(GL_PATCHES, command.firsts[i], command.counts[i], command.instances);
+      calls += command.firsts.size();
+    }
+  }
+  TRACE_COUNT(TraceDrawCalls, calls);
+  if (shaderProgram)
+    shaderProgram->release();
+  functions->glBindVertexArray(0);
+}
@@ -0,0 +1,58 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include "patchbounds.h"
+#include <QOpenGLShaderProgram>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QVector>
+#include <QRectF>
+
+// One instanced draw of patches
+class DrawCommand {
+
+public:
+  QOpenGLShaderProgram *shaderProgram;
+  GLuint VAO;
+  int patchVertices;
+  int first, count, instances;
+  const PatchBounds *bounds; // Of the drawn patches, nullptr to never cull
+
+  // Visible vertex ranges after culling
+  QVector<GLint> firsts;
+  QVector<GLsizei> counts;
+
+};
+
+// Draw calls of a renderer, built when its data changes instead of every
+// frame. Empty draws are dropped and the rest sorted by vertex array and
+// program, so render() only touches GL state where consecutive draws differ.
+//
+// cull() narrows each draw down to the runs of patches whose bounds
+// intersect the view, drawn with one glMultiDrawArrays (or one instanced
+// draw per run, which GL 4.1 has no multi draw for).
+class DrawList {
+
+public:
+  void clear();
+  void add(QOpenGLShaderProgram *shaderProgram, GLuint VAO, int patchVertices, int first, int count, int instances = 1, const PatchBounds *bounds = nullptr);
+  void sort();
+  void cull(const QRectF &viewRect);
+  void invalidateCulling(); // After the bounds changed
+  void render(QOpenGLFunctions_4_1_Core *functions) const;
+
+  int culledPatches() const {
+    return culled;
+  }
+
+  // GL draw calls render() issues for the current culling
+  int drawCalls() const;
+
+private:
+  QVector<DrawCommand> commands;
+  QRectF culledRect;
+  bool cullingValid = false;
+  int culled = 0;
+
+};
+
+#endif // DRAWLIST_H
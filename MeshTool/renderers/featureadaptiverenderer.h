@@ -9,6 +9,7 @@
 #include "qvector5d.h"
 #include "coordsedit.h"
 #include "coloredit.h"
+#include "tools/sparsehierarchy.h"
 #include <QVector>
 
 class FeatureAdaptiveRenderer : public SurfaceRenderer {
@@ -16,20 +17,18 @@ class FeatureAdaptiveRenderer : public SurfaceRenderer {
 public:
   FeatureAdaptiveRenderer(QOpenGLFunctions_4_1_Core *functions);
   ~FeatureAdaptiveRenderer() {}
-  void setMesh(Mesh inputMesh, QHash<int, QHash<int, CoordsEdit>> coordsEdits, QHash<int, QHash<int, ColorEdit>> colorEdits);
+  void setMesh(Mesh *inputMesh, const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits);
+  void setHierarchy(const LevelPool<SparseLevel> &levels);
+  void setSegmentPixels(float segmentPixels);
   void render();
   QHash<QString, int> getCountInfo();
+  QHash<QString, qint64> getMemoryInfo();
 
 private:
 
-  QSet<int> computeAffectedFaces(Mesh *curMesh, QHash<int, QHash<int, CoordsEdit>> coordsEdits, QHash<int, QHash<int, ColorEdit>> colorEdits);
-  QSet<int> computePaddedFaces(Mesh mesh, QSet<int> inputFaces);
-  QSet<int> computeTransitionFaces(Mesh mesh, QSet<int> affectedFaces);
-  QSet<int> computeTransitionEdges(Face f, QSet<int> affectedFaces);
+  QSet<int> computeTransitionEdges(Face f, const FaceMask &refinedFaces);
 
   QVector<float> dataACC1, dataACC2; // Quads only
-  QHash<int, int> dataACC1Indices;
-  QHash<int, int> dataACC2Indices;
 
 };
 
@@ -1,6 +1,7 @@
 #include "ggrenderer.h"
 #include "tools/tools.h"
 #include "renderers/acc2renderer.h"
+#include "tools/memoryusage.h"
 #include <QtMath>
 #include <QVector3D>
 #include <QFile>
@@ -57,91 +58,130 @@ void GGRenderer::setDiffScaling(float diffScaling) {
   SurfaceRenderer::setDiffScaling(diffScaling);
 }
 
+void GGRenderer::setViewportSize(QVector2D viewportSize) {
+  this->viewportSize = viewportSize;
+  SurfaceRenderer::setViewportSize(viewportSize);
+}
+
+void GGRenderer::setSegmentPixels(float segmentPixels) {
+  this->segmentPixels = segmentPixels;
+  SurfaceRenderer::setSegmentPixels(segmentPixels);
+}
+
+void GGRenderer::setColormapUnit(int colormapUnit) {
+  this->colormapUnit = colormapUnit;
+  SurfaceRenderer::setColormapUnit(colormapUnit);
+}
+
 void GGRenderer::setMesh(Mesh& mesh) {
-    data.clear();
-    datasIndices.clear();
+  TRACE_ZONE("GGRenderer::setMesh");
+  QScopedPointer<RendererBuffers> buffers(prepareMesh(mesh));
+  setPreparedMesh(buffers.data());
+}
+
+RendererBuffers *GGRenderer::prepareMesh(Mesh& mesh) const {
+  TRACE_ZONE("GGRenderer::prepareMesh");
+  TRACE_COUNT(TraceFacesVisited, mesh.Faces.size());
+  GGBuffers *buffers = new GGBuffers();
 
-  // Collect data per valency
+  // Collect data per valency (face offsets relative to the data of their valency for now)
   QHash<int, QVector<float>> datas;
-  int index = 0;
+  buffers->faceDataOffsets.fill(-1, mesh.Faces.size());
   foreach (Face f, mesh.Faces) {
+    buffers->faceDataOffsets[f.index] = datas[f.val].size();
     ACC2Renderer::addControlPoints(f, &datas[f.val]);
-    datasIndices[f.val][f.index] = index;
-    index += 25 * f.val;
   }
 
   // Collect all data and keep track of sizes
-  controlPointsSizes.clear();
-  controlPointsOffsets.clear();
-//  QVector<float> data;
   int offset = 0;
   foreach (int val, datas.keys()) {
     // Add to data
-    data.append(datas[val]);
+    buffers->data.append(datas[val]);
 
     // Set number of control points
-    controlPointsOffsets[val] = offset;
-    controlPointsSizes[val] = datas[val].size() / 5;
-    offset += controlPointsSizes[val];
+    buffers->controlPointsOffsets[val] = offset;
+    buffers->controlPointsSizes[val] = datas[val].size() / 5;
+    offset += buffers->controlPointsSizes[val];
+  }
+
+  // Make face offsets absolute
+  for (int i = 0; i < mesh.Faces.size(); ++i)
+    buffers->faceDataOffsets[i] += 5 * buffers->controlPointsOffsets[mesh.Faces[i].val];
+  return buffers;
+}
+
+// Take over the buffers of prepareMesh(), which are left empty
+void GGRenderer::setPreparedMesh(RendererBuffers *buffers) {
+  GGBuffers *ggBuffers = (GGBuffers *) buffers;
+  controlPointsSizes.swap(ggBuffers->controlPointsSizes);
+  controlPointsOffsets.swap(ggBuffers->controlPointsOffsets);
+  data.swap(ggBuffers->data);
+  faceDataOffsets.swap(ggBuffers->faceDataOffsets);
 
+  drawList.clear();
+  valencyBounds.clear();
+  foreach (int val, controlPointsSizes.keys()) {
     // Add shader program for valency if not present
-    if (!shaderPrograms.contains(QString::number(val))) {
-      shaderPrograms[QString::number(val)] = makeShaderProgram(val);
-      shaderPrograms[QString::number(val)]->link();
-      shaderPrograms[QString::number(val)]->bind();
-      shaderPrograms[QString::number(val)]->setUniformValue("scaling", scaling);
-      shaderPrograms[QString::number(val)]->setUniformValue("displacement", displacement);
-      shaderPrograms[QString::number(val)]->setUniformValue("colorBands", colorBands);
-      shaderPrograms[QString::number(val)]->setUniformValue("tessLevel", tessLevel);
-      shaderPrograms[QString::number(val)]->setUniformValue("computeDiff", computeDiff);
-      shaderPrograms[QString::number(val)]->setUniformValue("diffScaling", diffScaling);
-      shaderPrograms[QString::number(val)]->release();
+    if (!valencyPrograms.contains(val)) {
+      QOpenGLShaderProgram *shaderProgram = makeShaderProgram(val);
+      shaderPrograms[QString::number(val)] = shaderProgram;
+      valencyPrograms[val] = shaderProgram;
+      setUniform(shaderProgram, UniformScaling, scaling);
+      setUniform(shaderProgram, UniformDisplacement, displacement);
+      setUniform(shaderProgram, UniformColorBands, colorBands);
+      setUniform(shaderProgram, UniformTessLevel, tessLevel);
+      setUniform(shaderProgram, UniformComputeDiff, computeDiff);
+      setUniform(shaderProgram, UniformDiffScaling, diffScaling);
+      setUniform(shaderProgram, UniformViewportSize, viewportSize);
+      setUniform(shaderProgram, UniformSegmentPixels, segmentPixels);
+      setUniform(shaderProgram, UniformColormap, colormapUnit);
     }
+    drawList.add(valencyPrograms[val], VAO, 5 * val, controlPointsOffsets[val], controlPointsSizes[val], val > 4 ? val : 1, &valencyBounds[val]);
   }
+  drawList.sort();
 
   // Set data
   setData(data);
 }
 
-void GGRenderer::updateMeshCoords(Mesh& mesh, QVector<int>& influencedFacesIndices) {
-    foreach (int i, influencedFacesIndices) {
-        ACC2Renderer::updateControlPoints(mesh.Faces[i], data, datasIndices[mesh.Faces[i].val][i], 1);
+void GGRenderer::updateMeshCoords(Mesh& mesh, const ChangeSet& influencedFacesIndices) {
+    TRACE_ZONE("GGRenderer::updateMeshCoords");
+    TRACE_COUNT(TraceFacesVisited, influencedFacesIndices.size());
+    QVector<QPair<int, int>> ranges;
+    foreach (int i, influencedFacesIndices.indices()) {
+        int val = mesh.Faces[i].val;
+        ACC2Renderer::updateControlPoints(mesh.Faces[i], data, faceDataOffsets[i], 1);
+        int patchOffset = faceDataOffsets[i] - 5 * controlPointsOffsets[val];
+        valencyBounds[val].update(patchOffset / (25 * val), data.constData() + faceDataOffsets[i], 5 * val);
+        ranges << qMakePair(faceDataOffsets[i], 25 * val);
     }
 
-  // Set data
-  setData(data);
-
+  // Upload the changed patches only
+  functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  uploadRanges(GL_ARRAY_BUFFER, data, ranges);
+  drawList.invalidateCulling();
 }
 
-void GGRenderer::updateMeshColors(Mesh& mesh, QVector<int>& influencedFacesIndices) {
-    foreach (int i, influencedFacesIndices) {
-        ACC2Renderer::updateControlPoints(mesh.Faces[i], data, datasIndices[mesh.Faces[i].val][i], 2);
+void GGRenderer::updateMeshColors(Mesh& mesh, const ChangeSet& influencedFacesIndices) {
+    TRACE_ZONE("GGRenderer::updateMeshColors");
+    TRACE_COUNT(TraceFacesVisited, influencedFacesIndices.size());
+    QVector<QPair<int, int>> ranges;
+    foreach (int i, influencedFacesIndices.indices()) {
+        ACC2Renderer::updateControlPoints(mesh.Faces[i], data, faceDataOffsets[i], 2);
+        ranges << qMakePair(faceDataOffsets[i], 25 * mesh.Faces[i].val);
     }
 
-  // Set data
-  setData(data);
+  // Upload the changed patches only, colors leave the bounds as they are
+  functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  uploadRanges(GL_ARRAY_BUFFER, data, ranges);
 }
 
 void GGRenderer::render() {
-  // Bind
-  functions->glBindVertexArray(VAO);
-
+  TRACE_ZONE("GGRenderer::render");
   // Draw independent for each valency
-  foreach (int val, controlPointsOffsets.keys()) {
-    // Bind
-    shaderPrograms[QString::number(val)]->bind();
-
-    // Draw
-    functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
-    functions->glPatchParameteri(GL_PATCH_VERTICES, 5 * val);
-    functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsets[val], controlPointsSizes[val], val > 4 ? val : 1);
-
-    // Release
-    shaderPrograms[QString::number(val)]->release();
-  }
-
-  // Release
-  functions->glBindVertexArray(0);
+  functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
+  drawList.cull(viewRect);
+  drawList.render(functions);
 }
 
 QHash<QString, int> GGRenderer::getCountInfo() {
@@ -155,37 +195,50 @@ QHash<QString, int> GGRenderer::getCountInfo() {
   countInfo["faces"] = faces;
   countInfo["control points"] = controlPoints;
   countInfo["invocations"] = invocations;
+  countInfo["draw calls"] = drawList.drawCalls();
+  countInfo["culled patches"] = drawList.culledPatches();
   return countInfo;
 }
 
 void GGRenderer::setData(QVector<float> data) {
   functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
   functions->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * data.size(), data.data(), GL_DYNAMIC_DRAW);
+  TRACE_COUNT(TraceUploadedBytes, sizeof(float) * data.size());
+  bufferBytes["VBO"] = sizeof(float) * data.size();
+
+  // Update bounds, the draws refer to them
+  foreach (int val, controlPointsSizes.keys())
+    valencyBounds[val].build(data.constData() + 5 * controlPointsOffsets[val], controlPointsSizes[val] / (5 * val), 5 * val);
+  drawList.invalidateCulling();
 };
 
+// Program for faces of valency N. The binaries are cached on disk per source
+// and driver, and the valencies up to 12 can be compiled ahead of time with a
+// ShaderPrewarmer, so a new valency in a mesh does not stall the upload.
 QOpenGLShaderProgram *GGRenderer::makeShaderProgram(int N) {
+  TRACE_ZONE("GGRenderer::makeShaderProgram");
   if (N == 3) {
     QOpenGLShaderProgram *shaderProgram = new QOpenGLShaderProgram();
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/ACC2/vertshader.glsl");
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/ACC2/triangles/controlshader.glsl");
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/ACC2/triangles/evalshader.glsl");
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/ACC2/vertshader.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/ACC2/triangles/controlshader.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/ACC2/triangles/evalshader.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
     shaderProgram->link();
     return shaderProgram;
   } else if (N == 4) {
     QOpenGLShaderProgram *shaderProgram = new QOpenGLShaderProgram();
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/ACC2/vertshader.glsl");
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/ACC2/quads/controlshader.glsl");
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/ACC2/quads/evalshader.glsl");
-    shaderProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/ACC2/vertshader.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/ACC2/quads/controlshader.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/ACC2/quads/evalshader.glsl");
+    shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
     shaderProgram->link();
     return shaderProgram;
   }
 
   // Initialize with vertex and fragment shader
   QOpenGLShaderProgram *shaderProgram = new QOpenGLShaderProgram();
-  shaderProgram->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/GG/vertshader.glsl");
-  shaderProgram->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
+  shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/GG/vertshader.glsl");
+  shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
 
   // Construct control shader
   QFile controlShaderFile(":/shaders/GG/controlshader.glsl");
@@ -193,9 +246,10 @@ QOpenGLShaderProgram *GGRenderer::makeShaderProgram(int N) {
   QString controlShaderCode = QString(controlShaderFile.readAll());
   controlShaderFile.close();
   controlShaderCode = controlShaderCode.replace("/* vertices */", QString::number(5 * N));
+  controlShaderCode = controlShaderCode.replace("/* N */", QString::number(N));
 
   // Add control shader
-  shaderProgram->addShaderFromSourceCode(QOpenGLShader::TessellationControl, controlShaderCode);
+  shaderProgram->addCacheableShaderFromSourceCode(QOpenGLShader::TessellationControl, controlShaderCode);
 
   // Construct evaluation shader
   QFile evalShaderFile(":/shaders/GG/evalshader.glsl");
@@ -205,8 +259,17 @@ QOpenGLShaderProgram *GGRenderer::makeShaderProgram(int N) {
   evalShaderCode = evalShaderCode.replace("/* N */", QString::number(N));
 
   // Add evaluation shader
-  shaderProgram->addShaderFromSourceCode(QOpenGLShader::TessellationEvaluation, evalShaderCode);
+  shaderProgram->addCacheableShaderFromSourceCode(QOpenGLShader::TessellationEvaluation, evalShaderCode);
   shaderProgram->link();
 
   return shaderProgram;
 }
+
+QHash<QString, qint64> GGRenderer::getMemoryInfo() {
+  QHash<QString, qint64> memoryInfo = SurfaceRenderer::getMemoryInfo();
+  memoryInfo["data"] = vectorBytes(data);
+  memoryInfo["faceDataOffsets"] = vectorBytes(faceDataOffsets);
+  foreach (const PatchBounds &bounds, valencyBounds)
+    memoryInfo["bounds"] += vectorBytes(bounds.data());
+  return memoryInfo;
+}
@@ -2,10 +2,21 @@
 #define GGRENDERER_H
 
 #include "surfacerenderer.h"
+#include "drawlist.h"
 #include "mesh.h"
 #include "qvector5d.h"
 #include <QVector>
 
+// Control points of a mesh grouped per valency
+class GGBuffers : public RendererBuffers {
+
+public:
+  QHash<int, int> controlPointsSizes, controlPointsOffsets;
+  QVector<float> data;
+  QVector<int> faceDataOffsets;
+
+};
+
 class GGRenderer : public SurfaceRenderer {
 
 public:
@@ -17,15 +28,25 @@ public:
   void setTessLevel(int tessLevel);
   void setComputeDiff(bool computeDiff);
   void setDiffScaling(float diffScaling);
+  void setViewportSize(QVector2D viewportSize);
+  void setSegmentPixels(float segmentPixels);
+  void setColormapUnit(int colormapUnit);
   void setMesh(Mesh& mesh);
-  void updateMeshCoords(Mesh& mesh, QVector<int>& influencedFacesIndices);
-  void updateMeshColors(Mesh& mesh, QVector<int>& influencedFacesIndices);
+  RendererBuffers *prepareMesh(Mesh& mesh) const;
+  void setPreparedMesh(RendererBuffers *buffers);
+  void updateMeshCoords(Mesh& mesh, const ChangeSet& influencedFacesIndices);
+  void updateMeshColors(Mesh& mesh, const ChangeSet& influencedFacesIndices);
   void render();
   QHash<QString, int> getCountInfo();
+  QHash<QString, qint64> getMemoryInfo();
+  static QOpenGLShaderProgram *makeShaderProgram(int N);
 
 private:
   GLuint VAO, VBO;
   QHash<int, int> controlPointsSizes, controlPointsOffsets;
+  QHash<int, QOpenGLShaderProgram *> valencyPrograms; // Also in shaderPrograms, which owns them
+  QHash<int, PatchBounds> valencyBounds;
+  DrawList drawList;
 
   // Copy of uniform values (because of dynamic shader additions)
   QVector2D scaling;
@@ -34,12 +55,14 @@ private:
   int tessLevel;
   bool computeDiff;
   float diffScaling;
+  QVector2D viewportSize;
+  float segmentPixels;
+  int colormapUnit;
 
   QVector<float> data;
-  QHash<int, QHash<int, int>> datasIndices;
+  QVector<int> faceDataOffsets; // Offset in data per face index
 
   void setData(QVector<float> data);
-  QOpenGLShaderProgram *makeShaderProgram(int N);
 
 };
 
@@ -1,5 +1,6 @@
 #include "linerenderer.h"
 #include "vertex.h"
+#include "tools/trace.h"
 
 LineRenderer::LineRenderer(QOpenGLFunctions_4_1_Core *functions) {
   // Set OpenGL functions
@@ -50,6 +51,7 @@ void LineRenderer::setColor(QVector3D color) {
 }
 
 void LineRenderer::setEdges(QSet<HalfEdge *> edges) {
+  TRACE_ZONE("LineRenderer::setEdges");
   QVector<QVector2D> coords;
   foreach (HalfEdge *e, edges) {
     coords << e->prev->target->coords;
@@ -58,9 +60,11 @@ void LineRenderer::setEdges(QSet<HalfEdge *> edges) {
   drawCount = coords.size();
   functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
   functions->glBufferData(GL_ARRAY_BUFFER, sizeof(QVector2D) * coords.size(), coords.data(), GL_DYNAMIC_DRAW);
+  TRACE_COUNT(TraceUploadedBytes, sizeof(QVector2D) * coords.size());
 };
 
 void LineRenderer::render() {
+  TRACE_ZONE("LineRenderer::render");
   functions->glBindVertexArray(VAO);
   shaderProgram->bind();
   functions->glDrawArrays(GL_LINES, 0, drawCount);
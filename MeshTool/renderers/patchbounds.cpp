@@ -0,0 +1,71 @@
+#include "patchbounds.h"
+#include "tools/trace.h"
+
+void PatchBounds::clear() {
+  bounds.clear();
+}
+
+void PatchBounds::add(const float *controlPoints, int count) {
+  bounds.resize(bounds.size() + 4);
+  update(size() - 1, controlPoints, count);
+}
+
+// After the control points of one patch changed
+void PatchBounds::update(int patch, const float *controlPoints, int count) {
+  float minX = controlPoints[0], minY = controlPoints[1];
+  float maxX = minX, maxY = minY;
+  for (int i = 1; i < count; ++i) {
+    float x = controlPoints[5 * i], y = controlPoints[5 * i + 1];
+    minX = qMin(minX, x);
+    minY = qMin(minY, y);
+    maxX = qMax(maxX, x);
+    maxY = qMax(maxY, y);
+  }
+  float *b = bounds.data() + 4 * patch;
+  b[0] = minX;
+  b[1] = minY;
+  b[2] = maxX;
+  b[3] = maxY;
+}
+
+void PatchBounds::build(const float *data, int patches, int patchVertices) {
+  clear();
+  bounds.reserve(4 * patches);
+  for (int i = 0; i < patches; ++i)
+    add(data + 5 * patchVertices * i, patchVertices);
+}
+
+int PatchBounds::cull(const QRectF &rect, QVector<int> *runFirsts, QVector<int> *runCounts) const {
+  int patches = size();
+  if (rect.isNull()) {
+    if (patches > 0) {
+      runFirsts->append(0);
+      runCounts->append(patches);
+    }
+    return 0;
+  }
+
+  float left = rect.left(), right = rect.right(), top = rect.top(), bottom = rect.bottom();
+  const float *b = bounds.constData();
+  int culled = 0;
+  int runFirst = -1;
+  for (int i = 0; i < patches; ++i, b += 4) {
+    bool visible = b[0] <= right && b[2] >= left && b[1] <= bottom && b[3] >= top;
+    if (visible && runFirst < 0) {
+      runFirst = i;
+    } else if (!visible) {
+      if (runFirst >= 0) {
+        runFirsts->append(runFirst);
+        runCounts->append(i - runFirst);
+        runFirst = -1;
+      }
+      ++culled;
+    }
+  }
+  if (runFirst >= 0) {
+    runFirsts->append(runFirst);
+    runCounts->append(patches - runFirst);
+  }
+  TRACE_COUNT(TraceCulledPatches, culled);
+  return culled;
+}
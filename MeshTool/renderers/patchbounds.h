@@ -0,0 +1,35 @@
+#ifndef PATCHBOUNDS_H
+#define PATCHBOUNDS_H
+
+#include <QVector>
+#include <QRectF>
+
+// Axis aligned bounds of consecutive patches, from their control points of
+// interleaved coords and color. The patches of all renderers are convex
+// combinations of their control points, so the bounds contain the surface.
+class PatchBounds {
+
+public:
+  void clear();
+  void add(const float *controlPoints, int count);
+  void update(int patch, const float *controlPoints, int count);
+  void build(const float *data, int patches, int patchVertices);
+
+  // Appends the runs of consecutive patches that intersect rect (all of them
+  // for a null rect) and returns the number of patches outside of it
+  int cull(const QRectF &rect, QVector<int> *runFirsts, QVector<int> *runCounts) const;
+
+  int size() const {
+    return bounds.size() / 4;
+  }
+
+  const QVector<float> &data() const {
+    return bounds;
+  }
+
+private:
+  QVector<float> bounds; // Min x, min y, max x and max y per patch
+
+};
+
+#endif // PATCHBOUNDS_H
@@ -1,4 +1,5 @@
 #include "pointrenderer.h"
+#include "tools/trace.h"
 
 PointRenderer::PointRenderer(QOpenGLFunctions_4_1_Core *functions) {
   // Set OpenGL functions
@@ -87,15 +88,18 @@ void PointRenderer::setRadius(float radius) {
 void PointRenderer::setVertexCoords(QVector<QVector2D> vertexCoords) {
   functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
   functions->glBufferData(GL_ARRAY_BUFFER, sizeof(QVector2D) * vertexCoords.size(), vertexCoords.data(), GL_DYNAMIC_DRAW);
+  TRACE_COUNT(TraceUploadedBytes, sizeof(QVector2D) * vertexCoords.size());
 };
 
 void PointRenderer::setVertexIndices(QVector<int> vertexIndices) {
   indicesSize = vertexIndices.size();
   functions->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IBO);
   functions->glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * vertexIndices.size(), vertexIndices.data(), GL_DYNAMIC_DRAW);
+  TRACE_COUNT(TraceUploadedBytes, sizeof(int) * vertexIndices.size());
 }
 
 void PointRenderer::render() {
+  TRACE_ZONE("PointRenderer::render");
   // Bind
   functions->glBindVertexArray(VAO);
 
@@ -0,0 +1,41 @@
+#include "shaderprewarmer.h"
+#include "tools/trace.h"
+#include <QDebug>
+
+ShaderPrewarmer::ShaderPrewarmer(QOpenGLContext *shareContext, QList<MakeFunction> makeFunctions) {
+  this->makeFunctions = makeFunctions;
+  surface.setFormat(shareContext->format());
+  surface.create();
+
+  // Created here, current only on the worker thread
+  context = new QOpenGLContext();
+  context->setFormat(shareContext->format());
+  context->setShareContext(shareContext);
+  if (!context->create()) {
+    qDebug() << ":: Shader prewarm context could not be created";
+    delete context;
+    context = nullptr;
+    return;
+  }
+  context->moveToThread(this);
+}
+
+ShaderPrewarmer::~ShaderPrewarmer() {
+  wait();
+  delete context;
+}
+
+void ShaderPrewarmer::run() {
+  if (!context)
+    return;
+  if (context->makeCurrent(&surface)) {
+    TRACE_ZONE("ShaderPrewarmer::run");
+    foreach (const MakeFunction &makeFunction, makeFunctions)
+      delete makeFunction();
+    context->doneCurrent();
+    qDebug() << ":: Prewarmed" << makeFunctions.size() << "shader programs";
+  }
+
+  // Hand the context back, the destructor deletes it on the GUI thread
+  context->moveToThread(thread());
+}
@@ -0,0 +1,34 @@
+#ifndef SHADERPREWARMER_H
+#define SHADERPREWARMER_H
+
+#include <QThread>
+#include <QList>
+#include <QOpenGLContext>
+#include <QOpenGLShaderProgram>
+#include <QOffscreenSurface>
+#include <functional>
+
+// Links shader programs on a worker thread, in a context shared with the
+// view. The programs are thrown away again: the point is to fill the
+// program binary cache, so the renderer that needs one later only loads its
+// binary instead of compiling it.
+class ShaderPrewarmer : public QThread {
+
+public:
+  typedef std::function<QOpenGLShaderProgram *()> MakeFunction;
+
+  // Must be called on the GUI thread, which owns the offscreen surface
+  ShaderPrewarmer(QOpenGLContext *shareContext, QList<MakeFunction> makeFunctions);
+  ~ShaderPrewarmer();
+
+protected:
+  void run() override;
+
+private:
+  QOffscreenSurface surface;
+  QOpenGLContext *context;
+  QList<MakeFunction> makeFunctions;
+
+};
+
+#endif // SHADERPREWARMER_H
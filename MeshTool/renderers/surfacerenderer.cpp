@@ -1,6 +1,8 @@
 #include "surfacerenderer.h"
 #include "tools/tools.h"
+#include "tools/memoryusage.h"
 #include <QVector3D>
+#include <algorithm>
 
 SurfaceRenderer::SurfaceRenderer(QOpenGLFunctions_4_1_Core *functions) {
   this->functions = functions;
@@ -20,63 +22,115 @@ void SurfaceRenderer::setShowWireframe(bool showWireframe) {
 }
 
 void SurfaceRenderer::setScaling(QVector2D scaling) {
-  foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms) {
-    shaderProgram->bind();
-    shaderProgram->setUniformValue("scaling", scaling);
-    shaderProgram->release();
-  }
+  setUniform(UniformScaling, scaling);
   foreach (SurfaceRenderer *renderer, renderers)
     renderer->setScaling(scaling);
 }
 
 void SurfaceRenderer::setDisplacement(QVector2D displacement) {
-  foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms) {
-    shaderProgram->bind();
-    shaderProgram->setUniformValue("displacement", displacement);
-    shaderProgram->release();
-  }
+  setUniform(UniformDisplacement, displacement);
   foreach (SurfaceRenderer *renderer, renderers)
     renderer->setDisplacement(displacement);
 }
 
 void SurfaceRenderer::setColorBands(int colorBands) {
-  foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms) {
-    shaderProgram->bind();
-    shaderProgram->setUniformValue("colorBands", colorBands);
-    shaderProgram->release();
-  }
+  setUniform(UniformColorBands, colorBands);
   foreach (SurfaceRenderer *renderer, renderers)
     renderer->setColorBands(colorBands);
 }
 
 void SurfaceRenderer::setTessLevel(int tessLevel) {
-  foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms) {
-    shaderProgram->bind();
-    shaderProgram->setUniformValue("tessLevel", tessLevel);
-    shaderProgram->release();
-  }
+  setUniform(UniformTessLevel, tessLevel);
   foreach (SurfaceRenderer *renderer, renderers)
     renderer->setTessLevel(tessLevel);
 }
 
 void SurfaceRenderer::setComputeDiff(int computeDiff) {
-  foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms) {
-    shaderProgram->bind();
-    shaderProgram->setUniformValue("computeDiff", computeDiff);
-    shaderProgram->release();
-  }
+  setUniform(UniformComputeDiff, computeDiff);
   foreach (SurfaceRenderer *renderer, renderers)
     renderer->setComputeDiff(computeDiff);
 }
 
 void SurfaceRenderer::setDiffScaling(float diffScaling) {
-  foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms) {
-    shaderProgram->bind();
-    shaderProgram->setUniformValue("diffScaling", diffScaling);
-    shaderProgram->release();
-  }
+  setUniform(UniformDiffScaling, diffScaling);
   foreach (SurfaceRenderer *renderer, renderers)
     renderer->setDiffScaling(diffScaling);
 }
 
+void SurfaceRenderer::setViewportSize(QVector2D viewportSize) {
+  setUniform(UniformViewportSize, viewportSize);
+  foreach (SurfaceRenderer *renderer, renderers)
+    renderer->setViewportSize(viewportSize);
+}
+
+// Target length of a tessellated segment in pixels, 0 for the fixed tessLevel
+void SurfaceRenderer::setSegmentPixels(float segmentPixels) {
+  setUniform(UniformSegmentPixels, segmentPixels);
+  foreach (SurfaceRenderer *renderer, renderers)
+    renderer->setSegmentPixels(segmentPixels);
+}
+
+// Patches outside of it are culled before drawing
+void SurfaceRenderer::setViewRect(QRectF viewRect) {
+  this->viewRect = viewRect;
+  foreach (SurfaceRenderer *renderer, renderers)
+    renderer->setViewRect(viewRect);
+}
+
+// Texture unit of the 1D colormap of the difference view
+void SurfaceRenderer::setColormapUnit(int colormapUnit) {
+  setUniform(UniformColormap, colormapUnit);
+  foreach (SurfaceRenderer *renderer, renderers)
+    renderer->setColormapUnit(colormapUnit);
+}
 
+static const char *uniformNames[] = {
+  "scaling",
+  "displacement",
+  "colorBands",
+  "tessLevel",
+  "computeDiff",
+  "diffScaling",
+  "viewportSize",
+  "segmentPixels",
+  "colormap"
+};
+
+// Locations are looked up on first use, instead of by name on every change
+int SurfaceRenderer::uniformLocation(QOpenGLShaderProgram *shaderProgram, Uniform uniform) {
+  QVector<int> &locations = uniformLocations[shaderProgram];
+  if (locations.isEmpty()) {
+    for (int i = 0; i < UniformCount; ++i)
+      locations.append(shaderProgram->uniformLocation(uniformNames[i]));
+  }
+  return locations[uniform];
+}
+
+// Gaps of up to 4 KB are uploaded along, fewer calls are cheaper than the extra bytes
+void SurfaceRenderer::uploadRanges(GLenum target, const QVector<float> &data, QVector<QPair<int, int>> ranges, int bufferOffset) {
+  std::sort(ranges.begin(), ranges.end());
+  qint64 bytes = 0;
+  int i = 0;
+  while (i < ranges.size()) {
+    int first = ranges[i].first;
+    int end = first + ranges[i].second;
+    for (++i; i < ranges.size() && ranges[i].first <= end + 1024; ++i)
+      end = qMax(end, ranges[i].first + ranges[i].second);
+    functions->glBufferSubData(target, sizeof(float) * (bufferOffset + first), sizeof(float) * (end - first), data.constData() + first);
+    bytes += sizeof(float) * (end - first);
+  }
+  TRACE_COUNT(TraceUploadedBytes, bytes);
+}
+
+// Bytes of the GL buffers, subclasses add their CPU side data
+QHash<QString, qint64> SurfaceRenderer::getMemoryInfo() {
+  QHash<QString, qint64> memoryInfo;
+  foreach (QString buffer, bufferBytes.keys())
+    memoryInfo["GL " + buffer] = bufferBytes[buffer];
+  foreach (QString name, renderers.keys()) {
+    QHash<QString, qint64> rendererInfo = renderers[name]->getMemoryInfo();
+    foreach (QString key, rendererInfo.keys())
+      memoryInfo[name + " " + key] = rendererInfo[key];
+  }
+  return memoryInfo;
+}
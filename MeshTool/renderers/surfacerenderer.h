@@ -2,9 +2,21 @@
 #define SURFACERENDERER_H
 
 #include "mesh.h"
+#include "tools/changeset.h"
 #include <QOpenGLShaderProgram>
 #include <QOpenGLFunctions_4_1_Core>
 #include <QVector2D>
+#include <QRectF>
+#include <QScopedPointer>
+
+// CPU side of the buffers of a renderer for one mesh. Computing it touches no
+// GL state, so it can be done on a worker thread and handed over later.
+class RendererBuffers {
+
+public:
+  virtual ~RendererBuffers() {}
+
+};
 
 class SurfaceRenderer {
 
@@ -18,17 +30,61 @@ public:
   virtual void setTessLevel(int tessLevel);
   virtual void setComputeDiff(int computeDiff);
   virtual void setDiffScaling(float diffScaling);
+  virtual void setViewportSize(QVector2D viewportSize);
+  virtual void setSegmentPixels(float segmentPixels);
+  virtual void setViewRect(QRectF viewRect);
+  virtual void setColormapUnit(int colormapUnit);
   virtual void setMesh(Mesh& mesh) {}
-  virtual void updateMeshCoords(Mesh& mesh, QVector<int>& changedLimitCoordsIndices) {}
-  virtual void updateMeshColors(Mesh& mesh, QVector<int>& changedEdgesIndices) {}
+  virtual RendererBuffers *prepareMesh(Mesh& mesh) const { return nullptr; }
+  virtual void setPreparedMesh(RendererBuffers *buffers) {}
+  virtual void updateMeshCoords(Mesh& mesh, const ChangeSet& changedLimitCoordsIndices) {}
+  virtual void updateMeshColors(Mesh& mesh, const ChangeSet& changedEdgesIndices) {}
   virtual void render() = 0;
   virtual QHash<QString, int> getCountInfo() = 0;
+  virtual QHash<QString, qint64> getMemoryInfo();
 
 protected:
+  // Uniforms shared by all surface shaders
+  enum Uniform {
+    UniformScaling,
+    UniformDisplacement,
+    UniformColorBands,
+    UniformTessLevel,
+    UniformComputeDiff,
+    UniformDiffScaling,
+    UniformViewportSize,
+    UniformSegmentPixels,
+    UniformColormap,
+    UniformCount
+  };
+
+  int uniformLocation(QOpenGLShaderProgram *shaderProgram, Uniform uniform);
+
+  // Upload the ranges (offset, count) of data to the buffer bound to target,
+  // shifted by bufferOffset floats. Ranges close together go in one call.
+  void uploadRanges(GLenum target, const QVector<float> &data, QVector<QPair<int, int>> ranges, int bufferOffset = 0);
+
+  // Set a uniform of one program, or of all programs of the renderer
+  template <typename T>
+  void setUniform(QOpenGLShaderProgram *shaderProgram, Uniform uniform, const T &value) {
+    shaderProgram->bind();
+    shaderProgram->setUniformValue(uniformLocation(shaderProgram, uniform), value);
+    shaderProgram->release();
+  }
+
+  template <typename T>
+  void setUniform(Uniform uniform, const T &value) {
+    foreach (QOpenGLShaderProgram *shaderProgram, shaderPrograms)
+      setUniform(shaderProgram, uniform, value);
+  }
+
   bool showWireframe = false;
+  QRectF viewRect; // Visible part of the mesh in mesh coordinates, null to draw everything
   QOpenGLFunctions_4_1_Core *functions;
   QHash<QString, QOpenGLShaderProgram *> shaderPrograms;
   QHash<QString, SurfaceRenderer *> renderers;
+  QHash<QString, qint64> bufferBytes; // Size per GL buffer
+  QHash<QOpenGLShaderProgram *, QVector<int>> uniformLocations; // Per program, indexed by Uniform
 
 };
 
@@ -2,93 +2,25 @@
 #include "renderers/acc1renderer.h"
 #include "renderers/acc2renderer.h"
 #include "tools/tools.h"
+#include "tools/memoryusage.h"
 #include <QVector3D>
 
 TransitionPatchRenderer::TransitionPatchRenderer(QOpenGLFunctions_4_1_Core *functions) : SurfaceRenderer(functions) {
-  // Create shader programs
-  shaderPrograms["ACC1-C1"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC1-C1"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC1-C1"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC1/controlshader.glsl");
-  shaderPrograms["ACC1-C1"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC1/constellation1/evalshader.glsl");
-  shaderPrograms["ACC1-C1"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC1-C1"]->link();
-
-  shaderPrograms["ACC1-C2"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC1-C2"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC1-C2"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC1/controlshader.glsl");
-  shaderPrograms["ACC1-C2"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC1/constellation2/evalshader.glsl");
-  shaderPrograms["ACC1-C2"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC1-C2"]->link();
-
-  shaderPrograms["ACC1-C3"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC1-C3"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC1-C3"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC1/controlshader.glsl");
-  shaderPrograms["ACC1-C3"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC1/constellation3/evalshader.glsl");
-  shaderPrograms["ACC1-C3"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC1-C3"]->link();
-
-  shaderPrograms["ACC1-C4-Quad"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC1-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC1-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC1/controlshader.glsl");
-  shaderPrograms["ACC1-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC1/constellation4/quad/evalshader.glsl");
-  shaderPrograms["ACC1-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC1-C4-Quad"]->link();
-
-  shaderPrograms["ACC1-C4-Triangles"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC1-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC1-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC1/controlshader.glsl");
-  shaderPrograms["ACC1-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC1/constellation4/triangles/evalshader.glsl");
-  shaderPrograms["ACC1-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC1-C4-Triangles"]->link();
-
-  shaderPrograms["ACC1-C5"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC1-C5"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC1-C5"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC1/controlshader.glsl");
-  shaderPrograms["ACC1-C5"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC1/constellation5/evalshader.glsl");
-  shaderPrograms["ACC1-C5"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC1-C5"]->link();
-
-  shaderPrograms["ACC2-C1"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC2-C1"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC2-C1"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC2/controlshader.glsl");
-  shaderPrograms["ACC2-C1"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC2/constellation1/evalshader.glsl");
-  shaderPrograms["ACC2-C1"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC2-C1"]->link();
-
-  shaderPrograms["ACC2-C2"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC2-C2"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC2-C2"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC2/controlshader.glsl");
-  shaderPrograms["ACC2-C2"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC2/constellation2/evalshader.glsl");
-  shaderPrograms["ACC2-C2"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC2-C2"]->link();
-
-  shaderPrograms["ACC2-C3"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC2-C3"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC2-C3"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC2/controlshader.glsl");
-  shaderPrograms["ACC2-C3"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC2/constellation3/evalshader.glsl");
-  shaderPrograms["ACC2-C3"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC2-C3"]->link();
-
-  shaderPrograms["ACC2-C4-Quad"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC2-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC2-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC2/controlshader.glsl");
-  shaderPrograms["ACC2-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC2/constellation4/quad/evalshader.glsl");
-  shaderPrograms["ACC2-C4-Quad"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC2-C4-Quad"]->link();
-
-  shaderPrograms["ACC2-C4-Triangles"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC2-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC2-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC2/controlshader.glsl");
-  shaderPrograms["ACC2-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC2/constellation4/triangles/evalshader.glsl");
-  shaderPrograms["ACC2-C4-Triangles"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC2-C4-Triangles"]->link();
-
-  shaderPrograms["ACC2-C5"] = new QOpenGLShaderProgram();
-  shaderPrograms["ACC2-C5"]->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
-  shaderPrograms["ACC2-C5"]->addShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/ACC2/controlshader.glsl");
-  shaderPrograms["ACC2-C5"]->addShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/ACC2/constellation5/evalshader.glsl");
-  shaderPrograms["ACC2-C5"]->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
-  shaderPrograms["ACC2-C5"]->link();
+  // Create shader programs, one per patch type and constellation. Their
+  // binaries are cached on disk, so only the first start compiles them.
+  static const char *constellations[6] = {"C1", "C2", "C3", "C4-Quad", "C4-Triangles", "C5"};
+  static const char *evalShaders[6] = {"constellation1", "constellation2", "constellation3", "constellation4/quad", "constellation4/triangles", "constellation5"};
+  foreach (QString patchType, QStringList({"ACC1", "ACC2"})) {
+    for (int i = 0; i < 6; ++i) {
+      QOpenGLShaderProgram *shaderProgram = new QOpenGLShaderProgram();
+      shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Vertex, ":/shaders/TP/vertshader.glsl");
+      shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::TessellationControl, ":/shaders/TP/" + patchType + "/controlshader.glsl");
+      shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::TessellationEvaluation, ":/shaders/TP/" + patchType + "/" + evalShaders[i] + "/evalshader.glsl");
+      shaderProgram->addCacheableShaderFromSourceFile(QOpenGLShader::Fragment, ":/shaders/fragshadershared.glsl");
+      shaderProgram->link();
+      shaderPrograms[patchType + "-" + constellations[i]] = shaderProgram;
+    }
+  }
 
   // Create VAO ACC1
   functions->glGenVertexArrays(1, &VAOACC1);
@@ -204,6 +136,7 @@ void TransitionPatchRenderer::addControlPoints(Face f, QSet<int> transitionEdges
 }
 
 void TransitionPatchRenderer::setData() {
+  TRACE_ZONE("TransitionPatchRenderer::setData");
   // Collect ACC1 data
   QVector<float> dataACC1;
   int offsetACC1 = 0;
@@ -212,6 +145,7 @@ void TransitionPatchRenderer::setData() {
     controlPointsOffsetsACC1[constellation] = offsetACC1;
     controlPointsSizesACC1[constellation] = datasACC1[constellation].size() / 5;
     offsetACC1 += controlPointsSizesACC1[constellation];
+    boundsACC1[constellation].build(datasACC1[constellation].constData(), controlPointsSizesACC1[constellation] / 16, 16);
   }
 
   // Collect ACC2 data
@@ -222,78 +156,47 @@ void TransitionPatchRenderer::setData() {
     controlPointsOffsetsACC2[constellation] = offsetACC2;
     controlPointsSizesACC2[constellation] = datasACC2[constellation].size() / 5;
     offsetACC2 += controlPointsSizesACC2[constellation];
+    boundsACC2[constellation].build(datasACC2[constellation].constData(), controlPointsSizesACC2[constellation] / 20, 20);
   }
 
-  // Set data ACC1
-  functions->glBindBuffer(GL_ARRAY_BUFFER, VBOACC1);
-  functions->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * dataACC1.size(), dataACC1.data(), GL_DYNAMIC_DRAW);
+  // Set data. The patches come from a new sparse hierarchy on every edit, so
+  // they are all uploaded, but in place while the buffer sizes stay the same.
+  setBufferData(VBOACC1, "VBO ACC1", dataACC1);
+  setBufferData(VBOACC2, "VBO ACC2", dataACC2);
 
-  // Set data ACC2
-  functions->glBindBuffer(GL_ARRAY_BUFFER, VBOACC2);
-  functions->glBufferData(GL_ARRAY_BUFFER, sizeof(float) * dataACC2.size(), dataACC2.data(), GL_DYNAMIC_DRAW);
+  updateDrawList();
 };
 
-void TransitionPatchRenderer::render() {
-  // Set environment
-  functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
-
-  // Draw ACC1 patches
-  functions->glBindVertexArray(VAOACC1);
-  functions->glPatchParameteri(GL_PATCH_VERTICES, 16);
-
-  shaderPrograms["ACC1-C1"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC1["C1"], controlPointsSizesACC1["C1"], 3);
-  shaderPrograms["ACC1-C1"]->release();
-
-  shaderPrograms["ACC1-C2"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC1["C2"], controlPointsSizesACC1["C2"], 4);
-  shaderPrograms["ACC1-C2"]->release();
-
-  shaderPrograms["ACC1-C3"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC1["C3"], controlPointsSizesACC1["C3"], 2);
-  shaderPrograms["ACC1-C3"]->release();
-
-  shaderPrograms["ACC1-C4-Quad"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC1["C4"], controlPointsSizesACC1["C4"], 1);
-  shaderPrograms["ACC1-C4-Quad"]->release();
-
-  shaderPrograms["ACC1-C4-Triangles"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC1["C4"], controlPointsSizesACC1["C4"], 3);
-  shaderPrograms["ACC1-C4-Triangles"]->release();
-
-  shaderPrograms["ACC1-C5"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC1["C5"], controlPointsSizesACC1["C5"], 4);
-  shaderPrograms["ACC1-C5"]->release();
-
-  // Draw ACC2 patches
-  functions->glBindVertexArray(VAOACC2);
-  functions->glPatchParameteri(GL_PATCH_VERTICES, 20);
-
-  shaderPrograms["ACC2-C1"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC2["C1"], controlPointsSizesACC2["C1"], 3);
-  shaderPrograms["ACC2-C1"]->release();
-
-  shaderPrograms["ACC2-C2"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC2["C2"], controlPointsSizesACC2["C2"], 4);
-  shaderPrograms["ACC2-C2"]->release();
-
-  shaderPrograms["ACC2-C3"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC2["C3"], controlPointsSizesACC2["C3"], 2);
-  shaderPrograms["ACC2-C3"]->release();
-
-  shaderPrograms["ACC2-C4-Quad"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC2["C4"], controlPointsSizesACC2["C4"], 1);
-  shaderPrograms["ACC2-C4-Quad"]->release();
+void TransitionPatchRenderer::setBufferData(GLuint VBO, QString name, const QVector<float> &data) {
+  qint64 bytes = sizeof(float) * data.size();
+  functions->glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  if (bufferBytes.value(name, -1) == bytes)
+    functions->glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data.constData());
+  else
+    functions->glBufferData(GL_ARRAY_BUFFER, bytes, data.constData(), GL_DYNAMIC_DRAW);
+  TRACE_COUNT(TraceUploadedBytes, bytes);
+  bufferBytes[name] = bytes;
+}
 
-  shaderPrograms["ACC2-C4-Triangles"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC2["C4"], controlPointsSizesACC2["C4"], 3);
-  shaderPrograms["ACC2-C4-Triangles"]->release();
+// Constellation C4 is drawn as one quad and three triangles
+void TransitionPatchRenderer::updateDrawList() {
+  static const char *constellations[6] = {"C1", "C2", "C3", "C4", "C4", "C5"};
+  static const char *programs[6] = {"C1", "C2", "C3", "C4-Quad", "C4-Triangles", "C5"};
+  static const int instances[6] = {3, 4, 2, 1, 3, 4};
 
-  shaderPrograms["ACC2-C5"]->bind();
-  functions->glDrawArraysInstanced(GL_PATCHES, controlPointsOffsetsACC2["C5"], controlPointsSizesACC2["C5"], 4);
-  shaderPrograms["ACC2-C5"]->release();
+  drawList.clear();
+  for (int i = 0; i < 6; ++i) {
+    drawList.add(shaderPrograms["ACC1-" + QString(programs[i])], VAOACC1, 16, controlPointsOffsetsACC1.value(constellations[i]), controlPointsSizesACC1.value(constellations[i]), instances[i], &boundsACC1[constellations[i]]);
+    drawList.add(shaderPrograms["ACC2-" + QString(programs[i])], VAOACC2, 20, controlPointsOffsetsACC2.value(constellations[i]), controlPointsSizesACC2.value(constellations[i]), instances[i], &boundsACC2[constellations[i]]);
+  }
+  drawList.sort();
+}
 
-  functions->glBindVertexArray(0);
+void TransitionPatchRenderer::render() {
+  TRACE_ZONE("TransitionPatchRenderer::render");
+  functions->glPolygonMode(GL_FRONT_AND_BACK, showWireframe ? GL_LINE : GL_FILL);
+  drawList.cull(viewRect);
+  drawList.render(functions);
 }
 
 QHash<QString, int> TransitionPatchRenderer::getCountInfo() {
@@ -307,5 +210,23 @@ QHash<QString, int> TransitionPatchRenderer::getCountInfo() {
   countInfo["faces"] = countInfo["ACC1 faces"] + countInfo["ACC2 faces"];
   countInfo["control points"] = countInfo["ACC1 control points"] + countInfo["ACC2 control points"];
   countInfo["invocations"] = countInfo["ACC1 invocations"] + countInfo["ACC2 invocations"];
+  countInfo["draw calls"] = drawList.drawCalls();
+  countInfo["culled patches"] = drawList.culledPatches();
   return countInfo;
 }
+
+QHash<QString, qint64> TransitionPatchRenderer::getMemoryInfo() {
+  QHash<QString, qint64> memoryInfo = SurfaceRenderer::getMemoryInfo();
+  qint64 bytesACC1 = 0, bytesACC2 = 0;
+  foreach (const QVector<float> &data, datasACC1)
+    bytesACC1 += vectorBytes(data);
+  foreach (const QVector<float> &data, datasACC2)
+    bytesACC2 += vectorBytes(data);
+  memoryInfo["datasACC1"] = bytesACC1;
+  memoryInfo["datasACC2"] = bytesACC2;
+  foreach (const PatchBounds &bounds, boundsACC1)
+    memoryInfo["bounds"] += vectorBytes(bounds.data());
+  foreach (const PatchBounds &bounds, boundsACC2)
+    memoryInfo["bounds"] += vectorBytes(bounds.data());
+  return memoryInfo;
+}
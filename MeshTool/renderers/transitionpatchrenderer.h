@@ -2,6 +2,7 @@
 #define TRANSITIONPATCHRENDERER_H
 
 #include "surfacerenderer.h"
+#include "drawlist.h"
 #include "mesh.h"
 #include "qvector5d.h"
 #include <QVector>
@@ -17,6 +18,7 @@ public:
   void addControlPoints(Face f, QSet<int> transitionEdges);
   void setData();
   QHash<QString, int> getCountInfo();
+  QHash<QString, qint64> getMemoryInfo();
 
 private:
   GLuint VAOACC1, VBOACC1;
@@ -24,6 +26,11 @@ private:
   QHash<QString, QVector<float>> datasACC1, datasACC2;
   QHash<QString, int> controlPointsOffsetsACC1, controlPointsOffsetsACC2;
   QHash<QString, int> controlPointsSizesACC1, controlPointsSizesACC2;
+  QHash<QString, PatchBounds> boundsACC1, boundsACC2; // Per constellation
+  DrawList drawList;
+
+  void setBufferData(GLuint VBO, QString name, const QVector<float> &data);
+  void updateDrawList();
 
 };
 
@@ -7,18 +7,53 @@ layout (location = 0) in vec2 coordsOut[];
 layout (location = 1) in vec3 colorOut[];
 
 uniform int tessLevel;
+uniform vec2 viewportSize;
+uniform float segmentPixels;
+
+const float colorSegments = 32; // For a ramp over the full color range
 
 layout (location = 0) out vec2 coordsIn[];
 layout (location = 1) out vec3 colorIn[];
 
+// Segments along the curve between two corners. Neighbouring patches compute
+// their corners identically, so a shared edge gets the same factor
+float edgeLevel(vec2 p0, vec2 p1) {
+  if (segmentPixels <= 0)
+    return tessLevel;
+  return clamp(length((p1 - p0) * 0.5 * viewportSize) / segmentPixels, 1, 64);
+}
+
+// The interior follows the longest edge, or the color range of the patch
+// when that changes faster than its size
+float innerLevel(float edgesLevel) {
+  if (segmentPixels <= 0)
+    return tessLevel;
+  vec2 minCoords = coordsOut[0], maxCoords = coordsOut[0];
+  vec3 minColor = colorOut[0], maxColor = colorOut[0];
+  for (int i = 1; i < gl_PatchVerticesIn; ++i) {
+    minCoords = min(minCoords, coordsOut[i]);
+    maxCoords = max(maxCoords, coordsOut[i]);
+    minColor = min(minColor, colorOut[i]);
+    maxColor = max(maxColor, colorOut[i]);
+  }
+  vec3 colorRange = maxColor - minColor;
+  float extent = length((maxCoords - minCoords) * 0.5 * viewportSize);
+  float colorLevel = min(colorSegments * max(colorRange.r, max(colorRange.g, colorRange.b)), extent);
+  return clamp(max(edgesLevel, colorLevel), 1, 64);
+}
+
 void main() {
   if (gl_InvocationID == 0) {
-    gl_TessLevelInner[0] = tessLevel;
-    gl_TessLevelOuter[0] = tessLevel;
-    gl_TessLevelOuter[1] = tessLevel;
-    gl_TessLevelOuter[2] = tessLevel;
+    // Curve k runs from corner k to corner k + 1, opposite the corner k + 2
+    float edgesLevel = 1;
+    for (int k = 0; k < 3; ++k) {
+      float level = edgeLevel(coordsOut[5 * k], coordsOut[5 * ((k + 1) % 3)]);
+      gl_TessLevelOuter[(k + 2) % 3] = level;
+      edgesLevel = max(edgesLevel, level);
+    }
+    gl_TessLevelInner[0] = innerLevel(edgesLevel);
   }
 
-  coordsIn[gl_InvocationID] = coordsIn[gl_InvocationID];
-  colorIn[gl_InvocationID] = colorIn[gl_InvocationID];
+  coordsIn[gl_InvocationID] = coordsOut[gl_InvocationID];
+  colorIn[gl_InvocationID] = colorOut[gl_InvocationID];
 }
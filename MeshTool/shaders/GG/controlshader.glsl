@@ -7,18 +7,70 @@ layout (location = 0) in vec2 coordsOut[];
 layout (location = 1) in vec3 colorOut[];
 layout (location = 2) flat in int instanceOut[];
 
+uniform vec2 scaling;
+uniform vec2 displacement;
 uniform int tessLevel;
+uniform vec2 viewportSize;
+uniform float segmentPixels;
+
+const float colorSegments = 32; // For a ramp over the full color range
+const int N = /* N */;
 
 layout (location = 0) out vec2 coordsIn[];
 layout (location = 1) out vec3 colorIn[];
 patch out int instance;
 
+// Same expression as the vertex shader of ACC2, whose patches share edges
+// with these
+vec2 project(vec2 coords) {
+  return scaling * (displacement + coords);
+}
+
+// Segments along the curve between two corners. Neighbouring patches compute
+// their corners identically, so a shared edge gets the same factor
+float edgeLevel(vec2 p0, vec2 p1) {
+  if (segmentPixels <= 0)
+    return tessLevel;
+  return clamp(length((p1 - p0) * 0.5 * viewportSize) / segmentPixels, 1, 64);
+}
+
+// The interior follows the longest edge, or the color range of the patch
+// when that changes faster than its size
+float innerLevel(float edgesLevel) {
+  if (segmentPixels <= 0)
+    return tessLevel;
+  vec2 minCoords = coordsOut[0], maxCoords = coordsOut[0];
+  vec3 minColor = colorOut[0], maxColor = colorOut[0];
+  for (int i = 1; i < gl_PatchVerticesIn; ++i) {
+    minCoords = min(minCoords, coordsOut[i]);
+    maxCoords = max(maxCoords, coordsOut[i]);
+    minColor = min(minColor, colorOut[i]);
+    maxColor = max(maxColor, colorOut[i]);
+  }
+  vec3 colorRange = maxColor - minColor;
+  float extent = length(scaling * (maxCoords - minCoords) * 0.5 * viewportSize);
+  float colorLevel = min(colorSegments * max(colorRange.r, max(colorRange.g, colorRange.b)), extent);
+  return clamp(max(edgesLevel, colorLevel), 1, 64);
+}
+
 void main() {
   if (gl_InvocationID == 0) {
-    gl_TessLevelInner[0] = tessLevel;
-    gl_TessLevelOuter[0] = tessLevel;
-    gl_TessLevelOuter[1] = tessLevel;
-    gl_TessLevelOuter[2] = tessLevel;
+    // Instance i is the triangle of the center, corner i - 1 and corner i.
+    // The spokes are shared with instances i - 1 and i + 1, which compute the
+    // center in the same order.
+    int i = instanceOut[0];
+    vec2 center = vec2(0);
+    for (int j = 0; j < N; ++j)
+      center += coordsOut[5 * j];
+    center /= N;
+    center = project(center);
+    vec2 previous = project(coordsOut[5 * ((i + N - 1) % N)]);
+    vec2 current = project(coordsOut[5 * i]);
+    gl_TessLevelOuter[0] = edgeLevel(previous, current);
+    gl_TessLevelOuter[1] = edgeLevel(center, current);
+    gl_TessLevelOuter[2] = edgeLevel(center, previous);
+    float edgesLevel = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));
+    gl_TessLevelInner[0] = innerLevel(edgesLevel);
 
     instance = instanceOut[0];
   }
@@ -0,0 +1,22 @@
+#version 410
+// Fragment shader
+
+// Difference texels hold (distance, distance, covered). Every pass folds
+// 2x2 texels into one: the maximum of r and the sums of g and b.
+uniform sampler2D source;
+
+layout (location = 0) out vec4 fColor;
+
+void main() {
+  ivec2 size = textureSize(source, 0);
+  ivec2 corner = 2 * ivec2(gl_FragCoord.xy);
+  vec3 result = vec3(0);
+  for (int i = 0; i < 4; ++i) {
+    ivec2 texel = corner + ivec2(i & 1, i >> 1);
+    if (texel.x < size.x && texel.y < size.y) {
+      vec3 value = texelFetch(source, texel, 0).rgb;
+      result = vec3(max(result.r, value.r), result.gb + value.gb);
+    }
+  }
+  fColor = vec4(result, 1);
+}
@@ -0,0 +1,8 @@
+#version 410
+// Vertex shader
+
+// One triangle covering the viewport
+void main() {
+  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  gl_Position = vec4(2 * corner - 1, 0, 1);
+}
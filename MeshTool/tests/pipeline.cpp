@@ -0,0 +1,28 @@
+#include "pipeline.h"
+#include "tools/subdivision.h"
+#include "tools/editing.h"
+
+void Pipeline::subdivideLevel(int level, Mesh *originalMesh) {
+  originalMesh->clear();
+  if (level == 0)
+    subdivideTernaryStep(&inputMesh, originalMesh);
+  else
+    subdivideCatmullClark(&editedMeshes[level-1], originalMesh);
+}
+
+void Pipeline::editLevel(int level, Mesh *originalMesh, Mesh *editedMesh) {
+  computeEditedMesh(originalMesh, coordsEdits.value(level), colorEdits.value(level), editedMesh);
+}
+
+void Pipeline::compute(int levels) {
+  originalMeshes.clear();
+  editedMeshes.clear();
+  limitMeshes.clear();
+  for (int level = 0; level <= levels; ++level) {
+    Mesh &originalMesh = originalMeshes.append();
+    subdivideLevel(level, &originalMesh);
+    Mesh &editedMesh = editedMeshes.append();
+    editLevel(level, &originalMesh, &editedMesh);
+    computeLimitMesh(&editedMesh, &limitMeshes.append());
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "mesh.h"
+#include "coordsedit.h"
+#include "coloredit.h"
+#include "tools/changeset.h"
+#include "tools/levelpool.h"
+#include <QHash>
+
+// Meshes and edits of one input, laid out like in MainView. Shared by the
+// tests and the bench, which times the steps of a level one by one.
+class Pipeline {
+  public:
+    Mesh inputMesh;
+    QHash<int, QHash<int, CoordsEdit>> coordsEdits;
+    QHash<int, QHash<int, ColorEdit>> colorEdits;
+    LevelPool<Mesh> originalMeshes, editedMeshes, limitMeshes;
+    ChangeSet changedLimitCoordsIndices, changedEdgesIndices, changedFacesIndices;
+
+    // The steps of a level, the levels below it must be computed
+    void subdivideLevel(int level, Mesh *originalMesh);
+    void editLevel(int level, Mesh *originalMesh, Mesh *editedMesh);
+
+    // Recompute all levels from the input mesh and the edits
+    void compute(int levels);
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,34 @@
+#-------------------------------------------------
+#
+# Tests of the subdivision and editing pipeline
+#
+#-------------------------------------------------
+
+QT       += core gui concurrent testlib
+
+TARGET = meshtool-tests
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+# Build against the sources of the application
+MESHTOOL = $$PWD/..
+INCLUDEPATH += $$MESHTOOL
+DEFINES += MODELS_DIR=\\\"$$MESHTOOL/models\\\"
+
+SOURCES += tst_coordsstencil.cpp \
+    pipeline.cpp \
+    $$MESHTOOL/mesh.cpp \
+    $$MESHTOOL/persistence.cpp \
+    $$MESHTOOL/qvector5d.cpp \
+  $$MESHTOOL/tools/convenience.cpp \
+  $$MESHTOOL/tools/coordsstencil.cpp \
+  $$MESHTOOL/tools/editfootprint.cpp \
+  $$MESHTOOL/tools/editing.cpp \
+  $$MESHTOOL/tools/foldover.cpp \
+  $$MESHTOOL/tools/memoryusage.cpp \
+  $$MESHTOOL/tools/sparsehierarchy.cpp \
+  $$MESHTOOL/tools/subdivision.cpp \
+  $$MESHTOOL/tools/trace.cpp
+
+HEADERS  += pipeline.h
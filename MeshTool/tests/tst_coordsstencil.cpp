@@ -0,0 +1,100 @@
+#include "pipeline.h"
+#include "persistence.h"
+#include "tools/tools.h"
+#include "tools/levelpool.h"
+#include "tools/coordsstencil.h"
+#include <QtTest>
+
+#ifndef MODELS_DIR
+#define MODELS_DIR "models"
+#endif
+
+class TestCoordsStencil : public QObject {
+  Q_OBJECT
+
+private:
+  static const int LevelCount = 3;
+  QScopedPointer<Pipeline> levelsPointer;
+  int dragVertex = -1;
+  CoordsStencil stencil;
+
+  void moveDragVertex(QVector2D delta) {
+    Pipeline &levels = *levelsPointer;
+    Vertex originalVertex = levels.originalMeshes[0].Vertices[dragVertex];
+    levels.coordsEdits[0][dragVertex] = computeCoordsEdit(originalVertex, delta);
+  }
+
+  void compareWithRecompute() {
+    Pipeline &levels = *levelsPointer;
+    Pipeline reference;
+    levels.inputMesh.copyTo(&reference.inputMesh);
+    reference.coordsEdits = levels.coordsEdits;
+    reference.colorEdits = levels.colorEdits;
+    reference.compute(LevelCount);
+    for (int level = 0; level <= LevelCount; ++level) {
+      for (int i = 0; i < reference.editedMeshes[level].Vertices.size(); ++i) {
+        QVector2D difference = levels.editedMeshes[level].Vertices[i].coords - reference.editedMeshes[level].Vertices[i].coords;
+        QVERIFY2(difference.length() < 1e-4f, qPrintable(QString("edited vertex %1 of level %2").arg(i).arg(level)));
+      }
+      for (int i = 0; i < reference.limitMeshes[level].Vertices.size(); ++i) {
+        QVector2D difference = levels.limitMeshes[level].Vertices[i].coords - reference.limitMeshes[level].Vertices[i].coords;
+        QVERIFY2(difference.length() < 1e-4f, qPrintable(QString("limit vertex %1 of level %2").arg(i).arg(level)));
+      }
+    }
+  }
+
+private slots:
+  // An interior vertex of level 0 with a boundary edit of level 1 in its support
+  void init() {
+    levelsPointer.reset(new Pipeline());
+    Pipeline &levels = *levelsPointer;
+    load(MODELS_DIR "/Quad.obj", &levels.inputMesh, &levels.coordsEdits, &levels.colorEdits);
+    QVERIFY(!levels.inputMesh.Vertices.isEmpty());
+    levels.compute(LevelCount);
+
+    dragVertex = -1;
+    for (int i = 0; i < levels.originalMeshes[0].Vertices.size() && dragVertex < 0; ++i) {
+      if (!isBoundaryVertex(&levels.originalMeshes[0].Vertices[i]))
+        dragVertex = i;
+    }
+    QVERIFY(dragVertex >= 0);
+
+    // Boundary vertex of level 1 closest to it, moved outwards
+    Mesh &mesh = levels.originalMeshes[1];
+    QVector2D center = levels.originalMeshes[0].Vertices[dragVertex].coords;
+    int boundaryVertex = -1;
+    for (int i = 0; i < mesh.Vertices.size(); ++i) {
+      if (isBoundaryVertex(&mesh.Vertices[i]) && (boundaryVertex < 0 || (mesh.Vertices[i].coords - center).length() < (mesh.Vertices[boundaryVertex].coords - center).length()))
+        boundaryVertex = i;
+    }
+    CoordsEdit boundaryEdit = computeCoordsEdit(mesh.Vertices[boundaryVertex], .05f * mesh.Vertices[boundaryVertex].coords.normalized());
+    QVERIFY(boundaryEdit.boundary);
+    levels.coordsEdits[1][boundaryVertex] = boundaryEdit;
+    levels.compute(LevelCount);
+
+    buildCoordsStencil(levels.originalMeshes, levels.editedMeshes, levels.limitMeshes, levels.coordsEdits, dragVertex, 0, &stencil);
+    QVERIFY(stencil.exactEndLevel() < levels.originalMeshes.size());
+  }
+
+  void dragNextToBoundaryEdit() {
+    Pipeline &levels = *levelsPointer;
+    for (int step = 1; step <= 5; ++step) {
+      moveDragVertex(QVector2D(.02f, -.01f) * step);
+      applyCoordsStencil(stencil, levels.originalMeshes, levels.editedMeshes, levels.limitMeshes, levels.coordsEdits[0][dragVertex], 1, 0, levels.originalMeshes.size(), LevelCount, levels.changedFacesIndices, levels.changedLimitCoordsIndices);
+    }
+    compareWithRecompute();
+  }
+
+  // Levels skipped by a progressive drag, refined one at a time like MainView::refineNextLevel
+  void refineAfterProgressiveDrag() {
+    Pipeline &levels = *levelsPointer;
+    moveDragVertex(QVector2D(-.03f, .02f));
+    applyCoordsStencil(stencil, levels.originalMeshes, levels.editedMeshes, levels.limitMeshes, levels.coordsEdits[0][dragVertex], 1, 0, 1, LevelCount, levels.changedFacesIndices, levels.changedLimitCoordsIndices);
+    for (int level = 1; level < levels.originalMeshes.size(); ++level)
+      applyCoordsStencil(stencil, levels.originalMeshes, levels.editedMeshes, levels.limitMeshes, levels.coordsEdits[0][dragVertex], 1, level, level + 1, -1, levels.changedFacesIndices, levels.changedLimitCoordsIndices);
+    compareWithRecompute();
+  }
+};
+
+QTEST_GUILESS_MAIN(TestCoordsStencil)
+#include "tst_coordsstencil.moc"
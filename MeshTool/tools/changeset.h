@@ -0,0 +1,59 @@
+#ifndef CHANGESET_H
+#define CHANGESET_H
+
+#include <QBitArray>
+#include <QVector>
+
+// Set of changed element indices collected during one edit event. A bit per
+// index filters duplicates and a compact list keeps the unique indices for
+// consumers. clear() only resets the bits that were set, so the set can be
+// reused for every event at a cost proportional to its size.
+class ChangeSet {
+  public:
+    void insert(int index) {
+      ++raw;
+      if (index >= bits.size())
+        bits.resize(qMax(index + 1, 2 * bits.size()));
+      if (bits.testBit(index))
+        return;
+      bits.setBit(index);
+      list.append(index);
+    }
+
+    bool contains(int index) const {
+      return index < bits.size() && bits.testBit(index);
+    }
+
+    // Number of unique indices
+    int size() const {
+      return list.size();
+    }
+
+    // Number of insertions, including duplicates
+    int rawSize() const {
+      return raw;
+    }
+
+    bool isEmpty() const {
+      return list.isEmpty();
+    }
+
+    // Unique indices in insertion order
+    const QVector<int> &indices() const {
+      return list;
+    }
+
+    void clear() {
+      foreach (int index, list)
+        bits.clearBit(index);
+      list.resize(0);
+      raw = 0;
+    }
+
+  private:
+    QBitArray bits;
+    QVector<int> list;
+    int raw = 0;
+};
+
+#endif // CHANGESET_H
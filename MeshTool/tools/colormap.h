@@ -0,0 +1,14 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include <QStringList>
+#include <QVector>
+#include <QVector3D>
+
+// Colormaps of the difference view, selectable by name
+QStringList colormapNames();
+
+// Colors of a colormap from low to high, evenly spaced over [0, 1]
+QVector<QVector3D> sampleColormap(const QString &name, int samples = 256);
+
+#endif // COLORMAP_H
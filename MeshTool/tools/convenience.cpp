@@ -1,4 +1,5 @@
 #include "convenience.h"
+#include "trace.h"
 
 bool isBoundaryVertex(Vertex *v) {
   return !getCCWBoundaryEdge(v->out)->polygon;
@@ -10,10 +11,13 @@ bool isBoundaryEdge(HalfEdge *e) {
 
 bool isSmoothVertex(Vertex *v) {
   int sharpCount = 0;
-  foreach (HalfEdge *e, getVertexEdges(v->out))
-    if (isSharpEdge(e))
-      ++sharpCount;
-  return sharpCount <= 1;
+  HalfEdge *e = v->out;
+  for (int i = 0; i < v->val; ++i) {
+    if (isSharpEdge(e) && ++sharpCount > 1)
+      return false;
+    e = e->prev->twin;
+  }
+  return true;
 }
 
 bool isSharpEdge(HalfEdge *e) {
@@ -141,6 +145,8 @@ QSet<Face *> getPadded(QSet<Vertex *> inputVertices, int n) {
     }
   }
 
+  TRACE_COUNT(TracePaddedCalls, 1);
+  TRACE_COUNT(TracePaddedFaces, processedFaces.size());
   return processedFaces;
 }
 
@@ -157,9 +163,11 @@ QHash<int,QSet<Face *>> getColorAffectedFaces(QSet<int> selectedEdges, Mesh &mes
 }
 
 bool hasIrregularDirectNeighbour(Face f) {
-  foreach (HalfEdge *e, getFaceEdges(f.side)) {
+  HalfEdge *e = f.side;
+  for (int i = 0; i < f.val; ++i) {
     if (e->twin->polygon && e->twin->polygon->val != 4)
       return true;
+    e = e->next;
   }
   return false;
 }
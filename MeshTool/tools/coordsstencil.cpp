@@ -0,0 +1,259 @@
+#include "coordsstencil.h"
+#include "convenience.h"
+#include "editing.h"
+#include "trace.h"
+#include <QtConcurrent>
+
+// Stencils with more rows than this apply their levels in parallel
+static const int ParallelRows = 1 << 14;
+
+int CoordsStencil::rowCount() const {
+  int rows = 0;
+  foreach (const CoordsStencilLevel &level, levels)
+    rows += level.original.size() + level.edited.size() + level.limit.size();
+  return rows;
+}
+
+// Faces around the vertices with a weight
+static QSet<Face *> getSupportFaces(Mesh *mesh, const QHash<int, float> &weights) {
+  QSet<Face *> faces;
+  foreach (int vertexIndex, weights.keys()) {
+    Vertex *v = &mesh->Vertices[vertexIndex];
+    HalfEdge *e = v->out;
+    for (int i = 0; i < v->val; ++i) {
+      if (e->polygon)
+        faces << e->polygon;
+      e = e->prev->twin;
+    }
+  }
+  return faces;
+}
+
+// Weights of the Catmull-Clark subdivided mesh, the rules of updateOriginalCoords applied to weights
+static void subdivideWeights(Mesh *inputMesh, Mesh *subdivMesh, const QHash<int, float> &inputWeights, QHash<int, float> *weights) {
+  QSet<Face *> faces = getSupportFaces(inputMesh, inputWeights);
+  int faceOffset = inputMesh->Vertices.size() + inputMesh->HalfEdges.size() / 2;
+
+  // Vertices 'c'
+  foreach (Face *f, faces) {
+    float sum = 0;
+    HalfEdge *e = f->side;
+    for (int i = 0; i < f->val; ++i) {
+      sum += inputWeights.value(e->target->index);
+      e = e->next;
+    }
+    (*weights)[faceOffset + f->index] = sum / f->val;
+  }
+
+  // Vertices 'b'
+  foreach (Face *f, faces) {
+    HalfEdge *e = f->side;
+    for (int i = 0; i < f->val; ++i, e = e->next) {
+      int edgeVertex = subdivMesh->HalfEdges[4 * e->index].target->index;
+      if (weights->contains(edgeVertex))
+        continue;
+      float weight = inputWeights.value(e->target->index) + inputWeights.value(e->twin->target->index);
+      if (e->twin->polygon)
+        weight = (weight + weights->value(faceOffset + e->polygon->index) + weights->value(faceOffset + e->twin->polygon->index)) / 4;
+      else
+        weight /= 2;
+      (*weights)[edgeVertex] = weight;
+    }
+  }
+
+  // Vertices 'a'
+  foreach (Face *f, faces) {
+    HalfEdge *fe = f->side;
+    for (int i = 0; i < f->val; ++i, fe = fe->next) {
+      Vertex *v = fe->target;
+      if (weights->contains(v->index))
+        continue;
+      float weight;
+      HalfEdge *e = getCCWBoundaryEdge(v->out);
+      if (!e->polygon) {
+        if (v->val == 2)
+          weight = inputWeights.value(v->index);
+        else
+          weight = (inputWeights.value(e->target->index) + 6 * inputWeights.value(v->index) + inputWeights.value(e->prev->twin->target->index)) / 8;
+      } else {
+        float sumStar = 0, sumFace = 0;
+        int n = v->val;
+        e = v->out;
+        for (int j = 0; j < n; ++j) {
+          sumStar += inputWeights.value(e->target->index);
+          sumFace += weights->value(faceOffset + e->polygon->index);
+          e = e->prev->twin;
+        }
+        weight = ((n - 2) * inputWeights.value(v->index) + sumStar / n + sumFace / n) / n;
+      }
+      (*weights)[v->index] = weight;
+    }
+  }
+}
+
+// Whether a boundary edit moves a vertex, or relative to vertices, with a weight
+static bool hasBoundaryEdit(Mesh *mesh, const QHash<int, CoordsEdit> &coordsEdits, const QHash<int, float> &weights) {
+  foreach (const CoordsEdit &ce, coordsEdits) {
+    if (!ce.boundary)
+      continue;
+    Vertex *v = &mesh->Vertices[computeCoordsEditVertex(mesh, ce)];
+    if (weights.value(v->index) != 0)
+      return true;
+    HalfEdge *e = v->out;
+    for (int i = 0; i < v->val; ++i) {
+      if (weights.value(e->target->index) != 0)
+        return true;
+      e = e->prev->twin;
+    }
+  }
+  return false;
+}
+
+// Coordinate edits move their vertex relative to two neighbours, which adds the
+// difference of their weights. Levels with boundary edits in the support are not
+// part of the stencil.
+static void addEditWeights(Mesh *mesh, const QHash<int, CoordsEdit> &coordsEdits, QHash<int, float> *weights) {
+  QHash<int, float> originalWeights = *weights;
+  foreach (const CoordsEdit &ce, coordsEdits) {
+    HalfEdge *e1 = &mesh->HalfEdges[ce.edgeIndex];
+    HalfEdge *e2 = e1->prev->twin;
+    int vertexIndex = e1->twin->target->index;
+    float weight = originalWeights.value(vertexIndex);
+    float delta = ce.val1 * (originalWeights.value(e1->target->index) - weight) + ce.val2 * (originalWeights.value(e2->target->index) - weight);
+    if (delta != 0)
+      (*weights)[vertexIndex] += delta;
+  }
+}
+
+// Weight of the limit point, the rules of computeLimitPointCoords applied to weights
+static float computeLimitWeight(HalfEdge *inputEdge, const QHash<int, float> &weights) {
+  Vertex *v = inputEdge->prev->target;
+  int n = v->val;
+
+  if (!isBoundaryVertex(v)) {
+    float sum = 0;
+    HalfEdge *e = v->out;
+    for (int i = 0; i < n; ++i) {
+      float faceSum = 0;
+      HalfEdge *fe = e;
+      for (int j = 0; j < e->polygon->val; ++j) {
+        faceSum += weights.value(fe->target->index);
+        fe = fe->next;
+      }
+      sum += faceSum / e->polygon->val + (weights.value(e->prev->target->index) + weights.value(e->target->index)) / 2;
+      e = e->prev->twin;
+    }
+    return (n - 3.0f) / (n + 5) * weights.value(v->index) + 4.0f / (n * (n + 5)) * sum;
+  } else if (n == 2) {
+    return weights.value(v->index);
+  } else {
+    Vertex *first = getCCWBoundaryEdge(inputEdge)->target;
+    Vertex *last = getCWBoundaryEdge(inputEdge)->target;
+    return (weights.value(first->index) + 4 * weights.value(v->index) + weights.value(last->index)) / 6;
+  }
+}
+
+static void setRows(const QHash<int, float> &weights, Mesh &mesh, QVector2D displacement, StencilRows *rows) {
+  rows->indices.clear();
+  rows->weights.clear();
+  rows->base.clear();
+  for (QHash<int, float>::const_iterator it = weights.constBegin(); it != weights.constEnd(); ++it) {
+    if (it.value() == 0)
+      continue;
+    rows->indices.append(it.key());
+    rows->weights.append(it.value());
+    rows->base.append(mesh.Vertices[it.key()].coords - it.value() * displacement);
+  }
+}
+
+// Build the stencil of a vertex of the edit level for all computed levels. The levels
+// must be up to date with the current displacement of the vertex.
+void buildCoordsStencil(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, QHash<int, QHash<int, CoordsEdit>>& coordsEdits, int selectedVertex, int editLevel, CoordsStencil *stencil) {
+  TRACE_ZONE("buildCoordsStencil");
+  stencil->clear();
+  stencil->selectedVertex = selectedVertex;
+  stencil->editLevel = editLevel;
+  stencil->endLevel = originalMeshes.size();
+  stencil->levels.resize(originalMeshes.size() - editLevel);
+  QVector2D displacement = editedMeshes[editLevel].Vertices[selectedVertex].coords - originalMeshes[editLevel].Vertices[selectedVertex].coords;
+
+  QHash<int, float> editedWeights;
+  editedWeights[selectedVertex] = 1;
+  for (int level = editLevel; level < originalMeshes.size(); ++level) {
+    CoordsStencilLevel &stencilLevel = stencil->levels[level - editLevel];
+    if (level > editLevel) {
+      QHash<int, float> originalWeights;
+      subdivideWeights(&editedMeshes[level-1], &originalMeshes[level], editedWeights, &originalWeights);
+      if (hasBoundaryEdit(&originalMeshes[level], coordsEdits.value(level), originalWeights)) {
+        stencil->levels.resize(level - editLevel);
+        break;
+      }
+      setRows(originalWeights, originalMeshes[level], displacement, &stencilLevel.original);
+      editedWeights = originalWeights;
+      addEditWeights(&originalMeshes[level], coordsEdits.value(level), &editedWeights);
+    }
+    setRows(editedWeights, editedMeshes[level], displacement, &stencilLevel.edited);
+
+    // Limit points around the edited rows, and the faces whose patches use them
+    QHash<int, float> limitWeights;
+    QSet<Vertex *> vertices;
+    foreach (Face *f, getSupportFaces(&editedMeshes[level], editedWeights)) {
+      HalfEdge *e = f->side;
+      for (int i = 0; i < f->val; ++i) {
+        vertices << e->target;
+        if (!limitWeights.contains(e->target->index))
+          limitWeights[e->target->index] = computeLimitWeight(e->target->out, editedWeights);
+        e = e->next;
+      }
+    }
+    setRows(limitWeights, limitMeshes[level], displacement, &stencilLevel.limit);
+    stencilLevel.faceIndices.clear();
+    foreach (Face *f, getPadded(vertices, 1))
+      stencilLevel.faceIndices.append(f->index);
+  }
+}
+
+static void applyRows(const StencilRows &rows, Mesh &mesh, QVector2D displacement) {
+  const int *indices = rows.indices.constData();
+  const float *weights = rows.weights.constData();
+  const QVector2D *base = rows.base.constData();
+  Vertex *vertices = mesh.Vertices.data();
+  for (int i = 0; i < rows.size(); ++i)
+    vertices[indices[i]].coords = base[i] + weights[i] * displacement;
+}
+
+// Set the coordinates of the levels in [beginLevel, endLevel) for the current coordsEdit of the
+// stencil vertex. Levels above the exact ones are refined in order, the level below beginLevel
+// must be up to date.
+void applyCoordsStencil(const CoordsStencil &stencil, LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, CoordsEdit& coordsEdit, int editFlag, int beginLevel, int endLevel, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedLimitCoordsIndices) {
+  TRACE_ZONE("applyCoordsStencil");
+  QVector2D displacement = computeCoordsEditDelta(&originalMeshes[stencil.editLevel], coordsEdit) * editFlag;
+  QVector<int> levels;
+  for (int level = qMax(beginLevel, stencil.editLevel); level < qMin(endLevel, stencil.exactEndLevel()); ++level)
+    levels.append(level);
+
+  // Levels do not depend on each other
+  auto applyLevel = [&](int level) {
+    const CoordsStencilLevel &stencilLevel = stencil.levels[level - stencil.editLevel];
+    applyRows(stencilLevel.original, originalMeshes[level], displacement);
+    applyRows(stencilLevel.edited, editedMeshes[level], displacement);
+    applyRows(stencilLevel.limit, limitMeshes[level], displacement);
+    TRACE_COUNT(TraceStencilRows, stencilLevel.original.size() + stencilLevel.edited.size() + stencilLevel.limit.size());
+  };
+  if (levels.size() > 1 && stencil.rowCount() > ParallelRows)
+    QtConcurrent::blockingMap(levels, applyLevel);
+  else
+    foreach (int level, levels)
+      applyLevel(level);
+
+  if (levels.contains(displayLevel)) {
+    const CoordsStencilLevel &stencilLevel = stencil.levels[displayLevel - stencil.editLevel];
+    foreach (int faceIndex, stencilLevel.faceIndices)
+      changedFacesIndices.insert(faceIndex);
+    foreach (int vertexIndex, stencilLevel.limit.indices)
+      changedLimitCoordsIndices.insert(vertexIndex);
+  }
+
+  for (int level = qMax(beginLevel, stencil.exactEndLevel()); level < qMin(endLevel, originalMeshes.size()); ++level)
+    refineCoordsEdit(originalMeshes, editedMeshes, limitMeshes, coordsEdit, stencil.selectedVertex, editFlag, stencil.editLevel, level, displayLevel, changedFacesIndices, changedLimitCoordsIndices);
+}
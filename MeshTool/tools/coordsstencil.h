@@ -0,0 +1,65 @@
+#ifndef COORDSSTENCIL_H
+#define COORDSSTENCIL_H
+
+#include "mesh.h"
+#include "coordsedit.h"
+#include "changeset.h"
+#include "levelpool.h"
+#include <QHash>
+#include <QVector>
+
+// Vertices of one mesh that depend on the dragged vertex, with their weight
+// and their coordinates for a zero displacement
+class StencilRows {
+  public:
+    QVector<int> indices;
+    QVector<float> weights;
+    QVector<QVector2D> base;
+
+    int size() const {
+      return indices.size();
+    }
+};
+
+class CoordsStencilLevel {
+  public:
+    StencilRows original, edited, limit;
+    QVector<int> faceIndices; // Faces whose patches change with the edited rows
+};
+
+// Subdivision, coordinate edits on higher levels and limit evaluation are
+// linear in the coordinates, so every level depends on the displacement of a
+// dragged vertex through fixed weights. A stencil holds these weights from
+// the edit level on, a drag event then only scales and adds them.
+//
+// Boundary edits are not linear. The stencil stops below the first level
+// with one in its support, the levels from there on are refined by traversal.
+class CoordsStencil {
+  public:
+    int selectedVertex = -1;
+    int editLevel = -1;
+    int endLevel = -1; // Computed levels when built
+    QVector<CoordsStencilLevel> levels; // From the edit level on, up to the first inexact level
+
+    bool isValid(int vertex, int level, int endLevel) const {
+      return vertex == selectedVertex && level == editLevel && endLevel == this->endLevel;
+    }
+
+    int exactEndLevel() const {
+      return editLevel + levels.size();
+    }
+
+    void clear() {
+      selectedVertex = -1;
+      editLevel = -1;
+      endLevel = -1;
+      levels.clear();
+    }
+
+    int rowCount() const;
+};
+
+void buildCoordsStencil(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, QHash<int, QHash<int, CoordsEdit>>& coordsEdits, int selectedVertex, int editLevel, CoordsStencil *stencil);
+void applyCoordsStencil(const CoordsStencil &stencil, LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, CoordsEdit& coordsEdit, int editFlag, int beginLevel, int endLevel, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedLimitCoordsIndices);
+
+#endif // COORDSSTENCIL_H
@@ -0,0 +1,88 @@
+#ifndef DENSEMAP_H
+#define DENSEMAP_H
+
+#include <QVector>
+
+// Map from integer keys in [0, capacity) to values, meant for mesh element
+// indices. Stored as a sparse set: lookups and insertions index flat arrays
+// instead of hashing, clearing only touches the inserted keys, and keys()
+// lists the keys in insertion order.
+template <typename T>
+class DenseMap {
+  public:
+    DenseMap(int capacity = 0) {
+      setCapacity(capacity);
+    }
+
+    // Change the key range, clears the map
+    void setCapacity(int capacity) {
+      clear();
+      slots.resize(capacity);
+    }
+
+    // Clear and allow keys in [0, capacity). The slots only grow, so a map
+    // reused for ranges it has seen before clears in O(size()).
+    void reset(int capacity) {
+      clear();
+      if (slots.size() < capacity)
+        slots.resize(capacity);
+    }
+
+    int capacity() const {
+      return slots.size();
+    }
+
+    int size() const {
+      return keyList.size();
+    }
+
+    bool isEmpty() const {
+      return keyList.isEmpty();
+    }
+
+    bool contains(int key) const {
+      int slot = slots[key];
+      return slot < keyList.size() && keyList[slot] == key;
+    }
+
+    T value(int key, const T &defaultValue = T()) const {
+      return contains(key) ? valueList[slots[key]] : defaultValue;
+    }
+
+    T &operator[](int key) {
+      if (!contains(key))
+        insert(key, T());
+      return valueList[slots[key]];
+    }
+
+    void insert(int key, const T &value) {
+      if (contains(key)) {
+        valueList[slots[key]] = value;
+        return;
+      }
+      slots[key] = keyList.size();
+      keyList.append(key);
+      valueList.append(value);
+    }
+
+    // Keys and values in insertion order
+    const QVector<int> &keys() const {
+      return keyList;
+    }
+
+    const QVector<T> &values() const {
+      return valueList;
+    }
+
+    void clear() {
+      keyList.resize(0);
+      valueList.resize(0);
+    }
+
+  private:
+    QVector<int> slots;
+    QVector<int> keyList;
+    QVector<T> valueList;
+};
+
+#endif // DENSEMAP_H
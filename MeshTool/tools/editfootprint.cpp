@@ -0,0 +1,71 @@
+#include "editfootprint.h"
+#include "trace.h"
+#include <algorithm>
+
+template <typename Edit>
+static void addAffectedEdges(const QHash<int, QHash<int, Edit>> &edits, QVector<QVector<int>> *affected) {
+  foreach (int level, edits.keys()) {
+    if (level >= affected->size())
+      affected->resize(level + 1);
+    QVector<int> &edges = (*affected)[level];
+    foreach (const Edit &edit, edits[level])
+      edges += edit.affectedEdgeIndices;
+  }
+}
+
+static void sortUnique(QVector<int> *edges) {
+  std::sort(edges->begin(), edges->end());
+  edges->erase(std::unique(edges->begin(), edges->end()), edges->end());
+}
+
+void EditFootprint::build(const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits) {
+  TRACE_ZONE("EditFootprint::build");
+  clear();
+  addAffectedEdges(coordsEdits, &affected);
+  addAffectedEdges(colorEdits, &affected);
+  for (int level = 0; level < affected.size(); ++level)
+    sortUnique(&affected[level]);
+
+  // From the top down, the parents of a sorted level are sorted as well, so
+  // every level is a merge of the two levels above it
+  covered.resize(affected.size());
+  for (int level = affected.size() - 2; level >= 0; --level) {
+    QVector<int> &edges = covered[level];
+    edges.reserve(affected[level + 1].size() + covered[level + 1].size());
+    foreach (int edgeIndex, affected[level + 1])
+      edges.append(edgeIndex / 4);
+    int middle = edges.size();
+    foreach (int edgeIndex, covered[level + 1])
+      edges.append(edgeIndex / 4);
+    std::inplace_merge(edges.begin(), edges.begin() + middle, edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+  }
+}
+
+void EditFootprint::clear() {
+  affected.clear();
+  covered.clear();
+}
+
+bool EditFootprint::hasAffectedDescendant(int edgeIndex, int level) const {
+  if (level >= covered.size())
+    return false;
+  return std::binary_search(covered[level].constBegin(), covered[level].constEnd(), edgeIndex);
+}
+
+// The ancestor d levels up is e / 4^d, one binary search per level
+bool EditFootprint::hasAffectedAncestor(int edgeIndex, int level) const {
+  for (int ancestorLevel = qMin(level, affected.size() - 1); ancestorLevel >= 0; --ancestorLevel) {
+    int ancestorIndex = edgeIndex >> (2 * (level - ancestorLevel));
+    if (std::binary_search(affected[ancestorLevel].constBegin(), affected[ancestorLevel].constEnd(), ancestorIndex))
+      return true;
+  }
+  return false;
+}
+
+int EditFootprint::size() const {
+  int entries = 0;
+  for (int level = 0; level < affected.size(); ++level)
+    entries += affected[level].size() + covered[level].size();
+  return entries;
+}
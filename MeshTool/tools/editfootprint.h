@@ -0,0 +1,36 @@
+#ifndef EDITFOOTPRINT_H
+#define EDITFOOTPRINT_H
+
+#include "coordsedit.h"
+#include "coloredit.h"
+#include <QHash>
+#include <QVector>
+
+// Affected halfedges of all edits, indexed per level. Indices are those of the
+// uniformly subdivided mesh of the level, where halfedge e of one level has
+// the children 4 * e + x on the next. Sorted arrays over these indices form a
+// linear quadtree: the descendants of e, d levels down, are the contiguous
+// range [e * 4^d, (e + 1) * 4^d), and its ancestor is e / 4^d.
+class EditFootprint {
+  public:
+    void build(const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits);
+    void clear();
+
+    int levelCount() const {
+      return affected.size();
+    }
+
+    // Whether an edit on a higher level affects a child of the halfedge
+    bool hasAffectedDescendant(int edgeIndex, int level) const;
+
+    // Whether an edit on this or a lower level affects the halfedge or one of its ancestors
+    bool hasAffectedAncestor(int edgeIndex, int level) const;
+
+    int size() const;
+
+  private:
+    QVector<QVector<int>> affected;
+    QVector<QVector<int>> covered; // Ancestors of the affected halfedges of all higher levels
+};
+
+#endif // EDITFOOTPRINT_H
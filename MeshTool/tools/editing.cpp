@@ -1,173 +1,14 @@
 #include "editing.h"
 #include "convenience.h"
 #include "subdivision.h"
-#include "renderers/acc1renderer.h"
+#include "trace.h"
 #include <QtMath>
 #include <QStack>
 #include <QElapsedTimer>
 
-bool isSelfIntersecting(Face *f) {
-    // Collect ACC1 control points per ribbon
-    QVector<QVector2D> controlPointsCoords;
-    foreach (HalfEdge *e, getFaceEdges(f->side)) {
-        controlPointsCoords << ACC1Renderer::computeCornerPoint(e).coords();
-        controlPointsCoords << ACC1Renderer::computeEdgePoint(e, true).coords();
-        controlPointsCoords << ACC1Renderer::computeEdgePoint(e->twin, false).coords();
-        controlPointsCoords << ACC1Renderer::computeInteriorPoint(e).coords();
-    }
-
-    // Mapping from indices to grid location
-    //
-    // 12--10--9---8
-    // |   |   |   |
-    // 13--15--11--6
-    // |   |   |   |
-    // 14--3---7---5
-    // |   |   |   |
-    // 0---1---2---4
-
-    // Collect partial derivative vectors in u direction
-    QVector<QVector2D> derivativesU;
-    derivativesU << controlPointsCoords[1] - controlPointsCoords[0];
-    derivativesU << controlPointsCoords[2] - controlPointsCoords[1];
-    derivativesU << controlPointsCoords[4] - controlPointsCoords[2];
-    derivativesU << controlPointsCoords[3] - controlPointsCoords[14];
-    derivativesU << controlPointsCoords[7] - controlPointsCoords[3];
-    derivativesU << controlPointsCoords[5] - controlPointsCoords[7];
-    derivativesU << controlPointsCoords[15] - controlPointsCoords[13];
-    derivativesU << controlPointsCoords[11] - controlPointsCoords[15];
-    derivativesU << controlPointsCoords[6] - controlPointsCoords[11];
-    derivativesU << controlPointsCoords[10] - controlPointsCoords[12];
-    derivativesU << controlPointsCoords[9] - controlPointsCoords[10];
-    derivativesU << controlPointsCoords[8] - controlPointsCoords[9];
-
-    // Collect partial derivative vectors in v direction
-    QVector<QVector2D> derivativesV;
-    derivativesV << controlPointsCoords[14] - controlPointsCoords[0];
-    derivativesV << controlPointsCoords[13] - controlPointsCoords[14];
-    derivativesV << controlPointsCoords[12] - controlPointsCoords[13];
-    derivativesV << controlPointsCoords[3] - controlPointsCoords[1];
-    derivativesV << controlPointsCoords[15] - controlPointsCoords[3];
-    derivativesV << controlPointsCoords[10] - controlPointsCoords[15];
-    derivativesV << controlPointsCoords[7] - controlPointsCoords[2];
-    derivativesV << controlPointsCoords[11] - controlPointsCoords[7];
-    derivativesV << controlPointsCoords[9] - controlPointsCoords[11];
-    derivativesV << controlPointsCoords[5] - controlPointsCoords[4];
-    derivativesV << controlPointsCoords[6] - controlPointsCoords[5];
-    derivativesV << controlPointsCoords[8] - controlPointsCoords[6];
-
-    // Determine if polygon is self-intersecting
-    float magnitude1 = derivativesU[0].x() * derivativesV[0].y() - derivativesU[0].y() * derivativesV[0].x();
-    foreach (QVector2D derivativeU, derivativesU) {
-        foreach (QVector2D derivativeV, derivativesV) {
-            // The cross product of a pair of 2D vectors is: (a,b,0)x(c,d,0) = (0,0,ad-bc)
-            float magnitude = derivativeU.x() * derivativeV.y() - derivativeU.y() * derivativeV.x();
-            // Check if the signs are equal (equivalent to checking signs are positive, as the polygons are left rotating)
-            if (magnitude * magnitude1 <= 0)
-                return true;
-        }
-    }
-    return false;
-}
-
-bool isSelfIntersecting(Mesh *inputMesh, int selectedVertex) {
-    // Settings
-    int MAX_LEVEL = 5;
-
-    // Initialize
-    Mesh curMesh = *inputMesh;
-    QSet<int> paddedFaceIndicesCur;
-
-    for (int i = 0; /* specified below */; ++i) {
-        // Find self-intersecting face indices in current mesh
-        QSet<int> selfIntersectingFaceIndicesCur;
-        if(i == 0) {
-            Vertex *selectedOne = &curMesh.Vertices[selectedVertex];
-            QSet<Face *> faces = getPadded(QSet<Vertex *>({selectedOne}), 2);
-            foreach (Face *f, faces){
-                if (!paddedFaceIndicesCur.contains(f->index) && (f->val != 4 || isSelfIntersecting(f)))
-                    selfIntersectingFaceIndicesCur << f->index;
-            }
-        }
-        else {
-            foreach (Face f, curMesh.Faces)
-                if (!paddedFaceIndicesCur.contains(f.index) && (f.val != 4 || isSelfIntersecting(&f)))
-                    selfIntersectingFaceIndicesCur << f.index;
-        }
-
-        // Return conditions
-        if (selfIntersectingFaceIndicesCur.isEmpty())
-            return false;
-        if (i == MAX_LEVEL)
-            return true;
-
-        // Add padding
-        paddedFaceIndicesCur = getIndices(getPadded(getVertices(getFaces(&curMesh, selfIntersectingFaceIndicesCur)), 1)) - selfIntersectingFaceIndicesCur;
-
-        // Compute submesh
-        Mesh subMesh;
-        QHash<int, int> edgeMap;
-        computeSubMesh(&curMesh, paddedFaceIndicesCur + selfIntersectingFaceIndicesCur, &subMesh, &edgeMap);
-
-        // Catmull-Clark subdivide
-        Mesh subdivMesh;
-        subdivideCatmullClark(&subMesh, &subdivMesh);
-
-        // Map padded faces from current to subdivided mesh
-        QSet<int> paddedFaceIndicesSubdiv;
-        foreach (int paddedFaceIndexCur, paddedFaceIndicesCur) {
-            Face *paddedFaceCur = &curMesh.Faces[paddedFaceIndexCur];
-
-            // Map face from current mesh to submesh (using mapping of face sides)
-            Face *paddedFaceSub = subMesh.HalfEdges[edgeMap[paddedFaceCur->side->index]].polygon;
-
-            // Map edges of submesh to faces of subdivmesh
-            foreach (HalfEdge *e, getFaceEdges(paddedFaceSub->side))
-                paddedFaceIndicesSubdiv << e->index;
-        }
-
-        // Update
-        curMesh = subdivMesh;
-        paddedFaceIndicesCur = paddedFaceIndicesSubdiv;
-    }
-}
-
-int swapParentEdgeIndex(int childIndex, int parentIndex, int levels) {
-    QStack<int> childOffsets;
-    for (int i = 0; i < levels; ++i) {
-        childOffsets.push(childIndex % 4);
-        childIndex /= 4;
-    }
-    for (int i = 0; i < levels; ++i)
-        parentIndex = parentIndex * 4 + childOffsets.pop();
-    return parentIndex;
-}
-
-int computeParentEdgeIndex(int index, int levels) {
-    for (int i = 0; i < levels; ++i)
-        index /= 4;
-    return index;
-}
-
 void updateOriginalCoords(Mesh* subdivMesh, Mesh* inputMesh, int selectedVertex, int level) {
     QSet<Face *> faces = getPadded(QSet<Vertex *>({&inputMesh->Vertices[selectedVertex]}), pow(2, level));
 
-    // Compute sum of face valences
-    int sumFaceVal = 0;
-    for (int i = 0; i < inputMesh->Faces.size(); ++i)
-        sumFaceVal += inputMesh->Faces[i].val;
-
-    // Compute edge to vertex mapping for vertices 'b'
-    QHash<int, int> edgeVertexMapping;
-    int idx = inputMesh->Vertices.size();
-    for (int i = 0; i < sumFaceVal; ++i) {
-        HalfEdge e = inputMesh->HalfEdges[i];
-        if (e.index > e.twin->index)
-            continue;
-        edgeVertexMapping[e.index] = idx++;
-    }
-
-
     // --- UPDATE VERTICES ---
 
     // Vertices 'c'
@@ -208,9 +49,8 @@ void updateOriginalCoords(Mesh* subdivMesh, Mesh* inputMesh, int selectedVertex,
                 coord = (e.target->coords + e.twin->target->coords) / 2;
             }
 
-            // Assign
-            int idx = edgeVertexMapping[e.index];
-            subdivMesh->Vertices[idx].coords = coord;
+            // Assign (halfedge '0' of e targets its vertex 'b', see subdivideCatmullClark)
+            subdivMesh->HalfEdges[4 * e.index].target->coords = coord;
         }
     }
 
@@ -251,43 +91,57 @@ void updateOriginalCoords(Mesh* subdivMesh, Mesh* inputMesh, int selectedVertex,
     }
 }
 
+// Vertex moved by a coordinate edit
+int computeCoordsEditVertex(Mesh *mesh, const CoordsEdit &ce) {
+    HalfEdge *e = &mesh->HalfEdges[ce.edgeIndex];
+    return ce.boundary ? e->target->index : e->twin->target->index;
+}
+
+// Displacement of a coordinate edit, relative to the two edges of the sector it points into
+QVector2D computeCoordsEditDelta(Mesh *mesh, const CoordsEdit &ce) {
+    if (!ce.boundary) {
+        HalfEdge *e1 = &mesh->HalfEdges[ce.edgeIndex];
+        HalfEdge *e2 = e1->prev->twin;
+        Vertex *v = e1->twin->target;
+        QVector2D vec1 = e1->target->coords - v->coords;
+        QVector2D vec2 = e2->target->coords - v->coords;
+        return ce.val1 * vec1 + ce.val2 * vec2;
+    }
+    HalfEdge *e1 = mesh->HalfEdges[ce.edgeIndex].twin;
+    HalfEdge *e2 = e1->prev->twin;
+    Vertex *v = e1->twin->target;
+    QVector2D vec1 = e1->target->coords - v->coords;
+    QVector2D vec2 = e2->target->coords - v->coords;
+    // Compute angle between e1 and e2
+    float alpha = atan2(vec2.y(), vec2.x()) - atan2(vec1.y(), vec1.x());
+    if (alpha < 0)
+        alpha += 2 * M_PI;
+    // Infer angle between e1 and displacement
+    float phi = alpha * ce.val1;
+    // Compute displacement
+    float angle = atan2(vec1.y(), vec1.x()) + phi; // Angle with respect to horizontal
+    QVector2D direction(cos(angle), sin(angle));
+    float length = sqrt(ce.val2 * sqrt(vec1.lengthSquared() * vec2.lengthSquared())); // Solve <equation in paper> = ce.b for delta p
+    return length * direction;
+}
+
 Mesh computeEditedMesh(Mesh inputMesh, QHash<int, CoordsEdit> coordsEdits, QHash<int, ColorEdit> colorEdits) {
-    Mesh outputMesh = inputMesh.copy();
-    foreach (CoordsEdit ce, coordsEdits.values()) {
-        if (!ce.boundary) {
-            HalfEdge *e1 = &inputMesh.HalfEdges[ce.edgeIndex];
-            HalfEdge *e2 = e1->prev->twin;
-            Vertex v = inputMesh.Vertices[e1->twin->target->index];
-            QVector2D vec1 = e1->target->coords - v.coords;
-            QVector2D vec2 = e2->target->coords - v.coords;
-            QVector2D deltaCoords = ce.val1 * vec1 + ce.val2 * vec2;
-            outputMesh.Vertices[v.index].coords += deltaCoords;
-        } else {
-            HalfEdge *e1 = inputMesh.HalfEdges[ce.edgeIndex].twin;
-            HalfEdge *e2 = e1->prev->twin;
-            Vertex v = inputMesh.Vertices[e1->twin->target->index];
-            QVector2D vec1 = e1->target->coords - v.coords;
-            QVector2D vec2 = e2->target->coords - v.coords;
-            // Compute angle between e1 and e2
-            float alpha = atan2(vec2.y(), vec2.x()) - atan2(vec1.y(), vec1.x());
-            if (alpha < 0)
-                alpha += 2 * M_PI;
-            // Infer angle between e1 and displacement
-            float phi = alpha * ce.val1;
-            // Compute displacement
-            float angle = atan2(vec1.y(), vec1.x()) + phi; // Angle with respect to horizontal
-            QVector2D direction(cos(angle), sin(angle));
-            float length = sqrt(ce.val2 * sqrt(vec1.lengthSquared() * vec2.lengthSquared())); // Solve <equation in paper> = ce.b for delta p
-            QVector2D deltaCoords = length * direction;
-            // Update
-            outputMesh.Vertices[v.index].coords += deltaCoords;
-        }
+    Mesh outputMesh;
+    computeEditedMesh(&inputMesh, coordsEdits, colorEdits, &outputMesh);
+    return outputMesh;
+}
+
+void computeEditedMesh(Mesh *inputMesh, const QHash<int, CoordsEdit> &coordsEdits, const QHash<int, ColorEdit> &colorEdits, Mesh *outputMesh) {
+    inputMesh->copyTo(outputMesh);
+    foreach (const CoordsEdit &ce, coordsEdits) {
+        int vertexIndex = computeCoordsEditVertex(inputMesh, ce);
+        outputMesh->Vertices[vertexIndex].coords += computeCoordsEditDelta(inputMesh, ce);
     }
 
     // Assign colors to halfedges of single sector
     foreach (ColorEdit edit, colorEdits) {
         // Apply edit
-        HalfEdge *editedEdge = &outputMesh.HalfEdges[edit.edgeIndex];
+        HalfEdge *editedEdge = &outputMesh->HalfEdges[edit.edgeIndex];
         editedEdge->color = edit.color;
 
         // Patch one ring neighbourhood
@@ -309,7 +163,7 @@ Mesh computeEditedMesh(Mesh inputMesh, QHash<int, CoordsEdit> coordsEdits, QHash
     }
     // Assign edge sharpness
     foreach (ColorEdit edit, colorEdits) {
-        HalfEdge *e = &outputMesh.HalfEdges[edit.edgeIndex];
+        HalfEdge *e = &outputMesh->HalfEdges[edit.edgeIndex];
         if (!e->twin->polygon || e->color != e->twin->next->color) {
             e->isSharp = true;
             e->twin->isSharp = true;
@@ -327,20 +181,68 @@ Mesh computeEditedMesh(Mesh inputMesh, QHash<int, CoordsEdit> coordsEdits, QHash
             e->prev->prev->twin->prev->prev->twin->prev->twin->isSharp = true;
         }
     }
+}
 
-    return outputMesh;
+// Express a displacement of v as a coordinate edit relative to the edges of the sector it points into
+CoordsEdit computeCoordsEdit(Vertex v, QVector2D deltaCoords) {
+    HalfEdge *e1 = v.out;
+    for (int i = 0; i < v.val; ++i) {
+        HalfEdge *e2 = e1->prev->twin;
+        QVector2D vec1 = e1->target->coords - v.coords;
+        QVector2D vec2 = e2->target->coords - v.coords;
+        // Compute angle between e1 and e2
+        float alpha = atan2(vec2.y(), vec2.x()) - atan2(vec1.y(), vec1.x());
+        if (alpha < 0)
+            alpha += 2 * M_PI;
+        // Compute angle between e1 and displacement
+        float phi = atan2(deltaCoords.y(), deltaCoords.x()) - atan2(vec1.y(), vec1.x());
+        if (phi < 0)
+            phi += 2 * M_PI;
+        // Continue if wrong sector
+        if (phi > alpha) {
+            e1 = e1->prev->twin;
+            continue;
+        }
+        // Check if boundary or interior point
+        CoordsEdit ce;
+        if (e1->polygon) {
+            // Let WolframAlpha solve 'solve x = a x_1 + b x_2, y = a y_1 + b y_2 for a and b'
+            float a = -(deltaCoords.x() * vec2.y() - vec2.x() * deltaCoords.y()) / (vec2.x() * vec1.y() - vec1.x() * vec2.y());
+            float b = -(vec1.x() * deltaCoords.y() - deltaCoords.x() * vec1.y()) / (vec2.x() * vec1.y() - vec1.x() * vec2.y());
+            ce.edgeIndex = e1->index;
+            ce.val1 = a;
+            ce.val2 = b;
+            ce.boundary = false;
+        } else {
+            ce.edgeIndex = e1->twin->index;
+            ce.val1 = phi / alpha;
+            ce.val2 = deltaCoords.lengthSquared() / sqrt(vec1.lengthSquared() * vec2.lengthSquared());
+            ce.boundary = true;
+        }
+        // Update affected edge indices
+        QSet<Face *> twoRingFaces = getPadded(QSet<Vertex *>({&v}), 2);
+        foreach (Face *f, twoRingFaces)
+            ce.affectedEdgeIndices << f->side->index;
+        //        for (int i = 0; i < changedFacesIndices.size(); i ++)
+        //            ce.affectedEdgeIndices << originalMeshes[getEditSteps()].Faces[i].side->index;
+
+        // Return
+        return ce;
+    }
+    return CoordsEdit();
 }
 
 //level = 0: at edit step
 //level > 0: compute next steps of edit step
-void updateEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, QVector<int>& influencedFacesIndices, int level, bool curSubdivStep) {
+void updateEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, ChangeSet& influencedFacesIndices, int level, bool curSubdivStep) {
     CoordsEdit ce = coordsEdit;
     Vertex *selectedOne = &editedMesh.Vertices[selectedVertex];
 
     QSet<Face *> faces = getPadded(QSet<Vertex *>({selectedOne}), pow(2, level+1));
+    TRACE_COUNT(TraceFacesVisited, faces.size());
     if(curSubdivStep) {
         foreach(Face *oneface, faces) {
-            influencedFacesIndices.append(oneface->index);
+            influencedFacesIndices.insert(oneface->index);
         }
     }
 
@@ -354,42 +256,13 @@ void updateEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coords
                 affectedVertex->coords = originalMesh.Vertices[vertexIndex].coords;
                 oneEdge = oneEdge->next;
             }
-            //            influencedFacesIndices.append(oneface->index);
+            //            influencedFacesIndices.insert(oneface->index);
         }
     }
     //Compute selected point coords
     else {
-
-
-        if (!ce.boundary) {
-            HalfEdge *e1 = &originalMesh.HalfEdges[ce.edgeIndex];
-            HalfEdge *e2 = e1->prev->twin;
-            Vertex v = originalMesh.Vertices[e1->twin->target->index];
-            QVector2D vec1 = e1->target->coords - v.coords;
-            QVector2D vec2 = e2->target->coords - v.coords;
-            QVector2D deltaCoords = ce.val1 * vec1 + ce.val2 * vec2;
-            editedMesh.Vertices[v.index].coords = originalMesh.Vertices[v.index].coords + deltaCoords * editFlag;
-        } else {
-            HalfEdge *e1 = originalMesh.HalfEdges[ce.edgeIndex].twin;
-            HalfEdge *e2 = e1->prev->twin;
-            Vertex v = originalMesh.Vertices[e1->twin->target->index];
-            QVector2D vec1 = e1->target->coords - v.coords;
-            QVector2D vec2 = e2->target->coords - v.coords;
-            // Compute angle between e1 and e2
-            float alpha = atan2(vec2.y(), vec2.x()) - atan2(vec1.y(), vec1.x());
-            if (alpha < 0)
-                alpha += 2 * M_PI;
-            // Infer angle between e1 and displacement
-            float phi = alpha * ce.val1;
-            // Compute displacement
-            float angle = atan2(vec1.y(), vec1.x()) + phi; // Angle with respect to horizontal
-            QVector2D direction(cos(angle), sin(angle));
-            float length = sqrt(ce.val2 * sqrt(vec1.lengthSquared() * vec2.lengthSquared())); // Solve <equation in paper> = ce.b for delta p
-            QVector2D deltaCoords = length * direction;
-            // Update
-            editedMesh.Vertices[v.index].coords = originalMesh.Vertices[v.index].coords + deltaCoords * editFlag;
-        }
-
+        int vertexIndex = computeCoordsEditVertex(&originalMesh, ce);
+        editedMesh.Vertices[vertexIndex].coords = originalMesh.Vertices[vertexIndex].coords + computeCoordsEditDelta(&originalMesh, ce) * editFlag;
     }
 }
 
@@ -398,30 +271,16 @@ void updateEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coords
 //max subdivided level is b, b >= a,
 //level = b-a
 //level helps to make sure the affected faces in any subdivision step which is larger than the edit level.
-void updateLimitCoords(Mesh &editedMesh, Mesh &limitMesh, int selectedVertex, QVector<int>& changedLimitCoordsIndices, int level, bool curSubdivStep) {
+void updateLimitCoords(Mesh &editedMesh, Mesh &limitMesh, int selectedVertex, ChangeSet& changedLimitCoordsIndices, int level, bool curSubdivStep) {
     //Update the coord of the selected vertex
     Vertex *selectedOne = &limitMesh.Vertices[selectedVertex];
     selectedOne->coords = computeLimitPointCoords(editedMesh.Vertices[selectedVertex].out);
 
     //Update the coords of the around vertex
-    QSet<int> changedVertex;
     QSet<Face *> faces = getPadded(QSet<Vertex *>({selectedOne}), pow(2, level+1));
 
-    if(curSubdivStep) {
-        changedLimitCoordsIndices.append(selectedVertex);
-        foreach(Face *oneface, faces) {
-            HalfEdge *oneEdge = oneface->side;
-            for(int i = 0; i < oneface->val; i ++) {
-                if(oneEdge->target != selectedOne) {
-                    Vertex *affectedVertex = oneEdge->target;
-                    int vertexIndex = affectedVertex->index;
-                    //                    affectedVertex->coords = computeLimitPointCoords(editedMesh.Vertices[vertexIndex].out);
-                    changedLimitCoordsIndices.append(vertexIndex);
-                }
-                oneEdge = oneEdge->next;
-            }
-        }
-    }
+    if(curSubdivStep)
+        changedLimitCoordsIndices.insert(selectedVertex);
 
     foreach(Face *oneface, faces) {
         HalfEdge *oneEdge = oneface->side;
@@ -430,7 +289,8 @@ void updateLimitCoords(Mesh &editedMesh, Mesh &limitMesh, int selectedVertex, QV
                 Vertex *affectedVertex = oneEdge->target;
                 int vertexIndex = affectedVertex->index;
                 affectedVertex->coords = computeLimitPointCoords(editedMesh.Vertices[vertexIndex].out);
-                changedLimitCoordsIndices.append(vertexIndex);
+                if(curSubdivStep)
+                    changedLimitCoordsIndices.insert(vertexIndex);
             }
             oneEdge = oneEdge->next;
         }
@@ -473,21 +333,6 @@ void deleteEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coords
 
 void updateOriginalColor(Mesh* subdivMesh, Mesh* inputMesh, QSet<int>& selectedEdges, int level, QHash<int, QSet<Face *>> affectedFaces) {
 
-    // Compute sum of face valences
-    int sumFaceVal = 0;
-    for (int i = 0; i < inputMesh->Faces.size(); ++i)
-        sumFaceVal += inputMesh->Faces[i].val;
-
-    // Compute edge to vertex mapping for vertices 'b'
-    QHash<int, int> edgeVertexMapping;
-    int idx = inputMesh->Vertices.size();
-    for (int i = 0; i < sumFaceVal; ++i) {
-        HalfEdge e = inputMesh->HalfEdges[i];
-        if (e.index > e.twin->index)
-            continue;
-        edgeVertexMapping[e.index] = idx++;
-    }
-
     // Vertices 'c'
     foreach (QSet<Face *> oneEdgeAffectedfaces, affectedFaces.values()) {
         foreach(Face *oneFace, oneEdgeAffectedfaces) {
@@ -568,11 +413,11 @@ void updateOriginalColor(Mesh* subdivMesh, Mesh* inputMesh, QSet<int>& selectedE
     }
 }
 
-void updateEditedColor(Mesh& originalMesh, Mesh& editedMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep, QVector<int>& changedFacesIndices) {
+void updateEditedColor(Mesh& originalMesh, Mesh& editedMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep, ChangeSet& changedFacesIndices) {
     if(curSubdivStep) {
         foreach (QSet<Face *> oneEdgeAffectedfaces, affectedFaces.values()) {
             foreach(Face *oneFace, oneEdgeAffectedfaces) {
-                changedFacesIndices << oneFace->index;
+                changedFacesIndices.insert(oneFace->index);
             }
         }
     }
@@ -632,7 +477,7 @@ void updateEditedColor(Mesh& originalMesh, Mesh& editedMesh, QHash<int, ColorEdi
     }
 }
 
-void updateLimitMeshColor(Mesh& editedMesh, Mesh& limitMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, QVector<int>& changedEdgesIndices, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep) {
+void updateLimitMeshColor(Mesh& editedMesh, Mesh& limitMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, ChangeSet& changedEdgesIndices, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep) {
 
     if (curSubdivStep) {
         foreach(QSet<Face *> ff, affectedFaces.values()) {
@@ -642,7 +487,7 @@ void updateLimitMeshColor(Mesh& editedMesh, Mesh& limitMesh, QHash<int, ColorEdi
 
                     foreach (HalfEdge *fe, getFaceEdges(edge)) {
 
-                        changedEdgesIndices.append(fe->index);
+                        changedEdgesIndices.insert(fe->index);
                     }
                 }
             }
@@ -664,6 +509,46 @@ void updateLimitMeshColor(Mesh& editedMesh, Mesh& limitMesh, QHash<int, ColorEdi
 
 }
 
+// Propagate a coordinate edit made at editLevel to the computed levels above it, up to endLevel (exclusive)
+void propagateCoordsEdit(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, int editLevel, int endLevel, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedLimitCoordsIndices) {
+    //update coords of editedmesh & limitmesh at current edit step
+    updateEditedCoords(originalMeshes[editLevel], editedMeshes[editLevel], coordsEdit, selectedVertex, editFlag, changedFacesIndices, 0, displayLevel == editLevel);
+    updateLimitCoords(editedMeshes[editLevel], limitMeshes[editLevel], selectedVertex, changedLimitCoordsIndices, 0, displayLevel == editLevel);
+
+    //update coords of originalmesh & editedmesh & limitmesh from the next step of current edit step to the end level
+    for (int i = editLevel + 1; i < qMin(endLevel, originalMeshes.size()); i++)
+        refineCoordsEdit(originalMeshes, editedMeshes, limitMeshes, coordsEdit, selectedVertex, editFlag, editLevel, i, displayLevel, changedFacesIndices, changedLimitCoordsIndices);
+}
+
+// Bring one level above editLevel up to date with a coordinate edit, the level below must be up to date.
+// Only the final state of the edit matters, so a level skipped during a drag is refined by a single call.
+void refineCoordsEdit(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, int editLevel, int level, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedLimitCoordsIndices) {
+    updateOriginalCoords(&originalMeshes[level], &editedMeshes[level-1], selectedVertex, level - editLevel);
+    updateEditedCoords(originalMeshes[level], editedMeshes[level], coordsEdit, selectedVertex, editFlag, changedFacesIndices, level - editLevel, displayLevel == level);
+    updateLimitCoords(editedMeshes[level], limitMeshes[level], selectedVertex, changedLimitCoordsIndices, level - editLevel, displayLevel == level);
+}
+
+// Propagate a color edit made at editLevel to all computed levels above it
+void propagateColorEdit(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, int editLevel, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedEdgesIndices) {
+    //update color of editedmesh & limitmesh at current edit step
+    QHash<int, QSet<Face *>> affectedEditedfaces = getColorAffectedFaces(selectedEdges, editedMeshes[editLevel], 0);
+    updateEditedColor(originalMeshes[editLevel], editedMeshes[editLevel], colorEdits, selectedEdges, 0, affectedEditedfaces, displayLevel == editLevel, changedFacesIndices);
+    QHash<int, QSet<Face *>> affectedfaces = getColorAffectedFaces(selectedEdges, limitMeshes[editLevel], 0);
+    updateLimitMeshColor(editedMeshes[editLevel], limitMeshes[editLevel], colorEdits, selectedEdges, changedEdgesIndices, 0, affectedfaces, displayLevel == editLevel);
+
+    //update color of originalmesh & editedmesh & limitmesh from the next step of current edit step to max computed subdivision level
+    int level = 1;
+    for (int i = editLevel + 1; i < originalMeshes.size(); i++, level++) {
+        QHash<int, QSet<Face *>> affectedLimitedFaces = getColorAffectedFaces(selectedEdges, limitMeshes[i], level);
+        QHash<int, QSet<Face *>> editedFaces = getColorAffectedFaces(selectedEdges, editedMeshes[i-1], level-1);
+        QHash<int, QSet<Face *>> editedFaces2 = getColorAffectedFaces(selectedEdges, editedMeshes[i], level);
+
+        updateOriginalColor(&originalMeshes[i], &editedMeshes[i-1], selectedEdges, level, editedFaces);
+        updateEditedColor(originalMeshes[i], editedMeshes[i], colorEdits, selectedEdges, level, editedFaces2, displayLevel == i, changedFacesIndices);
+        updateLimitMeshColor(editedMeshes[i], limitMeshes[i], colorEdits, selectedEdges, changedEdgesIndices, level, affectedLimitedFaces, displayLevel == i);
+    }
+}
+
 QSet<Face *> computeColorEditAffectedFaces(HalfEdge *inputEdge) {
     QSet<Face *> affectedFaces;
     Face *centerFace = inputEdge->next->twin->prev->twin->polygon;
@@ -692,16 +577,15 @@ QSet<Face *> computeColorEditAffectedFaces(HalfEdge *inputEdge, int level) {
     return affectedFaces;
 }
 
-// Get the points for which both the geometry and colour can be edited
-QVector<int> getEditableVertexIndices(int inputMeshSize, Mesh& editedMesh) {
-    QElapsedTimer timer;
-    timer.start();
+// Get the points for which both the geometry and colour can be edited, the remaining points are gradient points
+void classifyVertices(int inputMeshSize, Mesh& editedMesh, VertexClassification *classification) {
+    QBitArray &editable = classification->editable;
+    editable.fill(false, editedMesh.Vertices.size());
     QStack<int> stack;
-    QVector<bool> processed(editedMesh.Vertices.size());
 
     for (int i = 0; i < inputMeshSize; ++i) {
         stack.push(i);
-        processed[i] = true;
+        editable.setBit(i);
     }
 
     // Perform depth first search, walking in steps of three consecutive edges
@@ -715,41 +599,51 @@ QVector<int> getEditableVertexIndices(int inputMeshSize, Mesh& editedMesh) {
                 newVertexIndex = e->next->next->target->index;
             else
                 newVertexIndex = e->next->twin->next->next->twin->next->target->index;
-            if (!processed[newVertexIndex]) {
+            if (!editable.testBit(newVertexIndex)) {
                 stack.push(newVertexIndex);
-                processed[newVertexIndex] = true;
+                editable.setBit(newVertexIndex);
             }
             e = e->prev->twin;
         }
     }
-    // Processed vertices are the editable vertices
-    QVector<int> indices;
-    for (int i = 0; i < processed.size(); ++i) {
-        if (processed[i])
-            indices.append(i);
-    }
 
-    return indices;
+    classification->updateIndices();
 }
 
-// Get the points for which only geometry can be edited
-QVector<int> getGradientVertexIndices(int inputMeshSize, Mesh editedMesh) {
-    // Get editable vertex indices
-    QVector<int> editableVertices = getEditableVertexIndices(inputMeshSize, editedMesh);
-
-    // Create bool array indicating if a vertex is editable
-    QVector<bool> isEditableVertex(editedMesh.Vertices.size());
-    for (int i = 0; i < editableVertices.size(); ++i)
-        isEditableVertex[editableVertices[i]] = true;
-
-    // Remaining vertices are gradient vertices
-    QVector<int> gradientVertexIndices;
-    for (int i = 0; i < editedMesh.Vertices.size(); ++i) {
-        if (!isEditableVertex[i])
-            gradientVertexIndices.append(i);
+// Derive the classification of a Catmull-Clark subdivided mesh from the classification of its input mesh.
+// The editable vertices form a lattice with a spacing of three edges. Subdivision halves the edges, so the new
+// lattice consists of the old lattice, the midpoints of the middle edges of its segments and the centers of
+// the faces in the middle of its 3x3 blocks. These follow from the index layout of subdivideCatmullClark.
+void classifySubdividedVertices(Mesh& inputMesh, VertexClassification& inputClassification, Mesh& subdivMesh, VertexClassification *classification) {
+    QBitArray &editable = classification->editable;
+    editable.fill(false, subdivMesh.Vertices.size());
+    int faceVertexOffset = inputMesh.Vertices.size() + inputMesh.HalfEdges.size() / 2;
+
+    foreach (int vertexIndex, inputClassification.editableIndices) {
+        // Vertices 'a' keep their index
+        editable.setBit(vertexIndex);
+
+        Vertex v = inputMesh.Vertices[vertexIndex];
+        HalfEdge *e = v.out;
+        for (int i = 0; i < v.val; ++i) {
+            // Middle edge of the segment starting with e
+            HalfEdge *middle = e->polygon ? e->next->twin->next : e->next;
+
+            // Vertex 'b' of the middle edge is the target of halfedge '0' of its non-boundary halfedge
+            HalfEdge *inner = middle->polygon ? middle : middle->twin;
+            editable.setBit(subdivMesh.HalfEdges[4 * inner->index].target->index);
+
+            // Vertices 'c' of the middle faces of the blocks on both sides
+            if (middle->polygon && middle->next->next->twin->polygon)
+                editable.setBit(faceVertexOffset + middle->next->next->twin->polygon->index);
+            if (middle->twin->polygon && middle->twin->next->next->twin->polygon)
+                editable.setBit(faceVertexOffset + middle->twin->next->next->twin->polygon->index);
+
+            e = e->prev->twin;
+        }
     }
 
-    return gradientVertexIndices;
+    classification->updateIndices();
 }
 
 
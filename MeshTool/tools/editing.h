@@ -4,25 +4,32 @@
 #include "mesh.h"
 #include "coordsedit.h"
 #include "coloredit.h"
+#include "changeset.h"
+#include "levelpool.h"
+#include "vertexclassification.h"
 
-bool isSelfIntersecting(Face *f);
-bool isSelfIntersecting(Mesh *inputMesh, int selectedVertex);
-int swapParentEdgeIndex(int childIndex, int parentIndex, int levels);
-int computeParentEdgeIndex(int index, int levels);
 
+int computeCoordsEditVertex(Mesh *mesh, const CoordsEdit &ce);
+QVector2D computeCoordsEditDelta(Mesh *mesh, const CoordsEdit &ce);
 Mesh computeEditedMesh(Mesh inputMesh, QHash<int, CoordsEdit> coordsEdits, QHash<int, ColorEdit> colorEdits);
+void computeEditedMesh(Mesh *inputMesh, const QHash<int, CoordsEdit> &coordsEdits, const QHash<int, ColorEdit> &colorEdits, Mesh *outputMesh);
 
+CoordsEdit computeCoordsEdit(Vertex v, QVector2D deltaCoords);
 void updateOriginalCoords(Mesh* originalMesh, Mesh* editedMesh, int selectedVertex, int level);
-void updateEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, QVector<int>& influencedFacesIndices, int level, bool curSubdivStep);
-void updateLimitCoords(Mesh &editedMesh, Mesh &limitMesh, int selectedVertex, QVector<int>& changedLimitCoordsIndices, int level, bool curSubdivStep);
+void updateEditedCoords(Mesh& originalMesh, Mesh& editedMesh, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, ChangeSet& influencedFacesIndices, int level, bool curSubdivStep);
+void updateLimitCoords(Mesh &editedMesh, Mesh &limitMesh, int selectedVertex, ChangeSet& changedLimitCoordsIndices, int level, bool curSubdivStep);
 
 void updateOriginalColor(Mesh* originalMesh, Mesh* editedMesh, QSet<int>& selectedEdges, int level, QHash<int, QSet<Face *>> affectedFaces);
-void updateEditedColor(Mesh& originalMesh, Mesh& editedMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep, QVector<int>& changedFacesIndices);
-void updateLimitMeshColor(Mesh& editedMesh, Mesh& limitMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, QVector<int>& changedEdgesIndices, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep);
+void updateEditedColor(Mesh& originalMesh, Mesh& editedMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep, ChangeSet& changedFacesIndices);
+void updateLimitMeshColor(Mesh& editedMesh, Mesh& limitMesh, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, ChangeSet& changedEdgesIndices, int level, QHash<int, QSet<Face *>> affectedFaces, bool curSubdivStep);
+
+void propagateCoordsEdit(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, int editLevel, int endLevel, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedLimitCoordsIndices);
+void refineCoordsEdit(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, CoordsEdit& coordsEdit, int selectedVertex, int editFlag, int editLevel, int level, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedLimitCoordsIndices);
+void propagateColorEdit(LevelPool<Mesh>& originalMeshes, LevelPool<Mesh>& editedMeshes, LevelPool<Mesh>& limitMeshes, QHash<int, ColorEdit>& colorEdits, QSet<int>& selectedEdges, int editLevel, int displayLevel, ChangeSet& changedFacesIndices, ChangeSet& changedEdgesIndices);
 
 QSet<Face *> computeColorEditAffectedFaces(HalfEdge *inputEdge);
 QSet<Face *> computeColorEditAffectedFaces(HalfEdge *inputEdge, int level);
-QVector<int> getEditableVertexIndices(int inputMeshSize, Mesh& editedMesh);
-QVector<int> getGradientVertexIndices(int inputMeshSize, Mesh editedMesh);
+void classifyVertices(int inputMeshSize, Mesh& editedMesh, VertexClassification *classification);
+void classifySubdividedVertices(Mesh& inputMesh, VertexClassification& inputClassification, Mesh& subdivMesh, VertexClassification *classification);
 
 #endif // EDITING_H
@@ -0,0 +1,230 @@
+#include "foldover.h"
+#include "convenience.h"
+#include "subdivision.h"
+#include "renderers/acc1renderer.h"
+#include <QtConcurrent>
+
+// Maximum number of halvings of the parameter domain before a patch without
+// a proof of a positive Jacobian is reported as folding over
+#define MAX_FOLDOVER_DEPTH 8
+
+void computeBicubicControlNet(Face *f, QVector2D controlNet[4][4]) {
+  // Collect ACC1 control points per ribbon
+  QVector2D points[16];
+  HalfEdge *e = f->side;
+  for (int i = 0; i < 4; ++i) {
+    points[4 * i] = ACC1Renderer::computeCornerPoint(e).coords();
+    points[4 * i + 1] = ACC1Renderer::computeEdgePoint(e, true).coords();
+    points[4 * i + 2] = ACC1Renderer::computeEdgePoint(e->twin, false).coords();
+    points[4 * i + 3] = ACC1Renderer::computeInteriorPoint(e).coords();
+    e = e->next;
+  }
+
+  // Mapping from indices to grid location (u along the side of the face, v upwards)
+  //
+  // 12--10--9---8
+  // |   |   |   |
+  // 13--15--11--6
+  // |   |   |   |
+  // 14--3---7---5
+  // |   |   |   |
+  // 0---1---2---4
+  static const int grid[4][4] = {{0, 1, 2, 4}, {14, 3, 7, 5}, {13, 15, 11, 6}, {12, 10, 9, 8}};
+  for (int u = 0; u < 4; ++u)
+    for (int v = 0; v < 4; ++v)
+      controlNet[u][v] = points[grid[v][u]];
+}
+
+void computeJacobianNet(QVector2D controlNet[4][4], JacobianNet *jacobianNet) {
+  static const float binomial2[3] = {1, 2, 1};
+  static const float binomial3[4] = {1, 3, 3, 1};
+  static const float binomial5[6] = {1, 5, 10, 10, 5, 1};
+
+  // Differences of the control net, the partial derivatives up to a constant factor
+  QVector2D du[3][4], dv[4][3];
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 4; ++j)
+      du[i][j] = controlNet[i + 1][j] - controlNet[i][j];
+  for (int i = 0; i < 4; ++i)
+    for (int j = 0; j < 3; ++j)
+      dv[i][j] = controlNet[i][j + 1] - controlNet[i][j];
+
+  // Multiply the Bernstein forms of the derivatives, degree (2, 3) times (3, 2) gives degree (5, 5)
+  for (int k = 0; k < 6; ++k)
+    for (int l = 0; l < 6; ++l)
+      jacobianNet->coefs[k][l] = 0;
+  for (int a = 0; a < 3; ++a) {
+    for (int b = 0; b < 4; ++b) {
+      for (int c = 0; c < 4; ++c) {
+        for (int d = 0; d < 3; ++d) {
+          // The cross product of a pair of 2D vectors is: (a,b,0)x(c,d,0) = (0,0,ad-bc)
+          float cross = du[a][b].x() * dv[c][d].y() - du[a][b].y() * dv[c][d].x();
+          jacobianNet->coefs[a + c][b + d] += binomial2[a] * binomial3[c] * binomial3[b] * binomial2[d] * cross;
+        }
+      }
+    }
+  }
+  for (int k = 0; k < 6; ++k)
+    for (int l = 0; l < 6; ++l)
+      jacobianNet->coefs[k][l] /= binomial5[k] * binomial5[l];
+}
+
+// Split a net at the middle of the u or v direction using de Casteljau's algorithm
+static void splitJacobianNet(const JacobianNet &net, bool alongU, JacobianNet *first, JacobianNet *second) {
+  for (int l = 0; l < 6; ++l) {
+    float p[6];
+    for (int k = 0; k < 6; ++k)
+      p[k] = alongU ? net.coefs[k][l] : net.coefs[l][k];
+    for (int r = 0; r < 6; ++r) {
+      (alongU ? first->coefs[r][l] : first->coefs[l][r]) = p[0];
+      (alongU ? second->coefs[5 - r][l] : second->coefs[l][5 - r]) = p[5 - r];
+      for (int k = 0; k < 5 - r; ++k)
+        p[k] = (p[k] + p[k + 1]) / 2;
+    }
+  }
+}
+
+static bool isJacobianPositive(const JacobianNet &net, int depth, bool alongU) {
+  // Corner coefficients are values of the determinant, so a non-positive one is a foldover
+  if (net.coefs[0][0] <= 0 || net.coefs[5][0] <= 0 || net.coefs[0][5] <= 0 || net.coefs[5][5] <= 0)
+    return false;
+
+  // The determinant lies in the convex hull of its coefficients
+  bool positive = true;
+  for (int k = 0; k < 6 && positive; ++k)
+    for (int l = 0; l < 6 && positive; ++l)
+      positive = net.coefs[k][l] > 0;
+  if (positive)
+    return true;
+
+  // Undecided, refine or give up conservatively
+  if (depth == 0)
+    return false;
+  JacobianNet first, second;
+  splitJacobianNet(net, alongU, &first, &second);
+  return isJacobianPositive(first, depth - 1, !alongU) && isJacobianPositive(second, depth - 1, !alongU);
+}
+
+bool isJacobianPositive(const JacobianNet &jacobianNet, int maxDepth) {
+  return isJacobianPositive(jacobianNet, maxDepth, true);
+}
+
+static bool hasQuadFoldover(Face *f) {
+  QVector2D controlNet[4][4];
+  JacobianNet jacobianNet;
+  computeBicubicControlNet(f, controlNet);
+  computeJacobianNet(controlNet, &jacobianNet);
+  return !isJacobianPositive(jacobianNet, MAX_FOLDOVER_DEPTH);
+}
+
+// Other faces are split into quads by a Catmull-Clark step on the face and its one ring
+static void splitFace(Mesh *mesh, Face *f, Mesh *subMesh, Mesh *subdivMesh, QVector<int> *vertexIndices, QVector<int> *quadIndices) {
+  static thread_local DenseMap<int> edgeMap;
+  computeSubMesh(mesh, getIndices(getPadded(getVertices(QSet<Face *>({f})), 1)), subMesh, &edgeMap);
+  subdivideCatmullClark(subMesh, subdivMesh);
+
+  if (vertexIndices) {
+    vertexIndices->resize(subMesh->Vertices.size());
+    foreach (int edgeIndex, edgeMap.keys())
+      (*vertexIndices)[subMesh->HalfEdges[edgeMap.value(edgeIndex)].target->index] = mesh->HalfEdges[edgeIndex].target->index;
+  }
+
+  // The quads of the face have the indices of the halfedges of the face in the submesh
+  quadIndices->clear();
+  foreach (HalfEdge *e, getFaceEdges(&subMesh->HalfEdges[edgeMap.value(f->side->index)]))
+    quadIndices->append(e->index);
+}
+
+// Check if the ACC1 patch of a face folds over (faces are left rotating, so a valid patch has a positive Jacobian)
+bool hasFoldover(Mesh *mesh, int faceIndex) {
+  Face *f = &mesh->Faces[faceIndex];
+  if (f->val == 4)
+    return hasQuadFoldover(f);
+
+  Mesh subMesh, subdivMesh;
+  QVector<int> quadIndices;
+  splitFace(mesh, f, &subMesh, &subdivMesh, nullptr, &quadIndices);
+  foreach (int quadIndex, quadIndices) {
+    if (hasQuadFoldover(&subdivMesh.Faces[quadIndex]))
+      return true;
+  }
+  return false;
+}
+
+void FoldoverCache::clear() {
+  foldovers.clear();
+  splits.clear();
+}
+
+void FoldoverCache::invalidate(Mesh *mesh, int vertexIndex) {
+  foreach (Face *f, getPadded(QSet<Vertex *>({&mesh->Vertices[vertexIndex]}), 2))
+    foldovers.remove(f->index);
+}
+
+bool FoldoverCache::hasFoldover(Mesh *mesh, int faceIndex) {
+  if (foldovers.contains(faceIndex))
+    return foldovers.value(faceIndex);
+
+  Face *f = &mesh->Faces[faceIndex];
+  bool foldover = false;
+  if (f->val == 4) {
+    foldover = hasQuadFoldover(f);
+  } else {
+    // Split once, later checks only move the split to the current coordinates
+    QSharedPointer<FaceSplit> split = splits.value(faceIndex);
+    if (!split) {
+      split = QSharedPointer<FaceSplit>::create();
+      splitFace(mesh, f, &split->subMesh, &split->subdivMesh, &split->vertexIndices, &split->quadIndices);
+      splits.insert(faceIndex, split);
+    } else {
+      for (int i = 0; i < split->vertexIndices.size(); ++i)
+        split->subMesh.Vertices[i].coords = mesh->Vertices[split->vertexIndices[i]].coords;
+      updateCatmullClarkCoords(&split->subMesh, &split->subdivMesh);
+    }
+    foreach (int quadIndex, split->quadIndices) {
+      if (hasQuadFoldover(&split->subdivMesh.Faces[quadIndex])) {
+        foldover = true;
+        break;
+      }
+    }
+  }
+  foldovers.insert(faceIndex, foldover);
+  return foldover;
+}
+
+bool FoldoverCache::isSelfIntersecting(Mesh *mesh, int vertexIndex) {
+  foreach (Face *f, getPadded(QSet<Vertex *>({&mesh->Vertices[vertexIndex]}), 2)) {
+    if (hasFoldover(mesh, f->index))
+      return true;
+  }
+  return false;
+}
+
+class FoldoverTask {
+  public:
+    Mesh *mesh;
+    int faceIndex;
+    bool foldover;
+};
+
+static void checkFoldover(FoldoverTask &task) {
+  task.foldover = hasFoldover(task.mesh, task.faceIndex);
+}
+
+// Check all faces of a mesh in parallel
+QVector<int> findFoldoverFaces(Mesh *mesh) {
+  QVector<FoldoverTask> tasks(mesh->Faces.size());
+  for (int i = 0; i < tasks.size(); ++i) {
+    tasks[i].mesh = mesh;
+    tasks[i].faceIndex = i;
+    tasks[i].foldover = false;
+  }
+  QtConcurrent::blockingMap(tasks, checkFoldover);
+
+  QVector<int> faceIndices;
+  foreach (FoldoverTask task, tasks) {
+    if (task.foldover)
+      faceIndices.append(task.faceIndex);
+  }
+  return faceIndices;
+}
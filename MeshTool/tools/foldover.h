@@ -0,0 +1,43 @@
+#ifndef FOLDOVER_H
+#define FOLDOVER_H
+
+#include "mesh.h"
+#include <QHash>
+#include <QSharedPointer>
+
+// Bernstein coefficients of the Jacobian determinant of a bicubic patch,
+// which is a polynomial of degree 5 in both parameter directions
+class JacobianNet {
+  public:
+    float coefs[6][6];
+};
+
+void computeBicubicControlNet(Face *f, QVector2D controlNet[4][4]);
+void computeJacobianNet(QVector2D controlNet[4][4], JacobianNet *jacobianNet);
+bool isJacobianPositive(const JacobianNet &jacobianNet, int maxDepth);
+bool hasFoldover(Mesh *mesh, int faceIndex);
+QVector<int> findFoldoverFaces(Mesh *mesh);
+
+// Foldover results of the faces of a mesh while only its coordinates change, as
+// during a drag. Non-quads keep their quad split, which is only moved.
+class FoldoverCache {
+  public:
+    void clear();
+    // Drop the faces whose patches depend on the vertex
+    void invalidate(Mesh *mesh, int vertexIndex);
+    bool hasFoldover(Mesh *mesh, int faceIndex);
+    // Check the faces whose patches depend on the vertex
+    bool isSelfIntersecting(Mesh *mesh, int vertexIndex);
+
+  private:
+    class FaceSplit {
+      public:
+        Mesh subMesh, subdivMesh;
+        QVector<int> vertexIndices; // Of the mesh per submesh vertex
+        QVector<int> quadIndices; // Of the quads of the face in subdivMesh
+    };
+    QHash<int, bool> foldovers;
+    QHash<int, QSharedPointer<FaceSplit>> splits;
+};
+
+#endif // FOLDOVER_H
@@ -0,0 +1,410 @@
+#include "levelmanager.h"
+#include "editing.h"
+#include "subdivision.h"
+#include "memoryusage.h"
+#include "trace.h"
+#include <QtConcurrent>
+#include <QDebug>
+
+// Input snapshot and results of a level computed on a worker thread. The
+// input is a deep copy, so edits on the GUI thread never touch what the
+// worker reads.
+class LevelJob {
+  public:
+    int level;
+    int generation;
+    int inputVertices;
+    LevelManager::PrepareFunction prepare;
+    Mesh input;
+    VertexClassification inputClassification;
+    QHash<int, CoordsEdit> coordsEdits;
+    QHash<int, ColorEdit> colorEdits;
+    Mesh original, edited, limit;
+    VertexClassification classification;
+};
+
+// Derive a level from the edited mesh of the level below, or from the input mesh for level 0.
+// An evicted level still has its edited mesh, in that case it is not recomputed.
+static void computeLevel(int level, int inputVertices, Mesh *input, VertexClassification *inputClassification, const QHash<int, CoordsEdit> &coordsEdits, const QHash<int, ColorEdit> &colorEdits, bool computeEdited, Mesh *original, Mesh *edited, Mesh *limit, VertexClassification *classification) {
+  original->clear();
+  if (level == 0)
+    subdivideTernaryStep(input, original);
+  else
+    subdivideCatmullClark(input, original);
+  if (computeEdited)
+    computeEditedMesh(original, coordsEdits, colorEdits, edited);
+  computeLimitMesh(edited, limit);
+  if (level == 0)
+    classifyVertices(inputVertices, *edited, classification);
+  else
+    classifySubdividedVertices(*input, *inputClassification, *edited, classification);
+}
+
+// Element counts of the given level
+static void computeLevelSizes(Mesh *inputMesh, int level, int *vertices, int *halfEdges, int *faces) {
+  *vertices = inputMesh->Vertices.size();
+  *halfEdges = inputMesh->HalfEdges.size();
+  *faces = inputMesh->Faces.size();
+  int sumFaceVal = 0;
+  foreach (Face f, inputMesh->Faces)
+    sumFaceVal += f.val;
+
+  computeTernaryStepSizes(vertices, halfEdges, faces, &sumFaceVal);
+  for (int i = 1; i <= level; ++i)
+    computeCatmullClarkSizes(vertices, halfEdges, faces, &sumFaceVal);
+}
+
+LevelManager::LevelManager(QObject *parent) : QObject(parent) {
+  budget = qint64(4) << 30;
+  connect(&watcher, SIGNAL(finished()), this, SLOT(onJobFinished()));
+}
+
+LevelManager::~LevelManager() {
+  generation.fetchAndAddOrdered(1);
+  watcher.waitForFinished();
+  delete job;
+}
+
+void LevelManager::setInput(Mesh *inputMesh, QHash<int, QHash<int, CoordsEdit>> *coordsEdits, QHash<int, QHash<int, ColorEdit>> *colorEdits) {
+  this->inputMesh = inputMesh;
+  this->coordsEdits = coordsEdits;
+  this->colorEdits = colorEdits;
+}
+
+void LevelManager::setBudget(qint64 bytes) {
+  budget = bytes;
+  enforceBudget(0);
+}
+
+qint64 LevelManager::getBudget() const {
+  return budget;
+}
+
+// Bytes held by the levels, recycled objects beyond the computed levels included
+qint64 LevelManager::getResidentBytes() {
+  qint64 bytes = 0;
+  for (int i = 0; i < originalMeshes.allocatedSize(); ++i)
+    bytes += meshBytes(originalMeshes.allocated(i));
+  for (int i = 0; i < editedMeshes.allocatedSize(); ++i)
+    bytes += meshBytes(editedMeshes.allocated(i));
+  for (int i = 0; i < limitMeshes.allocatedSize(); ++i)
+    bytes += meshBytes(limitMeshes.allocated(i));
+  for (int i = 0; i < vertexClassifications.allocatedSize(); ++i)
+    bytes += classificationBytes(vertexClassifications.allocated(i));
+  return bytes;
+}
+
+int LevelManager::getVersion() const {
+  return version;
+}
+
+bool LevelManager::isResident(int level) const {
+  return level >= 0 && level < resident.size() && resident[level];
+}
+
+// Whether the first given number of levels can be used right away
+bool LevelManager::isAvailable(int levels) const {
+  if (levels > resident.size())
+    return false;
+  for (int level = 0; level < levels; ++level) {
+    if (!resident[level])
+      return false;
+  }
+  return true;
+}
+
+bool LevelManager::isPending() const {
+  return job != nullptr;
+}
+
+// Whether the pending level is a speculative one above the pinned levels
+bool LevelManager::isPrefetching() const {
+  return job && job->level >= pinnedLevels;
+}
+
+int LevelManager::getPendingLevel() const {
+  return job ? job->level : -1;
+}
+
+// Mark a level as viewed, for the eviction order
+void LevelManager::touch(int level) {
+  if (level >= 0 && level < lastUsed.size())
+    lastUsed[level] = ++clock;
+}
+
+// Compute the given number of levels on the calling thread
+void LevelManager::require(int levels) {
+  TRACE_ZONE("LevelManager::require");
+  // A running job computes a level that is appended here
+  generation.fetchAndAddOrdered(1);
+  pinnedLevels = levels;
+  targetLevels = levels;
+  waiting = false;
+  reserveLevels(levels);
+  for (int level = 0; level < levels; ++level) {
+    if (level >= originalMeshes.size())
+      appendLevel(level);
+    else if (!resident[level])
+      rebuildLevel(level);
+  }
+  enforceBudget(0);
+}
+
+// Make the given number of levels available and pin them. Missing levels are computed on a
+// worker thread and levelsReady() is emitted when they are in. Returns whether they already are.
+bool LevelManager::request(int levels) {
+  TRACE_ZONE("LevelManager::request");
+  pinnedLevels = levels;
+  targetLevels = levels;
+
+  // Evicted levels only lack what their edited meshes give back cheaply, so rebuild them right away
+  for (int level = 0; level < qMin(levels, originalMeshes.size()); ++level) {
+    if (!resident[level])
+      rebuildLevel(level);
+  }
+
+  if (isAvailable(levels)) {
+    waiting = false;
+    enforceBudget(0);
+    return true;
+  }
+  waiting = true;
+  startJob();
+  return false;
+}
+
+// Compute the levels up to the given number in the background without pinning them, and
+// run the prepare function on the last one. Skipped when the pinned levels are not in yet or
+// the level would not fit in the budget. Returns whether a computation was started.
+bool LevelManager::prefetch(int levels, PrepareFunction prepare) {
+  if (levels <= originalMeshes.size() || !isAvailable(pinnedLevels) || job)
+    return false;
+  qint64 bytes = getPinnedBytes();
+  for (int level = originalMeshes.size(); level < levels; ++level)
+    bytes += estimateLevelBytes(level);
+  if (bytes > budget)
+    return false;
+
+  TRACE_ZONE("LevelManager::prefetch");
+  targetLevels = levels;
+  prepareFunction = prepare;
+  startJob();
+  return true;
+}
+
+// Call before an edit changes the meshes. The snapshot of a running job becomes stale and
+// cached levels above the pinned ones would not receive the propagated edit.
+void LevelManager::invalidate() {
+  generation.fetchAndAddOrdered(1);
+  targetLevels = pinnedLevels;
+  truncate(pinnedLevels);
+}
+
+// Forget all levels, their buffers are reused by the next computation
+void LevelManager::reset() {
+  generation.fetchAndAddOrdered(1);
+  originalMeshes.clear();
+  editedMeshes.clear();
+  limitMeshes.clear();
+  vertexClassifications.clear();
+  ++version;
+  resident.clear();
+  lastUsed.clear();
+  pinnedLevels = 0;
+  targetLevels = 0;
+  waiting = false;
+}
+
+// Free all levels. Waits for a running job, the prepare function may refer to objects that
+// are about to be deleted.
+void LevelManager::release() {
+  reset();
+  watcher.waitForFinished();
+  originalMeshes.release();
+  editedMeshes.release();
+  limitMeshes.release();
+  vertexClassifications.release();
+  ++version;
+}
+
+void LevelManager::startJob() {
+  int level = originalMeshes.size();
+  if (job || level >= targetLevels)
+    return;
+
+  // Make room for the new level before it is allocated
+  enforceBudget(estimateLevelBytes(level));
+
+  job = new LevelJob();
+  job->level = level;
+  job->generation = generation.loadAcquire();
+  job->inputVertices = inputMesh->Vertices.size();
+  if (level == 0) {
+    inputMesh->copyTo(&job->input);
+  } else {
+    editedMeshes[level-1].copyTo(&job->input);
+    job->inputClassification = vertexClassifications[level-1];
+  }
+  job->coordsEdits = coordsEdits->value(level);
+  job->colorEdits = colorEdits->value(level);
+  if (level == targetLevels - 1 && level >= pinnedLevels)
+    job->prepare = prepareFunction;
+
+  // Skip the prepare step when an edit or reload made the level stale in the meantime
+  LevelJob *j = job;
+  QAtomicInt *currentGeneration = &generation;
+  watcher.setFuture(QtConcurrent::run([j, currentGeneration]() {
+    TRACE_ZONE("LevelManager::job");
+    computeLevel(j->level, j->inputVertices, &j->input, &j->inputClassification, j->coordsEdits, j->colorEdits, true, &j->original, &j->edited, &j->limit, &j->classification);
+    if (j->prepare && j->generation == currentGeneration->loadAcquire())
+      j->prepare(j->edited, j->limit);
+  }));
+}
+
+void LevelManager::onJobFinished() {
+  TRACE_ZONE("LevelManager::onJobFinished");
+  LevelJob *finished = job;
+  job = nullptr;
+
+  // Move the results into the pools, unless edits or a reload made them stale
+  if (finished->generation == generation.loadAcquire() && finished->level == originalMeshes.size()) {
+    originalMeshes.append().swap(finished->original);
+    editedMeshes.append().swap(finished->edited);
+    limitMeshes.append().swap(finished->limit);
+    vertexClassifications.append() = finished->classification;
+    ++version;
+    resident.append(true);
+    lastUsed.append(++clock);
+    emit levelComputed(originalMeshes.size() - 1);
+  }
+  delete finished;
+
+  if (waiting && isAvailable(pinnedLevels)) {
+    waiting = false;
+    emit levelsReady();
+  }
+  if (isAvailable(targetLevels))
+    enforceBudget(0);
+  else
+    startJob();
+}
+
+// Append the given level, which must directly follow the computed levels
+void LevelManager::appendLevel(int level) {
+  TRACE_ZONE("LevelManager::appendLevel");
+  Mesh *input = level == 0 ? inputMesh : &editedMeshes[level-1];
+  VertexClassification *inputClassification = level == 0 ? nullptr : &vertexClassifications[level-1];
+  Mesh &originalMesh = originalMeshes.append();
+  Mesh &editedMesh = editedMeshes.append();
+  Mesh &limitMesh = limitMeshes.append();
+  VertexClassification &classification = vertexClassifications.append();
+  computeLevel(level, inputMesh->Vertices.size(), input, inputClassification, (*coordsEdits)[level], (*colorEdits)[level], true, &originalMesh, &editedMesh, &limitMesh, &classification);
+  ++version;
+  resident.append(true);
+  lastUsed.append(++clock);
+}
+
+// Recompute the structures of an evicted level from its edited mesh
+void LevelManager::rebuildLevel(int level) {
+  TRACE_ZONE("LevelManager::rebuildLevel");
+  Mesh *input = level == 0 ? inputMesh : &editedMeshes[level-1];
+  VertexClassification *inputClassification = level == 0 ? nullptr : &vertexClassifications[level-1];
+  computeLevel(level, inputMesh->Vertices.size(), input, inputClassification, (*coordsEdits)[level], (*colorEdits)[level], false, &originalMeshes[level], &editedMeshes[level], &limitMeshes[level], &vertexClassifications[level]);
+  ++version;
+  resident[level] = true;
+  lastUsed[level] = ++clock;
+}
+
+// Reserve the exact sizes of the first levels, so growing the level buffers never over-allocates
+void LevelManager::reserveLevels(int levels) {
+  // Leave computed levels alone, they are in use
+  for (int i = originalMeshes.size(); i < levels; ++i) {
+    int vertices, halfEdges, faces;
+    computeLevelSizes(inputMesh, i, &vertices, &halfEdges, &faces);
+    originalMeshes.allocated(i).reserve(vertices, halfEdges, faces);
+    editedMeshes.allocated(i).reserve(vertices, halfEdges, faces);
+    limitMeshes.allocated(i).reserve(vertices, halfEdges, faces);
+  }
+  ++version;
+}
+
+// Free the buffers of a level object, also beyond the computed levels
+void LevelManager::releaseLevel(int level, bool keepEdited) {
+  if (level < originalMeshes.allocatedSize())
+    originalMeshes.allocated(level).release();
+  if (!keepEdited && level < editedMeshes.allocatedSize())
+    editedMeshes.allocated(level).release();
+  if (level < limitMeshes.allocatedSize())
+    limitMeshes.allocated(level).release();
+  if (level < vertexClassifications.allocatedSize())
+    vertexClassifications.allocated(level) = VertexClassification();
+  ++version;
+}
+
+// The top level is dropped, a level below it keeps the edited mesh the levels above derive from
+void LevelManager::evict(int level) {
+  TRACE_ZONE("LevelManager::evict");
+  if (level == originalMeshes.size() - 1) {
+    truncate(level);
+  } else {
+    releaseLevel(level, true);
+    resident[level] = false;
+  }
+}
+
+// Drop the levels from the given one on and free their buffers
+void LevelManager::truncate(int levels) {
+  for (int level = levels; level < originalMeshes.size(); ++level)
+    releaseLevel(level, false);
+  originalMeshes.truncate(levels);
+  editedMeshes.truncate(levels);
+  limitMeshes.truncate(levels);
+  vertexClassifications.truncate(levels);
+  ++version;
+  resident.resize(qMin(resident.size(), levels));
+  lastUsed.resize(qMin(lastUsed.size(), levels));
+}
+
+// Evict cached levels until the given number of extra bytes fits in the budget
+void LevelManager::enforceBudget(qint64 extraBytes) {
+  if (getResidentBytes() + extraBytes <= budget)
+    return;
+
+  // Recycled objects beyond the computed levels hold buffers but no level
+  for (int level = originalMeshes.size(); level < originalMeshes.allocatedSize(); ++level)
+    releaseLevel(level, false);
+
+  while (getResidentBytes() + extraBytes > budget) {
+    // Least recently viewed unpinned level. An evicted level below the top has nothing
+    // left to give, its edited mesh is the root of the levels above it.
+    int victim = -1;
+    for (int level = pinnedLevels; level < originalMeshes.size(); ++level) {
+      if (!resident[level] && level < originalMeshes.size() - 1)
+        continue;
+      if (victim == -1 || lastUsed[level] < lastUsed[victim])
+        victim = level;
+    }
+    if (victim == -1) {
+      qDebug() << "Memory budget of" << formatBytes(budget) << "exceeded by the levels in use";
+      return;
+    }
+    evict(victim);
+  }
+}
+
+// Bytes of the levels in use
+qint64 LevelManager::getPinnedBytes() {
+  qint64 bytes = 0;
+  for (int level = 0; level < qMin(pinnedLevels, originalMeshes.size()); ++level) {
+    bytes += meshBytes(originalMeshes[level]) + meshBytes(editedMeshes[level]) + meshBytes(limitMeshes[level]);
+    bytes += classificationBytes(vertexClassifications[level]);
+  }
+  return bytes;
+}
+
+// Bytes of the original, edited and limit mesh of a level that is not computed yet
+qint64 LevelManager::estimateLevelBytes(int level) {
+  int vertices, halfEdges, faces;
+  computeLevelSizes(inputMesh, level, &vertices, &halfEdges, &faces);
+  return 3 * (qint64(vertices) * sizeof(Vertex) + qint64(halfEdges) * sizeof(HalfEdge) + qint64(faces) * sizeof(Face));
+}
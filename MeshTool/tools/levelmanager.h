@@ -0,0 +1,100 @@
+#ifndef LEVELMANAGER_H
+#define LEVELMANAGER_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QVector>
+#include "mesh.h"
+#include "coordsedit.h"
+#include "coloredit.h"
+#include "vertexclassification.h"
+#include "levelpool.h"
+#include <functional>
+
+class LevelJob;
+
+// Owner of the subdivision levels of the input mesh. Levels are computed on
+// request, new ones on a worker thread when asked for asynchronously. The
+// levels below the pinned count are needed for display and edit propagation
+// and always stay resident. Levels above it are a cache: when the memory
+// budget is exceeded the least recently viewed one is evicted. The top level
+// is dropped, a level in between keeps its edited mesh, from which the
+// other meshes of the level and everything above it can be re-derived.
+// While idle, the level above the pinned ones can be prefetched.
+class LevelManager : public QObject {
+  Q_OBJECT
+
+  public:
+    LevelManager(QObject *parent = nullptr);
+    ~LevelManager();
+
+    LevelPool<Mesh> originalMeshes, editedMeshes, limitMeshes;
+    LevelPool<VertexClassification> vertexClassifications;
+
+    // Extra work on the edited and limit mesh of a prefetched level, run on the worker thread
+    typedef std::function<void(Mesh &editedMesh, Mesh &limitMesh)> PrepareFunction;
+
+    void setInput(Mesh *inputMesh, QHash<int, QHash<int, CoordsEdit>> *coordsEdits, QHash<int, QHash<int, ColorEdit>> *colorEdits);
+    void setBudget(qint64 bytes);
+    qint64 getBudget() const;
+    qint64 getResidentBytes();
+    int getVersion() const;
+
+    bool isResident(int level) const;
+    bool isAvailable(int levels) const;
+    bool isPending() const;
+    bool isPrefetching() const;
+    int getPendingLevel() const;
+    void touch(int level);
+
+    void require(int levels);
+    bool request(int levels);
+    bool prefetch(int levels, PrepareFunction prepare);
+    void invalidate();
+    void reset();
+    void release();
+
+  signals:
+    void levelsReady();
+    void levelComputed(int level);
+
+  private slots:
+    void onJobFinished();
+
+  private:
+    Mesh *inputMesh = nullptr;
+    QHash<int, QHash<int, CoordsEdit>> *coordsEdits = nullptr;
+    QHash<int, QHash<int, ColorEdit>> *colorEdits = nullptr;
+
+    // Per computed level: whether all four structures are present, and when it was last viewed
+    QVector<bool> resident;
+    QVector<quint64> lastUsed;
+    quint64 clock = 0;
+    int version = 0; // Bumped whenever level buffers are allocated or freed
+
+    int pinnedLevels = 0;
+    int targetLevels = 0;
+    bool waiting = false;
+    qint64 budget;
+
+    // Background computation, results of an older generation are discarded
+    QFutureWatcher<void> watcher;
+    LevelJob *job = nullptr;
+    QAtomicInt generation;
+    PrepareFunction prepareFunction;
+
+    void startJob();
+    void appendLevel(int level);
+    void rebuildLevel(int level);
+    void reserveLevels(int levels);
+    void releaseLevel(int level, bool keepEdited);
+    void evict(int level);
+    void truncate(int levels);
+    void enforceBudget(qint64 extraBytes);
+    qint64 getPinnedBytes();
+    qint64 estimateLevelBytes(int level);
+};
+
+#endif // LEVELMANAGER_H
@@ -0,0 +1,38 @@
+#include "levelofdetail.h"
+#include "trace.h"
+#include <QtMath>
+
+float computeLevelError(const Mesh &editedMesh, const Mesh &limitMesh, const QRectF &rect) {
+  TRACE_ZONE("computeLevelError");
+  float left = rect.left(), right = rect.right(), top = rect.top(), bottom = rect.bottom();
+  bool culling = !rect.isNull();
+  float maxSquaredError = 0;
+  int vertices = qMin(editedMesh.Vertices.size(), limitMesh.Vertices.size());
+  for (int i = 0; i < vertices; ++i) {
+    const QVector2D &limitCoords = limitMesh.Vertices[i].coords;
+    if (culling && (limitCoords.x() < left || limitCoords.x() > right || limitCoords.y() < top || limitCoords.y() > bottom))
+      continue;
+    maxSquaredError = qMax(maxSquaredError, (editedMesh.Vertices[i].coords - limitCoords).lengthSquared());
+  }
+  return qSqrt(maxSquaredError);
+}
+
+// Catmull-Clark control points approach their limit quadratically, so the
+// error of an unmeasured level is a quarter of the one below it. A coarser
+// level than the current one has to be within half the tolerance, so a view
+// near the threshold does not switch back and forth.
+int selectDetailLevel(int currentLevel, int minLevel, int maxLevel, float tolerance, std::function<float(int level)> measure) {
+  float error = -1;
+  for (int level = minLevel; level <= maxLevel; ++level) {
+    float measured = measure(level);
+    if (measured >= 0)
+      error = measured;
+    else if (error >= 0)
+      error /= 4;
+    else
+      return currentLevel; // Nothing to extrapolate from yet
+    if (error <= (level < currentLevel ? tolerance / 2 : tolerance))
+      return level;
+  }
+  return maxLevel;
+}
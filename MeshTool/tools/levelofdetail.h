@@ -0,0 +1,17 @@
+#ifndef LEVELOFDETAIL_H
+#define LEVELOFDETAIL_H
+
+#include "mesh.h"
+#include <QRectF>
+#include <functional>
+
+// Largest distance between a vertex of a level and its limit position, over
+// the vertices whose limit position lies in rect (all of them for a null rect)
+float computeLevelError(const Mesh &editedMesh, const Mesh &limitMesh, const QRectF &rect);
+
+// Coarsest level in [minLevel, maxLevel] whose error in pixels is within the
+// tolerance. measure() returns the error of a level, or a negative value for
+// levels it cannot measure, which are extrapolated from the level below.
+int selectDetailLevel(int currentLevel, int minLevel, int maxLevel, float tolerance, std::function<float(int level)> measure);
+
+#endif // LEVELOFDETAIL_H
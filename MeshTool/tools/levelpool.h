@@ -0,0 +1,87 @@
+#ifndef LEVELPOOL_H
+#define LEVELPOOL_H
+
+#include <QVector>
+#include <QtAlgorithms>
+#include "trace.h"
+
+// Storage for one object per subdivision level. Levels are heap allocated
+// once and never move, so pointers into a level stay valid while later
+// levels are added. clear() only forgets the levels: the objects and the
+// capacity of their buffers are reused by the next append().
+template <typename T>
+class LevelPool {
+  public:
+    LevelPool() {}
+
+    ~LevelPool() {
+      release();
+    }
+
+    int size() const {
+      return count;
+    }
+
+    bool isEmpty() const {
+      return count == 0;
+    }
+
+    // Number of objects, including the recycled ones beyond size()
+    int allocatedSize() const {
+      return items.size();
+    }
+
+    T &operator[](int level) {
+      return *items[level];
+    }
+
+    const T &operator[](int level) const {
+      return *items[level];
+    }
+
+    // Make sure objects for at least the given number of levels exist
+    void reserve(int levels) {
+      while (items.size() < levels) {
+        items.append(new T());
+        TRACE_COUNT(TraceAllocations, 1);
+        TRACE_COUNT(TraceAllocatedBytes, sizeof(T));
+      }
+    }
+
+    // Object that will back the given level, may lie beyond size()
+    T &allocated(int level) {
+      reserve(level + 1);
+      return *items[level];
+    }
+
+    // Add a level, returns a recycled object that still holds its old contents
+    T &append() {
+      reserve(count + 1);
+      return *items[count++];
+    }
+
+    void clear() {
+      count = 0;
+    }
+
+    // Forget the levels from the given one on, their objects are kept
+    void truncate(int levels) {
+      count = qMin(count, levels);
+    }
+
+    // Delete all objects
+    void release() {
+      qDeleteAll(items);
+      items.clear();
+      items.squeeze();
+      count = 0;
+    }
+
+  private:
+    Q_DISABLE_COPY(LevelPool)
+
+    QVector<T *> items;
+    int count = 0;
+};
+
+#endif // LEVELPOOL_H
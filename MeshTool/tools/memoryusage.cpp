@@ -0,0 +1,83 @@
+#include "memoryusage.h"
+
+qint64 meshBytes(const Mesh &mesh) {
+  return vectorBytes(mesh.Vertices) + vectorBytes(mesh.HalfEdges) + vectorBytes(mesh.Faces);
+}
+
+qint64 classificationBytes(const VertexClassification &classification) {
+  return bitArrayBytes(classification.editable) + vectorBytes(classification.editableIndices) + vectorBytes(classification.gradientIndices);
+}
+
+qint64 sparseLevelBytes(const SparseLevel &level) {
+  return meshBytes(level.mesh) + vectorBytes(level.refinedFaces) + vectorBytes(level.paddingFaces) + vectorBytes(level.transitionFaces);
+}
+
+qint64 coordsEditsBytes(const QHash<int, CoordsEdit> &coordsEdits) {
+  qint64 bytes = hashBytes(coordsEdits);
+  foreach (const CoordsEdit &edit, coordsEdits)
+    bytes += vectorBytes(edit.affectedEdgeIndices);
+  return bytes;
+}
+
+qint64 colorEditsBytes(const QHash<int, ColorEdit> &colorEdits) {
+  qint64 bytes = hashBytes(colorEdits);
+  foreach (const ColorEdit &edit, colorEdits)
+    bytes += vectorBytes(edit.affectedEdgeIndices);
+  return bytes;
+}
+
+QString formatBytes(qint64 bytes) {
+  if (bytes < 1024)
+    return QString::number(bytes) + " B";
+  if (bytes < 1024 * 1024)
+    return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+  if (bytes < 1024 * 1024 * 1024)
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+  return QString::number(bytes / (1024.0 * 1024.0 * 1024.0), 'f', 2) + " GB";
+}
+
+// ---
+
+void MemoryReport::add(QString category, int level, qint64 bytes) {
+  if (!this->bytes.contains(category))
+    categoryNames.append(category);
+  this->bytes[category][level] += bytes;
+}
+
+qint64 MemoryReport::total(QString category) const {
+  qint64 sum = 0;
+  foreach (qint64 levelBytes, bytes.value(category))
+    sum += levelBytes;
+  return sum;
+}
+
+qint64 MemoryReport::total() const {
+  qint64 sum = 0;
+  foreach (QString category, categoryNames)
+    sum += total(category);
+  return sum;
+}
+
+QStringList MemoryReport::categories() const {
+  return categoryNames;
+}
+
+QMap<int, qint64> MemoryReport::levels(QString category) const {
+  return bytes.value(category);
+}
+
+// One line per category, followed by the levels of leveled categories
+QString MemoryReport::toText() const {
+  QString text;
+  foreach (QString category, categoryNames) {
+    text += formatBytes(total(category)) + " " + category + "\n";
+    QMap<int, qint64> categoryLevels = bytes[category];
+    if (categoryLevels.size() == 1 && categoryLevels.contains(-1))
+      continue;
+    for (auto level = categoryLevels.constBegin(); level != categoryLevels.constEnd(); ++level)
+      if (level.key() >= 0)
+        text += "  level " + QString::number(level.key()) + ": " + formatBytes(level.value()) + "\n";
+  }
+  text += formatBytes(total()) + " total\n";
+  return text;
+}
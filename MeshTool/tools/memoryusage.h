@@ -0,0 +1,58 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include "mesh.h"
+#include "coordsedit.h"
+#include "coloredit.h"
+#include "vertexclassification.h"
+#include "sparsehierarchy.h"
+#include <QBitArray>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+// Heap usage estimates. Vectors count their capacity, hashes their nodes plus
+// an estimate of the per node and per bucket overhead.
+template <typename T>
+qint64 vectorBytes(const QVector<T> &vector) {
+  return qint64(vector.capacity()) * sizeof(T);
+}
+
+template <typename K, typename V>
+qint64 hashBytes(const QHash<K, V> &hash) {
+  return qint64(hash.size()) * (sizeof(K) + sizeof(V) + 2 * sizeof(void *)) + qint64(hash.capacity()) * sizeof(void *);
+}
+
+template <typename T>
+qint64 setBytes(const QSet<T> &set) {
+  return qint64(set.size()) * (sizeof(T) + 2 * sizeof(void *)) + qint64(set.capacity()) * sizeof(void *);
+}
+
+inline qint64 bitArrayBytes(const QBitArray &bits) {
+  return (bits.size() + 7) / 8;
+}
+
+qint64 meshBytes(const Mesh &mesh);
+qint64 classificationBytes(const VertexClassification &classification);
+qint64 sparseLevelBytes(const SparseLevel &level);
+qint64 coordsEditsBytes(const QHash<int, CoordsEdit> &coordsEdits);
+qint64 colorEditsBytes(const QHash<int, ColorEdit> &colorEdits);
+QString formatBytes(qint64 bytes);
+
+// Bytes per category and subdivision level, level -1 for unleveled data
+class MemoryReport {
+  public:
+    void add(QString category, int level, qint64 bytes);
+    qint64 total(QString category) const;
+    qint64 total() const;
+    QStringList categories() const;
+    QMap<int, qint64> levels(QString category) const;
+    QString toText() const;
+
+  private:
+    QStringList categoryNames; // In order of addition
+    QHash<QString, QMap<int, qint64>> bytes;
+};
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,23 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <QVector>
+#include <QtConcurrent>
+
+// Call function(begin, end) for consecutive chunks of [0, count) on the
+// global thread pool and wait for all of them. Small ranges run inline.
+template <typename Function>
+void parallelFor(int count, int chunkSize, Function function) {
+  if (count <= chunkSize) {
+    function(0, count);
+    return;
+  }
+  QVector<int> starts;
+  for (int start = 0; start < count; start += chunkSize)
+    starts.append(start);
+  QtConcurrent::blockingMap(starts, [&](int start) {
+    function(start, qMin(start + chunkSize, count));
+  });
+}
+
+#endif // PARALLEL_H
@@ -0,0 +1,324 @@
+#include "poster.h"
+#include "parallel.h"
+#include "trace.h"
+#include <QFileInfo>
+#include <QtMath>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+static void appendLittle16(QByteArray &data, quint16 value) {
+  data.append(char(value & 0xff)).append(char(value >> 8));
+}
+
+static void appendLittle32(QByteArray &data, quint32 value) {
+  appendLittle16(data, value & 0xffff);
+  appendLittle16(data, value >> 16);
+}
+
+static void appendBig32(QByteArray &data, quint32 value) {
+  for (int shift = 24; shift >= 0; shift -= 8)
+    data.append(char((value >> shift) & 0xff));
+}
+
+static quint32 pngCrc(const QByteArray &data, quint32 crc = 0) {
+  static quint32 table[256];
+  static bool initialized = false;
+  if (!initialized) {
+    for (quint32 i = 0; i < 256; ++i) {
+      quint32 c = i;
+      for (int k = 0; k < 8; ++k)
+        c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    initialized = true;
+  }
+  crc = ~crc;
+  for (int i = 0; i < data.size(); ++i)
+    crc = table[(crc ^ (uchar) data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static quint32 pngAdler(const uchar *data, int size, quint32 adler) {
+  quint32 a = adler & 0xffff, b = adler >> 16;
+  for (int i = 0; i < size; ++i) {
+    a = (a + data[i]) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+bool StreamedImageWriter::fail(const QString &message) {
+  error = message;
+  file.close();
+  return false;
+}
+
+bool StreamedImageWriter::open(const QString &fileName, int width, int height) {
+  this->width = width;
+  this->height = height;
+  rowsWritten = 0;
+  adler = 1;
+  error.clear();
+  QString suffix = QFileInfo(fileName).suffix().toLower();
+  if (suffix != "png" && suffix != "tif" && suffix != "tiff")
+    return fail("Unsupported image format: " + suffix);
+  png = suffix == "png";
+  if (width <= 0 || height <= 0)
+    return fail("Empty image");
+  file.setFileName(fileName);
+  if (!file.open(QIODevice::WriteOnly))
+    return fail(file.errorString());
+  if (!png)
+    return writeTiffHeader();
+
+  QByteArray header;
+  appendBig32(header, width);
+  appendBig32(header, height);
+  header.append(char(8)).append(char(2)).append(char(0)).append(char(0)).append(char(0)); // 8-bit RGB
+  file.write("\x89PNG\r\n\x1a\n", 8);
+  return writePngChunk("IHDR", header);
+}
+
+// All strips are the same size, so the directory can precede the image data
+bool StreamedImageWriter::writeTiffHeader() {
+  quint64 rowBytes = 3 * (quint64) width;
+  quint32 bitsOffset = 8 + 2 + 10 * 12 + 4;
+  quint32 stripOffsetsOffset = bitsOffset + 6;
+  quint32 stripCountsOffset = stripOffsetsOffset + 4 * height;
+  quint64 dataOffset = stripCountsOffset + 4 * (quint64) height;
+  if (dataOffset + rowBytes * height > 0xffffffffull)
+    return fail("Image too large for TIFF, use PNG");
+
+  QByteArray header("II");
+  appendLittle16(header, 42);
+  appendLittle32(header, 8);
+  auto entry = [&](quint16 tag, quint16 type, quint32 count, quint32 value) {
+    appendLittle16(header, tag);
+    appendLittle16(header, type);
+    appendLittle32(header, count);
+    if (type == 3 && count == 1) {
+      appendLittle16(header, value);
+      appendLittle16(header, 0);
+    } else {
+      appendLittle32(header, value);
+    }
+  };
+  const quint16 Short = 3, Long = 4;
+  appendLittle16(header, 10);
+  entry(256, Long, 1, width); // ImageWidth
+  entry(257, Long, 1, height); // ImageLength
+  entry(258, Short, 3, bitsOffset); // BitsPerSample
+  entry(259, Short, 1, 1); // Compression: none
+  entry(262, Short, 1, 2); // PhotometricInterpretation: RGB
+  entry(273, Long, height, height == 1 ? dataOffset : stripOffsetsOffset); // StripOffsets
+  entry(277, Short, 1, 3); // SamplesPerPixel
+  entry(278, Long, 1, 1); // RowsPerStrip
+  entry(279, Long, height, height == 1 ? rowBytes : stripCountsOffset); // StripByteCounts
+  entry(284, Short, 1, 1); // PlanarConfiguration: interleaved
+  appendLittle32(header, 0);
+  for (int i = 0; i < 3; ++i)
+    appendLittle16(header, 8);
+  for (int i = 0; i < height; ++i)
+    appendLittle32(header, dataOffset + i * rowBytes);
+  for (int i = 0; i < height; ++i)
+    appendLittle32(header, rowBytes);
+  if (file.write(header) != header.size())
+    return fail(file.errorString());
+  return true;
+}
+
+bool StreamedImageWriter::writePngChunk(const char *type, const QByteArray &data) {
+  QByteArray chunk;
+  appendBig32(chunk, data.size());
+  QByteArray body = QByteArray(type) + data;
+  chunk += body;
+  appendBig32(chunk, pngCrc(body));
+  if (file.write(chunk) != chunk.size())
+    return fail(file.errorString());
+  return true;
+}
+
+bool StreamedImageWriter::writeRows(const uchar *rows, int count) {
+  if (!file.isOpen())
+    return false;
+  count = qMin(count, height - rowsWritten);
+  int rowBytes = 3 * width;
+  if (!png) {
+    qint64 bytes = (qint64) count * rowBytes;
+    rowsWritten += count;
+    if (file.write((const char *) rows, bytes) != bytes)
+      return fail(file.errorString());
+    return true;
+  }
+
+  // Rows without filter, in stored blocks of at most 65535 bytes
+  QByteArray filtered;
+  filtered.reserve(count * (rowBytes + 1));
+  for (int i = 0; i < count; ++i) {
+    filtered.append(char(0));
+    filtered.append((const char *) rows + (qint64) i * rowBytes, rowBytes);
+  }
+  adler = pngAdler((const uchar *) filtered.constData(), filtered.size(), adler);
+  bool last = rowsWritten + count == height;
+  QByteArray data;
+  if (rowsWritten == 0)
+    data.append(char(0x78)).append(char(0x01)); // zlib header
+  for (int start = 0; start < filtered.size(); start += 65535) {
+    quint16 size = qMin(65535, filtered.size() - start);
+    data.append(char(last && start + size == filtered.size() ? 1 : 0));
+    appendLittle16(data, size);
+    appendLittle16(data, ~size);
+    data.append(filtered.constData() + start, size);
+  }
+  if (last)
+    appendBig32(data, adler);
+  rowsWritten += count;
+  return writePngChunk("IDAT", data);
+}
+
+bool StreamedImageWriter::close() {
+  if (!file.isOpen())
+    return false;
+  if (rowsWritten < height)
+    return fail("Image incomplete");
+  if (png && !writePngChunk("IEND", QByteArray()))
+    return false;
+  file.close();
+  return true;
+}
+
+// Bounding box of a face in image pixels, and the bands of tiles it touches
+class PosterFace {
+public:
+  float left, top, right, bottom;
+  int firstBand, lastBand;
+};
+
+// Fills the pixels of one tile with the triangle fans of the faces, pixel
+// centers inside a triangle take its barycentric color
+static void renderTile(const Mesh &mesh, const QVector<int> &faceIndices, const QRectF &rect, int width, int height, int tileLeft, int tileTop, int tileWidth, int tileHeight, uchar *band, int bandStride) {
+  float scaleX = width / rect.width(), scaleY = height / rect.height();
+  QVector<QVector2D> corners;
+  QVector<QVector3D> colors;
+  foreach (int faceIndex, faceIndices) {
+    const Face &face = mesh.Faces[faceIndex];
+    corners.clear();
+    colors.clear();
+    HalfEdge *e = face.side;
+    for (int k = 0; k < face.val; ++k) {
+      QVector2D coords = e->prev->target->coords;
+      corners.append(QVector2D((coords.x() - rect.left()) * scaleX, (rect.bottom() - coords.y()) * scaleY));
+      colors.append(e->color);
+      e = e->next;
+    }
+    for (int k = 1; k + 1 < corners.size(); ++k) {
+      QVector2D p0 = corners[0], p1 = corners[k], p2 = corners[k + 1];
+      float area = (p1.x() - p0.x()) * (p2.y() - p0.y()) - (p1.y() - p0.y()) * (p2.x() - p0.x());
+      if (area == 0)
+        continue;
+      // Clamped before rounding, zoomed in far corners lie way outside of the image
+      int x0 = qFloor(qMax((float) tileLeft, qMin(p0.x(), qMin(p1.x(), p2.x()))));
+      int x1 = qMin(tileLeft + tileWidth - 1, qCeil(qMin((float) (tileLeft + tileWidth), qMax(p0.x(), qMax(p1.x(), p2.x())))));
+      int y0 = qFloor(qMax((float) tileTop, qMin(p0.y(), qMin(p1.y(), p2.y()))));
+      int y1 = qMin(tileTop + tileHeight - 1, qCeil(qMin((float) (tileTop + tileHeight), qMax(p0.y(), qMax(p1.y(), p2.y())))));
+      for (int y = y0; y <= y1; ++y) {
+        float py = y + .5f;
+        uchar *row = band + (qint64) (y - tileTop) * bandStride;
+        for (int x = x0; x <= x1; ++x) {
+          float px = x + .5f;
+          float w0 = ((p1.x() - px) * (p2.y() - py) - (p1.y() - py) * (p2.x() - px)) / area;
+          float w1 = ((p2.x() - px) * (p0.y() - py) - (p2.y() - py) * (p0.x() - px)) / area;
+          float w2 = 1 - w0 - w1;
+          if (w0 < 0 || w1 < 0 || w2 < 0)
+            continue;
+          QVector3D color = w0 * colors[0] + w1 * colors[k] + w2 * colors[k + 1];
+          uchar *pixel = row + 3 * x;
+          pixel[0] = (uchar) (255 * qBound(0.0f, color.x(), 1.0f) + .5f);
+          pixel[1] = (uchar) (255 * qBound(0.0f, color.y(), 1.0f) + .5f);
+          pixel[2] = (uchar) (255 * qBound(0.0f, color.z(), 1.0f) + .5f);
+        }
+      }
+    }
+  }
+}
+
+bool renderPoster(const Mesh &mesh, const QRectF &rect, int width, int height, const QString &fileName, QString *errorString, int tileSize) {
+  TRACE_ZONE("renderPoster");
+  StreamedImageWriter writer;
+  if (rect.isEmpty() || !writer.open(fileName, width, height)) {
+    *errorString = rect.isEmpty() ? QString("Empty view") : writer.errorString();
+    return false;
+  }
+  int bands = (height + tileSize - 1) / tileSize;
+  int tilesX = (width + tileSize - 1) / tileSize;
+
+  // Bounds of the faces, which are swept band by band
+  float scaleX = width / rect.width(), scaleY = height / rect.height();
+  QVector<PosterFace> faces(mesh.Faces.size());
+  QVector<QVector<int>> bandStarts(bands);
+  for (int i = 0; i < mesh.Faces.size(); ++i) {
+    PosterFace &face = faces[i];
+    face.left = face.top = std::numeric_limits<float>::max();
+    face.right = face.bottom = std::numeric_limits<float>::lowest();
+    HalfEdge *e = mesh.Faces[i].side;
+    for (int k = 0; k < mesh.Faces[i].val; ++k) {
+      float x = (e->target->coords.x() - rect.left()) * scaleX, y = (rect.bottom() - e->target->coords.y()) * scaleY;
+      face.left = qMin(face.left, x);
+      face.right = qMax(face.right, x);
+      face.top = qMin(face.top, y);
+      face.bottom = qMax(face.bottom, y);
+      e = e->next;
+    }
+    if (face.right < 0 || face.left >= width || face.bottom < 0 || face.top >= height)
+      continue;
+    face.firstBand = (int) qMax(0.0f, face.top) / tileSize;
+    face.lastBand = qMin(bands - 1, (int) qMin((float) height, face.bottom) / tileSize);
+    bandStarts[face.firstBand].append(i);
+  }
+  TRACE_COUNT(TraceFacesVisited, mesh.Faces.size());
+
+  int bandStride = 3 * width;
+  QVector<uchar> band;
+  QVector<int> active;
+  QVector<QVector<int>> tileFaces(tilesX);
+  for (int b = 0; b < bands; ++b) {
+    int bandTop = b * tileSize, bandHeight = qMin(tileSize, height - bandTop);
+
+    // Faces of the band, in mesh order like the draw calls
+    QVector<int> kept;
+    foreach (int i, active) {
+      if (faces[i].lastBand >= b)
+        kept.append(i);
+    }
+    active.clear();
+    std::merge(kept.constBegin(), kept.constEnd(), bandStarts[b].constBegin(), bandStarts[b].constEnd(), std::back_inserter(active));
+    bandStarts[b].clear();
+    for (int t = 0; t < tilesX; ++t)
+      tileFaces[t].clear();
+    foreach (int i, active) {
+      int first = (int) qMax(0.0f, faces[i].left) / tileSize;
+      int last = qMin(tilesX - 1, (int) qMin((float) width, faces[i].right) / tileSize);
+      for (int t = first; t <= last; ++t)
+        tileFaces[t].append(i);
+    }
+
+    // Tiles write disjoint columns of the band
+    band.fill(255, bandHeight * bandStride);
+    parallelFor(tilesX, 1, [&](int begin, int end) {
+      for (int t = begin; t < end; ++t) {
+        int tileLeft = t * tileSize;
+        renderTile(mesh, tileFaces[t], rect, width, height, tileLeft, bandTop, qMin(tileSize, width - tileLeft), bandHeight, band.data(), bandStride);
+      }
+    });
+    if (!writer.writeRows(band.constData(), bandHeight)) {
+      *errorString = writer.errorString();
+      return false;
+    }
+  }
+  if (!writer.close()) {
+    *errorString = writer.errorString();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,43 @@
+#ifndef POSTER_H
+#define POSTER_H
+
+#include "mesh.h"
+#include <QFile>
+#include <QRectF>
+#include <QString>
+
+// Writes an 8-bit RGB image a band of rows at a time, so only one band is
+// held in memory. The format follows the suffix: TIFF is written
+// uncompressed with a strip per row. PNG uses stored deflate blocks, as Qt
+// has no streaming compressor, so it is about as large as the TIFF.
+class StreamedImageWriter {
+
+public:
+  bool open(const QString &fileName, int width, int height);
+  bool writeRows(const uchar *rows, int count); // count rows of 3 * width bytes
+  bool close();
+
+  QString errorString() const {
+    return error;
+  }
+
+private:
+  QFile file;
+  bool png = false;
+  int width = 0, height = 0, rowsWritten = 0;
+  quint32 adler = 1; // Of the uncompressed PNG image data
+  QString error;
+
+  bool writeTiffHeader();
+  bool writePngChunk(const char *type, const QByteArray &data);
+  bool fail(const QString &message);
+
+};
+
+// Renders the faces of mesh like the default renderer, with rect in mesh
+// coordinates filling a width x height image on a white background. Square
+// tiles are rendered in parallel, each only with the faces overlapping it,
+// and streamed into fileName one band of tiles at a time.
+bool renderPoster(const Mesh &mesh, const QRectF &rect, int width, int height, const QString &fileName, QString *errorString, int tileSize = 512);
+
+#endif // POSTER_H
@@ -0,0 +1,243 @@
+#include "sparsehierarchy.h"
+#include "convenience.h"
+#include "subdivision.h"
+#include "editing.h"
+#include "densemap.h"
+#include "trace.h"
+#include "parallel.h"
+#include <QStack>
+#include <algorithm>
+
+// Faces per chunk of the parallel passes
+static const int ChunkSize = 4096;
+
+// Faces that are irregular, next to an irregular face, or have a halfedge with
+// edits on higher levels below it. globalEdgeIndices holds the index of every
+// face halfedge in the uniformly subdivided mesh of the level.
+FaceMask computeAffectedFaces(Mesh *mesh, const QVector<int> &globalEdgeIndices, const EditFootprint &footprint, int level) {
+  FaceMask affectedFaces(mesh->Faces.size(), 0);
+  const Face *faces = mesh->Faces.constData();
+  const int *globalIndices = globalEdgeIndices.constData();
+  char *affected = affectedFaces.data();
+  parallelFor(mesh->Faces.size(), ChunkSize, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      affected[i] = faces[i].val != 4 || hasIrregularDirectNeighbour(faces[i]);
+      HalfEdge *e = faces[i].side;
+      for (int j = 0; j < faces[i].val && !affected[i]; ++j) {
+        affected[i] = footprint.hasAffectedDescendant(globalIndices[e->index], level);
+        e = e->next;
+      }
+    }
+  });
+  return affectedFaces;
+}
+
+// Add all faces around irregular vertices of the faces, until no more are found.
+// The regularity of every face corner is decided in parallel up front.
+void computeIrregularityCascadedFaces(Mesh *mesh, FaceMask *faces) {
+  QVector<char> irregularCorners(mesh->HalfEdges.size(), 0);
+  const Face *meshFaces = mesh->Faces.constData();
+  char *irregular = irregularCorners.data();
+  parallelFor(mesh->Faces.size(), ChunkSize, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      HalfEdge *e = meshFaces[i].side;
+      for (int j = 0; j < meshFaces[i].val; ++j) {
+        irregular[e->index] = !isRegularVertex(e);
+        e = e->next;
+      }
+    }
+  });
+
+  FaceMask &cascadedFaces = *faces;
+  QStack<int> unprocessedFaces;
+  for (int i = 0; i < cascadedFaces.size(); ++i) {
+    if (cascadedFaces[i])
+      unprocessedFaces.push(i);
+  }
+  while (!unprocessedFaces.isEmpty()) {
+    Face *f = &mesh->Faces[unprocessedFaces.pop()];
+    HalfEdge *faceEdge = f->side;
+    for (int i = 0; i < f->val; ++i, faceEdge = faceEdge->next) {
+      if (!irregularCorners[faceEdge->index])
+        continue;
+      // Add faces surrounding vertex
+      HalfEdge *vertexEdge = faceEdge;
+      for (int j = 0; j < faceEdge->prev->target->val; ++j, vertexEdge = vertexEdge->prev->twin) {
+        if (vertexEdge->polygon && !cascadedFaces[vertexEdge->polygon->index]) {
+          cascadedFaces[vertexEdge->polygon->index] = 1;
+          unprocessedFaces.push(vertexEdge->polygon->index);
+        }
+      }
+    }
+  }
+}
+
+// Faces sharing a vertex with an input face, as a vertex pass followed by a face pass
+FaceMask computePaddedFaces(Mesh *mesh, const FaceMask &inputFaces) {
+  QVector<char> touchedVertices(mesh->Vertices.size(), 0);
+  const Vertex *vertices = mesh->Vertices.constData();
+  const char *input = inputFaces.constData();
+  char *touched = touchedVertices.data();
+  parallelFor(mesh->Vertices.size(), ChunkSize, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      HalfEdge *e = vertices[i].out;
+      for (int j = 0; j < vertices[i].val && !touched[i]; ++j) {
+        touched[i] = e->polygon && input[e->polygon->index];
+        e = e->prev->twin;
+      }
+    }
+  });
+
+  FaceMask paddedFaces(mesh->Faces.size(), 0);
+  const Face *faces = mesh->Faces.constData();
+  char *padded = paddedFaces.data();
+  parallelFor(mesh->Faces.size(), ChunkSize, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      HalfEdge *e = faces[i].side;
+      for (int j = 0; j < faces[i].val && !padded[i]; ++j) {
+        padded[i] = touched[e->target->index];
+        e = e->next;
+      }
+    }
+  });
+  return paddedFaces;
+}
+
+FaceMask computeTransitionFaces(Mesh *mesh, const FaceMask &refinedFaces) {
+  FaceMask transitionFaces(mesh->Faces.size(), 0);
+  const Face *faces = mesh->Faces.constData();
+  const char *refined = refinedFaces.constData();
+  char *transition = transitionFaces.data();
+  parallelFor(mesh->Faces.size(), ChunkSize, [&](int begin, int end) {
+    for (int i = begin; i < end; ++i) {
+      if (refined[i])
+        continue;
+      HalfEdge *e = faces[i].side;
+      for (int j = 0; j < faces[i].val && !transition[i]; ++j) {
+        transition[i] = e->twin->polygon && refined[e->twin->polygon->index];
+        e = e->next;
+      }
+    }
+  });
+  return transitionFaces;
+}
+
+static bool isEmpty(const FaceMask &faces) {
+  foreach (char flag, faces) {
+    if (flag)
+      return false;
+  }
+  return true;
+}
+
+// Pairs of subdivided and local index of the face halfedges, sorted
+static QVector<QPair<int, int>> computeGlobalToLocalEdges(const QVector<int> &globalEdgeIndices) {
+  QVector<QPair<int, int>> globalToLocal;
+  for (int i = 0; i < globalEdgeIndices.size(); ++i) {
+    if (globalEdgeIndices[i] >= 0)
+      globalToLocal.append(qMakePair(globalEdgeIndices[i], i));
+  }
+  std::sort(globalToLocal.begin(), globalToLocal.end());
+  return globalToLocal;
+}
+
+// The edits of one level with their halfedge in the submesh. The vertex index
+// keys stay those of the full level, but nothing looks them up.
+template <typename Edit>
+static QHash<int, Edit> localizeEdits(const QHash<int, Edit> &edits, const QVector<QPair<int, int>> &globalToLocal) {
+  QHash<int, Edit> localEdits;
+  for (typename QHash<int, Edit>::const_iterator it = edits.constBegin(); it != edits.constEnd(); ++it) {
+    QVector<QPair<int, int>>::const_iterator found = std::lower_bound(globalToLocal.constBegin(), globalToLocal.constEnd(), qMakePair(it.value().edgeIndex, 0));
+    if (found == globalToLocal.constEnd() || found->first != it.value().edgeIndex)
+      continue;
+    Edit edit = it.value();
+    edit.edgeIndex = found->second;
+    localEdits.insert(it.key(), edit);
+  }
+  return localEdits;
+}
+
+// Subdivided indices of the halfedges of the next level. The submesh lists its
+// face halfedges first, in the order of the edge map keys, and child x of a
+// face halfedge e is 4 * e + x in both the sparse and the uniform hierarchy.
+static void subdivideGlobalEdgeIndices(Mesh *subMesh, const DenseMap<int> &currentToSubEdgeMap, Mesh *subdivMesh, QVector<int> *globalEdgeIndices) {
+  QVector<int> subdivIndices(subdivMesh->HalfEdges.size(), -1);
+  const QVector<int> &currentEdges = currentToSubEdgeMap.keys();
+  for (int i = 0; i < subMesh->HalfEdges.size() && subMesh->HalfEdges[i].polygon; ++i) {
+    int globalIndex = (*globalEdgeIndices)[currentEdges[i]];
+    for (int x = 0; x < 4; ++x)
+      subdivIndices[4 * i + x] = 4 * globalIndex + x;
+  }
+  globalEdgeIndices->swap(subdivIndices);
+}
+
+// Subdivide only what edits and irregularities need, starting from the ternary
+// subdivided input. Ends with the first level that has no refined faces.
+void computeSparseHierarchy(Mesh *inputMesh, const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits, LevelPool<SparseLevel> *levels) {
+  TRACE_ZONE("computeSparseHierarchy");
+  levels->clear();
+  EditFootprint footprint;
+  footprint.build(coordsEdits, colorEdits);
+
+  Mesh *curMesh = inputMesh;
+  Mesh subMesh, subdivMesh;
+  DenseMap<int> currentToSubEdgeMap;
+  QVector<int> paddingFaces;
+  QVector<int> globalEdgeIndices(inputMesh->HalfEdges.size());
+  for (int i = 0; i < globalEdgeIndices.size(); ++i)
+    globalEdgeIndices[i] = inputMesh->HalfEdges[i].polygon ? i : -1;
+
+  for (int l = 0; ; ++l) {
+    TRACE_ZONE("computeSparseHierarchy level");
+    SparseLevel &level = levels->append();
+    Mesh *mesh = &level.mesh;
+
+    // Apply edits of current level
+    if (coordsEdits.contains(l) || colorEdits.contains(l)) {
+      QVector<QPair<int, int>> globalToLocal = computeGlobalToLocalEdges(globalEdgeIndices);
+      computeEditedMesh(curMesh, localizeEdits(coordsEdits.value(l), globalToLocal), localizeEdits(colorEdits.value(l), globalToLocal), mesh);
+    } else {
+      computeEditedMesh(curMesh, QHash<int, CoordsEdit>(), QHash<int, ColorEdit>(), mesh);
+    }
+    TRACE_COUNT(TraceFacesVisited, mesh->Faces.size());
+
+    // Compute faces affected by non-regularity or higher level edits
+    level.refinedFaces = computeAffectedFaces(mesh, globalEdgeIndices, footprint, l);
+    computeIrregularityCascadedFaces(mesh, &level.refinedFaces);
+    level.transitionFaces = computeTransitionFaces(mesh, level.refinedFaces);
+    level.paddingFaces.fill(0, mesh->Faces.size());
+    foreach (int faceIndex, paddingFaces)
+      level.paddingFaces[faceIndex] = 1;
+    if (isEmpty(level.refinedFaces))
+      break;
+
+    // Pad refined faces (to ensure correct subdivision) and extract them
+    FaceMask paddedFaces = computePaddedFaces(mesh, level.refinedFaces);
+    QSet<int> paddedFaceIndices;
+    for (int i = 0; i < paddedFaces.size(); ++i) {
+      if (paddedFaces[i])
+        paddedFaceIndices << i;
+    }
+    subMesh.clear();
+    computeSubMesh(mesh, paddedFaceIndices, &subMesh, &currentToSubEdgeMap);
+
+    // Catmull-Clark subdivide
+    subdivMesh.clear();
+    subdivideCatmullClark(&subMesh, &subdivMesh);
+    subdivideGlobalEdgeIndices(&subMesh, currentToSubEdgeMap, &subdivMesh, &globalEdgeIndices);
+
+    // The children of padding faces are the halfedges of their submesh face
+    paddingFaces.clear();
+    foreach (int faceIndex, paddedFaceIndices) {
+      if (level.refinedFaces[faceIndex])
+        continue;
+      Face *subFace = subMesh.HalfEdges[currentToSubEdgeMap.value(mesh->Faces[faceIndex].side->index)].polygon;
+      HalfEdge *e = subFace->side;
+      for (int i = 0; i < subFace->val; ++i) {
+        paddingFaces << e->index;
+        e = e->next;
+      }
+    }
+    curMesh = &subdivMesh;
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef SPARSEHIERARCHY_H
+#define SPARSEHIERARCHY_H
+
+#include "mesh.h"
+#include "coordsedit.h"
+#include "coloredit.h"
+#include "levelpool.h"
+#include "editfootprint.h"
+#include <QHash>
+#include <QVector>
+
+// One flag per face. A byte instead of a bit, so that parallel passes can
+// set the flags of their own faces without touching those of others.
+typedef QVector<char> FaceMask;
+
+// One level of the adaptive subdivision hierarchy. Only the faces that edits
+// on higher levels or irregularities force to be refined, plus one ring of
+// padding around them, are subdivided into the next level. All other faces
+// of a level are final and drawn as patches, so the size of the hierarchy
+// follows the edited area instead of growing by four per level.
+class SparseLevel {
+  public:
+    Mesh mesh;                // Edited submesh of the level
+    FaceMask refinedFaces;    // Continued on the next level
+    FaceMask paddingFaces;    // Only present to subdivide the refined faces of the level below
+    FaceMask transitionFaces; // Patch faces sharing an edge with a refined face
+
+    bool isPatchFace(int faceIndex) const {
+      return !(refinedFaces[faceIndex] || paddingFaces[faceIndex]);
+    }
+};
+
+FaceMask computeAffectedFaces(Mesh *mesh, const QVector<int> &globalEdgeIndices, const EditFootprint &footprint, int level);
+void computeIrregularityCascadedFaces(Mesh *mesh, FaceMask *faces);
+FaceMask computePaddedFaces(Mesh *mesh, const FaceMask &inputFaces);
+FaceMask computeTransitionFaces(Mesh *mesh, const FaceMask &refinedFaces);
+
+void computeSparseHierarchy(Mesh *inputMesh, const QHash<int, QHash<int, CoordsEdit>> &coordsEdits, const QHash<int, QHash<int, ColorEdit>> &colorEdits, LevelPool<SparseLevel> *levels);
+
+#endif // SPARSEHIERARCHY_H
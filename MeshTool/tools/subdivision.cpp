@@ -3,11 +3,15 @@
 
 bool isRegularVertex(HalfEdge *inputEdge) {
   Vertex *origin = inputEdge->prev->target;
+  if (origin->val > 4)
+    return false;
 
-  // Check if all adjacent faces are quads
-  foreach (HalfEdge *e, getVertexEdges(inputEdge)) {
+  // Check if all adjacent faces are quads (walking the edges, this runs for every face of a level)
+  HalfEdge *e = inputEdge;
+  for (int i = 0; i < origin->val; ++i) {
     if (e->polygon && e->polygon->val != 4)
       return false;
+    e = e->prev->twin;
   }
 
   // Check vertex valency
@@ -37,23 +41,30 @@ bool isRegularFace(Face f) {
     return false;
 
   // Check if all face vertices are regular
-  foreach (HalfEdge *e, getFaceEdges(f.side)) {
+  HalfEdge *e = f.side;
+  for (int i = 0; i < 4; ++i) {
     if (!isRegularVertex(e))
       return false;
+    e = e->next;
   }
 
   return true;
 }
 
 Mesh computeLimitMesh(Mesh inputMesh) {
-  Mesh limitMesh = inputMesh.copy();
-  for (int i = 0; i < inputMesh.Vertices.size(); ++i)
-    limitMesh.Vertices[i].coords = computeLimitPointCoords(inputMesh.Vertices[i].out);
-  for (int i = 0; i < inputMesh.HalfEdges.size(); ++i)
-    limitMesh.HalfEdges[i].color = computeLimitPointColor(&inputMesh.HalfEdges[i]);
+  Mesh limitMesh;
+  computeLimitMesh(&inputMesh, &limitMesh);
   return limitMesh;
 }
 
+void computeLimitMesh(Mesh *inputMesh, Mesh *limitMesh) {
+  inputMesh->copyTo(limitMesh);
+  for (int i = 0; i < inputMesh->Vertices.size(); ++i)
+    limitMesh->Vertices[i].coords = computeLimitPointCoords(inputMesh->Vertices[i].out);
+  for (int i = 0; i < inputMesh->HalfEdges.size(); ++i)
+    limitMesh->HalfEdges[i].color = computeLimitPointColor(&inputMesh->HalfEdges[i]);
+}
+
 QVector2D computeMeanFaceCoords(HalfEdge *inputEdge) {
   QVector2D sum;
   foreach (HalfEdge *e, getFaceEdges(inputEdge))
@@ -146,6 +157,22 @@ QVector2D computeInvertedLimitPointCoords(Vertex *v, QVector2D limitPoint) {
   }
 }
 
+// Sizes of the output of subdivideTernaryStep, following its index layout
+void computeTernaryStepSizes(int *vertices, int *halfEdges, int *faces, int *sumFaceVal) {
+  *vertices += *halfEdges + *sumFaceVal;
+  *halfEdges = 6 * *sumFaceVal + 3 * *halfEdges;
+  *faces = 2 * *sumFaceVal + *faces;
+  *sumFaceVal = 9 * *sumFaceVal;
+}
+
+// Sizes of the output of subdivideCatmullClark, following its index layout
+void computeCatmullClarkSizes(int *vertices, int *halfEdges, int *faces, int *sumFaceVal) {
+  *vertices += *halfEdges / 2 + *faces;
+  *halfEdges = 2 * *halfEdges + 2 * *sumFaceVal;
+  *faces = *sumFaceVal;
+  *sumFaceVal = 4 * *sumFaceVal;
+}
+
 void subdivideTernaryStep(Mesh* inputMesh, Mesh* subdivMesh) {
 
   // --- EXPLANATION ---
@@ -195,9 +222,7 @@ void subdivideTernaryStep(Mesh* inputMesh, Mesh* subdivMesh) {
     sumFaceVal += inputMesh->Faces[i].val;
 
   // Resize
-  subdivMesh->Vertices.resize(inputMesh->Vertices.size() + inputMesh->HalfEdges.size() + sumFaceVal);
-  subdivMesh->HalfEdges.resize(6 * sumFaceVal + 3 * inputMesh->HalfEdges.size());
-  subdivMesh->Faces.resize(2 * sumFaceVal + inputMesh->Faces.size());
+  subdivMesh->resize(inputMesh->Vertices.size() + inputMesh->HalfEdges.size() + sumFaceVal, 6 * sumFaceVal + 3 * inputMesh->HalfEdges.size(), 2 * sumFaceVal + inputMesh->Faces.size());
 
   // --- ASSIGN VERTICES ---
 
@@ -462,12 +487,10 @@ void subdivideCatmullClark(Mesh* inputMesh, Mesh* subdivMesh) {
     sumFaceVal += inputMesh->Faces[i].val;
 
   // Resize
-  subdivMesh->Vertices.resize(inputMesh->Vertices.size() + inputMesh->HalfEdges.size() / 2 + inputMesh->Faces.size());
-  subdivMesh->HalfEdges.resize(2 * inputMesh->HalfEdges.size() + 2 * sumFaceVal);
-  subdivMesh->Faces.resize(sumFaceVal);
+  subdivMesh->resize(inputMesh->Vertices.size() + inputMesh->HalfEdges.size() / 2 + inputMesh->Faces.size(), 2 * inputMesh->HalfEdges.size() + 2 * sumFaceVal, sumFaceVal);
 
-  // Compute edge to vertex mapping for vertices 'b'
-  QHash<int, int> edgeVertexMapping;
+  // Compute edge to vertex mapping for vertices 'b' (keyed by the lowest halfedge index of an edge, which is always non-boundary)
+  QVector<int> edgeVertexMapping(sumFaceVal, -1);
   int idx = inputMesh->Vertices.size();
   for (int i = 0; i < sumFaceVal; ++i) {
     HalfEdge e = inputMesh->HalfEdges[i];
@@ -698,25 +721,83 @@ void subdivideCatmullClark(Mesh* inputMesh, Mesh* subdivMesh) {
   }
 }
 
-void computeSubMesh(Mesh *inputMesh, QSet<int> inputFaceIndices, Mesh *outputMesh, QHash<int, int> *outputEdgeMap) {
+// The maps are kept per thread and only cleared, extracting a small submesh
+// does not allocate or fill anything of the size of the input mesh
+// Recompute the coordinates of a Catmull-Clark step after only the coordinates of the input mesh changed
+void updateCatmullClarkCoords(Mesh *inputMesh, Mesh *subdivMesh) {
+  int faceOffset = inputMesh->Vertices.size() + inputMesh->HalfEdges.size() / 2;
+
+  // Vertices 'c'
+  foreach (const Face &f, inputMesh->Faces)
+    subdivMesh->Vertices[faceOffset + f.index].coords = computeMeanFaceCoords(f.side);
+
+  // Vertices 'b' (halfedge '0' of e targets its vertex 'b')
+  for (int i = 0; i < inputMesh->HalfEdges.size(); ++i) {
+    HalfEdge *e = &inputMesh->HalfEdges[i];
+    if (!e->polygon)
+      break;
+    if (e->index > e->twin->index)
+      continue;
+
+    QVector2D coord;
+    if (e->twin->polygon) {
+      coord += e->target->coords;
+      coord += e->twin->target->coords;
+      coord += subdivMesh->Vertices[faceOffset + e->polygon->index].coords;
+      coord += subdivMesh->Vertices[faceOffset + e->twin->polygon->index].coords;
+      coord /= 4;
+    } else {
+      coord = (e->target->coords + e->twin->target->coords) / 2;
+    }
+    subdivMesh->HalfEdges[4 * e->index].target->coords = coord;
+  }
+
+  // Vertices 'a'
+  for (int i = 0; i < inputMesh->Vertices.size(); ++i) {
+    Vertex *v = &inputMesh->Vertices[i];
+    QVector2D coord;
+    HalfEdge *e = getCCWBoundaryEdge(v->out);
+    if (!e->polygon) {
+      if (e->twin->target->val == 2)
+        coord = e->twin->target->coords;
+      else
+        coord = (e->target->coords + 6 * e->twin->target->coords + e->prev->twin->target->coords) / 8;
+    } else {
+      QVector2D sumStarCoords, sumFaceCoords;
+      foreach (HalfEdge *e, getVertexEdges(v->out)) {
+        sumStarCoords += e->target->coords;
+        sumFaceCoords += subdivMesh->Vertices[faceOffset + e->polygon->index].coords;
+      }
+      int n = v->val;
+      coord = ((n - 2) * v->coords + sumStarCoords / n + sumFaceCoords / n) / n;
+    }
+    subdivMesh->Vertices[v->index].coords = coord;
+  }
+}
+
+void computeSubMesh(Mesh *inputMesh, const QSet<int> &inputFaceIndices, Mesh *outputMesh, DenseMap<int> *outputEdgeMap) {
+  static thread_local DenseMap<int> faceMap, vertexMap;
+
   // Create input to output map for faces
-  QHash<int, int> faceMap;
+  faceMap.reset(inputMesh->Faces.size());
   int outputFaceIndex = 0;
   foreach (int inputFaceIndex, inputFaceIndices)
-    faceMap[inputFaceIndex] = outputFaceIndex++;
+    faceMap.insert(inputFaceIndex, outputFaceIndex++);
 
   // Create input to output map for vertices and edges
-  QHash<int, int> vertexMap, edgeMap;
+  vertexMap.reset(inputMesh->Vertices.size());
+  DenseMap<int> &edgeMap = *outputEdgeMap;
+  edgeMap.reset(inputMesh->HalfEdges.size());
   int outputVertexIndex = 0, outputEdgeIndex = 0;
   foreach (int inputFaceIndex, faceMap.keys()) {
     Face f = inputMesh->Faces[inputFaceIndex];
     foreach (HalfEdge *e, getFaceEdges(f.side)) {
       // Update vertex map
       if (!vertexMap.contains(e->target->index))
-        vertexMap[e->target->index] = outputVertexIndex++;
+        vertexMap.insert(e->target->index, outputVertexIndex++);
       // Update edge map for non-boundary halfedges
       if (!edgeMap.contains(e->index))
-        edgeMap[e->index] = outputEdgeIndex++;
+        edgeMap.insert(e->index, outputEdgeIndex++);
     }
   }
   foreach (int inputFaceIndex, faceMap.keys()) {
@@ -724,60 +805,55 @@ void computeSubMesh(Mesh *inputMesh, QSet<int> inputFaceIndices, Mesh *outputMes
     foreach (HalfEdge *e, getFaceEdges(f.side)) {
       // Update edge map for boundary halfedges
       if (!edgeMap.contains(e->twin->index))
-        edgeMap[e->twin->index] = outputEdgeIndex++;
+        edgeMap.insert(e->twin->index, outputEdgeIndex++);
     }
   }
 
-  // Set output edge map
-  *outputEdgeMap = edgeMap;
-
   // Initialize output mesh
-  outputMesh->Faces.resize(faceMap.size());
-  outputMesh->Vertices.resize(vertexMap.size());
-  outputMesh->HalfEdges.resize(edgeMap.size());
+  outputMesh->resize(vertexMap.size(), edgeMap.size(), faceMap.size());
 
   // Assign faces
   foreach (int inputFaceIndex, faceMap.keys()) {
-    int outputFaceIndex = faceMap[inputFaceIndex];
-    outputMesh->Faces[outputFaceIndex].side = &outputMesh->HalfEdges[edgeMap[inputMesh->Faces[inputFaceIndex].side->index]];
+    int outputFaceIndex = faceMap.value(inputFaceIndex);
+    outputMesh->Faces[outputFaceIndex].side = &outputMesh->HalfEdges[edgeMap.value(inputMesh->Faces[inputFaceIndex].side->index)];
     outputMesh->Faces[outputFaceIndex].val = inputMesh->Faces[inputFaceIndex].val;
     outputMesh->Faces[outputFaceIndex].index = outputFaceIndex;
   }
 
   // Assign vertices (valency assigned later)
   foreach (int inputVertexIndex, vertexMap.keys()) {
-    int outputVertexIndex = vertexMap[inputVertexIndex];
+    int outputVertexIndex = vertexMap.value(inputVertexIndex);
     outputMesh->Vertices[outputVertexIndex].coords = inputMesh->Vertices[inputVertexIndex].coords;
     HalfEdge *out = inputMesh->Vertices[inputVertexIndex].out;
     while (!out->polygon || !faceMap.contains(out->polygon->index))
       out = out->prev->twin;
-    outputMesh->Vertices[outputVertexIndex].out = &outputMesh->HalfEdges[edgeMap[out->index]];
+    outputMesh->Vertices[outputVertexIndex].out = &outputMesh->HalfEdges[edgeMap.value(out->index)];
     outputMesh->Vertices[outputVertexIndex].index = outputVertexIndex;
   }
 
   // Assign halfedges
   foreach (int inputEdgeIndex, edgeMap.keys()) {
-    int outputEdgeIndex = edgeMap[inputEdgeIndex];
+    int outputEdgeIndex = edgeMap.value(inputEdgeIndex);
     outputMesh->HalfEdges[outputEdgeIndex].color = inputMesh->HalfEdges[inputEdgeIndex].color;
-    outputMesh->HalfEdges[outputEdgeIndex].target = &outputMesh->Vertices[vertexMap[inputMesh->HalfEdges[inputEdgeIndex].target->index]];
+    outputMesh->HalfEdges[outputEdgeIndex].target = &outputMesh->Vertices[vertexMap.value(inputMesh->HalfEdges[inputEdgeIndex].target->index)];
     if (inputMesh->HalfEdges[inputEdgeIndex].polygon && faceMap.contains(inputMesh->HalfEdges[inputEdgeIndex].polygon->index)) {
       // Non-boundary case
-      outputMesh->HalfEdges[outputEdgeIndex].next = &outputMesh->HalfEdges[edgeMap[inputMesh->HalfEdges[inputEdgeIndex].next->index]];
-      outputMesh->HalfEdges[outputEdgeIndex].prev = &outputMesh->HalfEdges[edgeMap[inputMesh->HalfEdges[inputEdgeIndex].prev->index]];
-      outputMesh->HalfEdges[outputEdgeIndex].polygon = &outputMesh->Faces[faceMap[inputMesh->HalfEdges[inputEdgeIndex].polygon->index]];
+      outputMesh->HalfEdges[outputEdgeIndex].next = &outputMesh->HalfEdges[edgeMap.value(inputMesh->HalfEdges[inputEdgeIndex].next->index)];
+      outputMesh->HalfEdges[outputEdgeIndex].prev = &outputMesh->HalfEdges[edgeMap.value(inputMesh->HalfEdges[inputEdgeIndex].prev->index)];
+      outputMesh->HalfEdges[outputEdgeIndex].polygon = &outputMesh->Faces[faceMap.value(inputMesh->HalfEdges[inputEdgeIndex].polygon->index)];
     } else {
       // Boundary case
       HalfEdge *e = inputMesh->HalfEdges[inputEdgeIndex].next;
       while (!e->twin->polygon || !faceMap.contains(e->twin->polygon->index))
         e = e->twin->next;
-      outputMesh->HalfEdges[outputEdgeIndex].next = &outputMesh->HalfEdges[edgeMap[e->index]];
+      outputMesh->HalfEdges[outputEdgeIndex].next = &outputMesh->HalfEdges[edgeMap.value(e->index)];
       e = inputMesh->HalfEdges[inputEdgeIndex].prev;
       while (!e->twin->polygon || !faceMap.contains(e->twin->polygon->index))
         e = e->twin->prev;
-      outputMesh->HalfEdges[outputEdgeIndex].prev = &outputMesh->HalfEdges[edgeMap[e->index]];
+      outputMesh->HalfEdges[outputEdgeIndex].prev = &outputMesh->HalfEdges[edgeMap.value(e->index)];
       outputMesh->HalfEdges[outputEdgeIndex].polygon = nullptr;
     }
-    outputMesh->HalfEdges[outputEdgeIndex].twin = &outputMesh->HalfEdges[edgeMap[inputMesh->HalfEdges[inputEdgeIndex].twin->index]];
+    outputMesh->HalfEdges[outputEdgeIndex].twin = &outputMesh->HalfEdges[edgeMap.value(inputMesh->HalfEdges[inputEdgeIndex].twin->index)];
     outputMesh->HalfEdges[outputEdgeIndex].index = outputEdgeIndex;
     outputMesh->HalfEdges[outputEdgeIndex].isSharp = inputMesh->HalfEdges[inputEdgeIndex].isSharp;
   }
@@ -2,6 +2,7 @@
 #define SUBDIVISION_H
 
 #include "mesh.h"
+#include "densemap.h"
 
 bool isRegularVertex(HalfEdge *inputEdge);
 bool isRegularFace(Face f);
@@ -10,13 +11,17 @@ QVector3D computeMeanFaceColor(HalfEdge *inputEdge);
 QVector2D computeEdgeMidpointCoords(HalfEdge *e);
 QVector3D computeEdgeMidpointColor(HalfEdge *e);
 Mesh computeLimitMesh(Mesh inputMesh);
+void computeLimitMesh(Mesh *inputMesh, Mesh *limitMesh);
 
 QVector2D computeLimitPointCoords(HalfEdge *e);
 QVector3D computeLimitPointColor(HalfEdge *e);
 
 QVector2D computeInvertedLimitPointCoords(Vertex *v, QVector2D limitPoint);
+void computeTernaryStepSizes(int *vertices, int *halfEdges, int *faces, int *sumFaceVal);
+void computeCatmullClarkSizes(int *vertices, int *halfEdges, int *faces, int *sumFaceVal);
 void subdivideTernaryStep(Mesh *inputMesh, Mesh *subdivMesh);
 void subdivideCatmullClark(Mesh *inputMesh, Mesh *subdivMesh);
-void computeSubMesh(Mesh *inputMesh, QSet<int> inputFaceIndices, Mesh *outputMesh, QHash<int, int> *outputEdgeMap);
+void updateCatmullClarkCoords(Mesh *inputMesh, Mesh *subdivMesh);
+void computeSubMesh(Mesh *inputMesh, const QSet<int> &inputFaceIndices, Mesh *outputMesh, DenseMap<int> *outputEdgeMap);
 
 #endif // SUBDIVISION_H
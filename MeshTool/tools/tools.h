@@ -4,5 +4,6 @@
 #include "convenience.h"
 #include "subdivision.h"
 #include "editing.h"
+#include "trace.h"
 
 #endif // TOOLS_H
@@ -0,0 +1,157 @@
+#include "trace.h"
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+// Zones beyond this are dropped, so a forgotten recording cannot exhaust memory
+static const int MAX_TRACE_EVENTS = 1 << 20;
+
+static const char *counterNames[TraceCounterCount] = {
+  "facesVisited",
+  "paddedCalls",
+  "paddedFaces",
+  "allocations",
+  "allocatedBytes",
+  "uploadedBytes",
+  "stencilRows",
+  "drawCalls",
+  "culledPatches"
+};
+
+class TraceEvent {
+  public:
+    const char *name; // nullptr for counter samples
+    qint64 start;
+    qint64 duration;
+    int thread;
+    qint64 counters[TraceCounterCount];
+};
+
+static QAtomicInt recording;
+static QAtomicInteger<qint64> counters[TraceCounterCount];
+static QMutex mutex;
+static QElapsedTimer clock;
+static QVector<TraceEvent> events;
+static QHash<Qt::HANDLE, int> threads;
+static int droppedEvents = 0;
+static thread_local int depth = 0;
+
+// Call with the mutex locked
+static TraceEvent *appendEvent() {
+  if (events.size() >= MAX_TRACE_EVENTS) {
+    ++droppedEvents;
+    return nullptr;
+  }
+  Qt::HANDLE handle = QThread::currentThreadId();
+  if (!threads.contains(handle))
+    threads.insert(handle, threads.size());
+  events.append(TraceEvent());
+  TraceEvent *event = &events.last();
+  event->thread = threads[handle];
+  return event;
+}
+
+void startTrace() {
+  QMutexLocker locker(&mutex);
+  events.clear();
+  threads.clear();
+  droppedEvents = 0;
+  for (int i = 0; i < TraceCounterCount; ++i)
+    counters[i].storeRelease(0);
+  clock.start();
+  recording.storeRelease(1);
+}
+
+void stopTrace() {
+  recording.storeRelease(0);
+}
+
+bool isTraceRecording() {
+  return recording.loadAcquire();
+}
+
+void addTraceCount(TraceCounter counter, qint64 value) {
+  if (recording.loadAcquire())
+    counters[counter].fetchAndAddRelaxed(value);
+}
+
+TraceZone::TraceZone(const char *name) : name(name), start(-1) {
+  if (!recording.loadAcquire())
+    return;
+  start = clock.nsecsElapsed();
+  ++depth;
+}
+
+TraceZone::~TraceZone() {
+  if (start < 0)
+    return;
+  --depth;
+  if (!recording.loadAcquire())
+    return;
+  qint64 end = clock.nsecsElapsed();
+
+  QMutexLocker locker(&mutex);
+  TraceEvent *event = appendEvent();
+  if (!event)
+    return;
+  event->name = name;
+  event->start = start;
+  event->duration = end - start;
+
+  // Sample the counters once per outermost zone
+  if (depth == 0) {
+    TraceEvent *sample = appendEvent();
+    if (!sample)
+      return;
+    sample->name = nullptr;
+    sample->start = end;
+    sample->duration = 0;
+    for (int i = 0; i < TraceCounterCount; ++i)
+      sample->counters[i] = counters[i].fetchAndStoreRelaxed(0);
+  }
+}
+
+bool writeTrace(QString fileName) {
+  QMutexLocker locker(&mutex);
+  QSaveFile file(fileName);
+  if (!file.open(QFile::WriteOnly | QFile::Text)) {
+      qDebug() << " * Could not open file " << fileName << " for writing";
+      return false;
+  }
+
+  // Timestamps are in microseconds
+  QTextStream out(&file);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MeshTool\"}}";
+  for (int i = 0; i < events.size(); ++i) {
+    const TraceEvent &event = events[i];
+    out << ",\n";
+    if (event.name) {
+      out << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+          << ",\"ts\":" << QString::number(event.start / 1e3, 'f', 3)
+          << ",\"dur\":" << QString::number(event.duration / 1e3, 'f', 3) << "}";
+    } else {
+      out << "{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":" << event.thread
+          << ",\"ts\":" << QString::number(event.start / 1e3, 'f', 3) << ",\"args\":{";
+      for (int j = 0; j < TraceCounterCount; ++j)
+        out << (j ? "," : "") << "\"" << counterNames[j] << "\":" << event.counters[j];
+      out << "}}";
+    }
+  }
+  out << "\n],\"otherData\":{\"droppedEvents\":" << droppedEvents << "}}\n";
+
+  out.flush();
+  if (out.status() != QTextStream::Ok || !file.commit()) {
+      qDebug() << " * Could not write file " << fileName;
+      return false;
+  }
+  qDebug() << ":: Trace with" << events.size() << "events written to" << fileName;
+  return true;
+}
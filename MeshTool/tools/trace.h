@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+// Scoped trace zones and counters, exported in the Chrome trace event format
+// (load the file in chrome://tracing or Perfetto). Recording is off until
+// startTrace() is called, a zone then costs two clock reads and a locked
+// append. Build with DEFINES += MESHTOOL_NO_TRACE to compile all zones out.
+
+// Counters are summed over each outermost zone and sampled when it ends
+enum TraceCounter {
+  TraceFacesVisited,
+  TracePaddedCalls,
+  TracePaddedFaces,
+  TraceAllocations,
+  TraceAllocatedBytes,
+  TraceUploadedBytes,
+  TraceStencilRows,
+  TraceDrawCalls,
+  TraceCulledPatches,
+  TraceCounterCount
+};
+
+void startTrace();
+void stopTrace();
+bool isTraceRecording();
+bool writeTrace(QString fileName);
+void addTraceCount(TraceCounter counter, qint64 value);
+
+class TraceZone {
+  public:
+    explicit TraceZone(const char *name);
+    ~TraceZone();
+
+  private:
+    Q_DISABLE_COPY(TraceZone)
+
+    const char *name;
+    qint64 start; // -1 if not recorded
+};
+
+#ifdef MESHTOOL_NO_TRACE
+#define TRACE_ZONE(name)
+#define TRACE_COUNT(counter, value)
+#else
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_COUNT(counter, value) addTraceCount(counter, value)
+#endif
+
+#endif // TRACE_H
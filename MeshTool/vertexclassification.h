@@ -0,0 +1,32 @@
+#ifndef VERTEXCLASSIFICATION_H
+#define VERTEXCLASSIFICATION_H
+
+#include <QBitArray>
+#include <QVector>
+
+// Split of the vertices of a level into editable vertices (geometry and
+// colour) and gradient vertices (geometry only)
+class VertexClassification {
+  public:
+    QBitArray editable;
+    QVector<int> editableIndices;
+    QVector<int> gradientIndices;
+
+    bool isEditable(int vertexIndex) const {
+      return editable.testBit(vertexIndex);
+    }
+
+    // Rebuild the index lists from the editable bits
+    void updateIndices() {
+      editableIndices.resize(0);
+      gradientIndices.resize(0);
+      for (int i = 0; i < editable.size(); ++i) {
+        if (editable.testBit(i))
+          editableIndices.append(i);
+        else
+          gradientIndices.append(i);
+      }
+    }
+};
+
+#endif // VERTEXCLASSIFICATION_H